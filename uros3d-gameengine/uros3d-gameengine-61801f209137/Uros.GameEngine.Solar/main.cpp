@@ -132,6 +132,8 @@ int main(int argc, char* argv[])
 	settings.disableVSync();
 	settings.setWindowType(Settings::Window);
 	settings.setAntialiasingType(Settings::MSAAx8);
+	settings.enableLod();
+	settings.enableMeshOptimization();
 	if (Application::initialize(a, settings))
 		Application::run();
 
@@ -1,9 +1,37 @@
+#include <algorithm>
 #include <QtCore/QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
 #include "Component.h"
 #include "Transform.h"
 #include "GameObject.h"
+#include "TaskPool.h"
 #include "Rendering/Material.h"
+#include "Rendering/MeshRenderer.h"
 #include "Geometry/Plane3D.h"
+#include "Geometry/Octree.h"
+#include "Geometry/LinearOctree.h"
+#include "Geometry/LooseOctree.h"
+#include "Geometry/DynamicAabbTree.h"
+#include "Geometry/StaticBvh.h"
+#include "Geometry/AabbBlock.h"
+#include "Geometry/OcclusionBuffer.h"
+#include "Geometry/PotentiallyVisibleSet.h"
+#include "Geometry/TriangleBvh.h"
+#include "Geometry/VertexFormat.h"
+#include "Geometry/TriangleBlock.h"
+#include "Geometry/Mesh.h"
+#include "Geometry/MeshOptimizer.h"
+#include "Geometry/MeshSimplifier.h"
+#include "Geometry/Ray3D.h"
+#include "Geometry/Intersect.h"
+#include "IO/GameObjectReaderOBJ.h"
+#include "Scene/Camera.h"
+#include "Scene/Scene.h"
+#include "Rendering/RenderingManager.h"
 
 #define EPS 1e-3
 #define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
@@ -20,6 +48,34 @@ namespace GameEngine {
 				&& fabs(vec1.z() - vec2.z()) <= epsilon;
 		}
 
+		/*
+		Draws nothing, so scenes can be initialized and queried without a window or GL context.
+		*/
+		class NullRenderingManager final : public RenderingManagerInstance
+		{
+		public:
+			void initialize() override { }
+			RenderBuffer* createRenderBuffer(int width, int height, RenderBufferFormat format) override { return nullptr; }
+			void setActiveCamera(const Camera* camera) override { }
+			void setActiveLights(const QList<Light*>& lights) override { }
+			void pushTransform(const QMatrix4x4& transform) override { }
+			void popTransform(QMatrix4x4* outTransform = nullptr) override { }
+			void bindMaterial(const Material& material) override { }
+			void draw(const GeometryBase* geometry) override { }
+			void draw(const SkyBox* skyBox) override { }
+			void dbgDrawLines(const Segment3D* segments, int count, const QColor& color, float thickness = 1.0f) override { }
+		};
+
+		void initializeRenderingManager()
+		{
+			static auto initialized = false;
+			if (!initialized)
+			{
+				RenderingManager::initialize(new NullRenderingManager());
+				initialized = true;
+			}
+		}
+
 		TEST_CASE("GameObject")
 		{
 			class TestComponentA : public Component
@@ -168,6 +224,52 @@ namespace GameEngine {
 			GameObject::destroy(goA);
 		}
 
+		TEST_CASE("Transform-InverseMatrix")
+		{
+			auto goA = new GameObject("A");
+			auto goB = new GameObject("B");
+			goA->transform()->addChild(goB->transform());
+			goA->transform()->setPosition(QVector3D(1, 2, 3));
+			goA->transform()->rotate(QVector3D(0, 1, 0), 30);
+			goB->transform()->setLocalPosition(QVector3D(0, 0, 2));
+			goB->transform()->rotate(QVector3D(1, 0, 0), 45);
+			goB->transform()->setScale(QVector3D(2, 0.5f, 3));
+
+			// Cached inverse follows every change, parent's included
+			QVector3D points[] = { QVector3D(0, 0, 0), QVector3D(1, -2, 5), QVector3D(-3, 4, 0.5f) };
+			for (auto transform : { goA->transform(), goB->transform() })
+				for (const auto& point : points)
+				{
+					REQUIRE(equalsApproximately(transform->getInverseMatrix() * (transform->getMatrix() * point), point)) ;
+					REQUIRE(equalsApproximately(transform->getInverseMatrix() * point, transform->getMatrix().inverted() * point)) ;
+				}
+
+			GameObject::destroy(goA);
+		}
+
+		TEST_CASE("GameObject-AggregateBounds")
+		{
+			auto goA = new GameObject("A");
+			auto goB = new GameObject("B");
+			auto goC = new GameObject("C");
+			goB->transform()->setParent(goA->transform());
+			goC->transform()->setParent(goB->transform());
+			REQUIRE(equalsApproximately(goA->boundingBox().maxPoint(), QVector3D(0, 0, 0))) ;
+
+			// Moving a grandchild grows the boxes all the way up
+			goC->transform()->setPosition(QVector3D(5, 0, 0));
+			REQUIRE(equalsApproximately(goB->boundingBox().maxPoint(), QVector3D(5, 0, 0))) ;
+			REQUIRE(equalsApproximately(goA->boundingBox().maxPoint(), QVector3D(5, 0, 0))) ;
+
+			// Old parents shrink back once the child leaves
+			goC->transform()->setParent(nullptr);
+			REQUIRE(equalsApproximately(goA->boundingBox().maxPoint(), QVector3D(0, 0, 0))) ;
+			REQUIRE(equalsApproximately(goB->boundingBox().maxPoint(), QVector3D(0, 0, 0))) ;
+
+			GameObject::destroy(goC);
+			GameObject::destroy(goA);
+		}
+
 		TEST_CASE("Material")
 		{
 			Material m1, m2;
@@ -205,5 +307,1565 @@ namespace GameEngine {
 			REQUIRE(plane.relationToPoint(QVector3D(0, -2, 0)) == Plane3D::BehindThePlane);
 			REQUIRE(plane.relationToPoint(QVector3D(0, 1, 0)) == Plane3D::OnPlane);
 		}
+
+		TEST_CASE("CullingFrustum")
+		{
+			auto camera = Camera::create();
+			camera->transform()->setPosition(QVector3D(1, 2, 3));
+			camera->transform()->lookAt(QVector3D(10, 2, 3));
+			const auto& cameraFrustum = camera->getComponent<Camera>()->frustum();
+			auto frustum = cameraFrustum.snapshot();
+
+			// Corners taken from the matrix match the ones built from the camera properties
+			QVector<QVector3D> corners(8);
+			cameraFrustum.getCorners(corners);
+			for (int i = 0; i < 8; i++)
+				REQUIRE((frustum.corner(i) - corners[i]).length() < 0.01f * (1 + corners[i].length())) ;
+			REQUIRE(BoundingBox::isInsideOf(BoundingBox::create(corners), BoundingBox(frustum.boundingBox().minPoint() - QVector3D(1, 1, 1), frustum.boundingBox().maxPoint() + QVector3D(1, 1, 1)))) ;
+
+			REQUIRE(frustum.intersects(BoundingBox(QVector3D(4, 1, 2), QVector3D(6, 3, 4)))) ;
+			REQUIRE(!frustum.intersects(BoundingBox(QVector3D(-6, 1, 2), QVector3D(-4, 3, 4)))) ;
+			// Box around the camera crosses the near plane
+			REQUIRE(frustum.intersects(BoundingBox(QVector3D(0, 1, 2), QVector3D(2, 3, 4)))) ;
+			// Box next to the frustum is inside of its bounding box, but outside of the side plane
+			REQUIRE(!frustum.intersects(BoundingBox(QVector3D(2, 2, 8), QVector3D(3, 3, 9)))) ;
+
+			int lastPlane = CullingFrustum::Near;
+			REQUIRE(frustum.classify(BoundingBox(QVector3D(4, 1, 2), QVector3D(6, 3, 4)), lastPlane) == CullingFrustum::Inside) ;
+			REQUIRE(frustum.classify(BoundingBox(QVector3D(0, 1, 2), QVector3D(2, 3, 4)), lastPlane) == CullingFrustum::Intersecting) ;
+			REQUIRE(lastPlane == CullingFrustum::Near) ;
+			// Rejecting plane is remembered for the next query
+			REQUIRE(frustum.classify(BoundingBox(QVector3D(2, 2, 8), QVector3D(3, 3, 9)), lastPlane) == CullingFrustum::Outside) ;
+			REQUIRE((lastPlane == CullingFrustum::Left || lastPlane == CullingFrustum::Right)) ;
+			auto rejectingPlane = lastPlane;
+			REQUIRE(frustum.classify(BoundingBox(QVector3D(2, 2, 8), QVector3D(3, 3, 9)), lastPlane) == CullingFrustum::Outside) ;
+			REQUIRE(lastPlane == rejectingPlane) ;
+
+			GameObject::destroy(camera);
+		}
+
+		TEST_CASE("AabbBlock")
+		{
+			auto camera = Camera::create();
+			camera->transform()->setPosition(QVector3D(1, 2, 3));
+			camera->transform()->lookAt(QVector3D(10, 2, 3));
+			auto frustum = camera->getComponent<Camera>()->frustum().snapshot();
+
+			// Same boxes as above, inside, outside, crossing the near plane and beside the frustum
+			QVector<BoundingBox> boxes;
+			boxes << BoundingBox(QVector3D(4, 1, 2), QVector3D(6, 3, 4))
+				<< BoundingBox(QVector3D(-6, 1, 2), QVector3D(-4, 3, 4))
+				<< BoundingBox(QVector3D(0, 1, 2), QVector3D(2, 3, 4))
+				<< BoundingBox(QVector3D(2, 2, 8), QVector3D(3, 3, 9))
+				<< BoundingBox(QVector3D(50, 0, 0), QVector3D(51, 1, 1))
+				<< BoundingBox(QVector3D(5000, 0, 0), QVector3D(5001, 1, 1))
+				<< BoundingBox(QVector3D(20, 2, 3), QVector3D(20, 2, 3))
+				<< BoundingBox(QVector3D(20, -100, 3), QVector3D(20, -100, 3));
+
+			AabbBlock block;
+			auto expected = 0;
+			for (int i = 0; i < AabbBlock::Size; i++)
+			{
+				block.set(i, boxes[i]);
+				if (frustum.intersects(boxes[i]))
+					expected |= 1 << i;
+			}
+			REQUIRE(block.intersect(frustum) == expected) ;
+			REQUIRE(expected == 0x55) ;
+			// Only the requested boxes are tested
+			REQUIRE(block.intersect(frustum, 3) == (expected & 7)) ;
+
+			GameObject::destroy(camera);
+		}
+
+		TEST_CASE("OcclusionBuffer")
+		{
+			REQUIRE_THROWS_AS(OcclusionBuffer(100, 64), std::logic_error) ;
+
+			QMatrix4x4 viewProjection;
+			viewProjection.perspective(60, 2, 0.1f, 100);
+			OcclusionBuffer buffer(256, 128);
+			buffer.clear(viewProjection);
+			REQUIRE(!buffer.isOccluded(BoundingBox(QVector3D(-0.5f, -0.5f, -10.5f), QVector3D(0.5f, 0.5f, -9.5f)))) ;
+
+			// Wall in front of the camera
+			buffer.rasterize(QVector3D(-3, -3, -5), QVector3D(3, -3, -5), QVector3D(3, 3, -5));
+			buffer.rasterize(QVector3D(-3, -3, -5), QVector3D(3, 3, -5), QVector3D(-3, 3, -5));
+			REQUIRE(buffer.triangleCount() == 2) ;
+			REQUIRE(buffer.depth(128, 64) < 1) ;
+			REQUIRE(buffer.depth(0, 0) == 1) ;
+
+			// Behind the wall
+			REQUIRE(buffer.isOccluded(BoundingBox(QVector3D(-0.5f, -0.5f, -10.5f), QVector3D(0.5f, 0.5f, -9.5f)))) ;
+			// In front of the wall
+			REQUIRE(!buffer.isOccluded(BoundingBox(QVector3D(-0.5f, -0.5f, -2.5f), QVector3D(0.5f, 0.5f, -1.5f)))) ;
+			// Crossing the wall
+			REQUIRE(!buffer.isOccluded(BoundingBox(QVector3D(-0.5f, -0.5f, -5.5f), QVector3D(0.5f, 0.5f, -4.5f)))) ;
+			// Behind the wall, but sticking out on the side
+			REQUIRE(!buffer.isOccluded(BoundingBox(QVector3D(7.5f, -0.5f, -10.5f), QVector3D(8.5f, 0.5f, -9.5f)))) ;
+			// Reaching behind the camera
+			REQUIRE(!buffer.isOccluded(BoundingBox(QVector3D(-0.5f, -0.5f, -10), QVector3D(0.5f, 0.5f, 1)))) ;
+
+			buffer.clear(viewProjection);
+			REQUIRE(!buffer.isOccluded(BoundingBox(QVector3D(-0.5f, -0.5f, -10.5f), QVector3D(0.5f, 0.5f, -9.5f)))) ;
+		}
+
+		TEST_CASE("PotentiallyVisibleSet")
+		{
+			QVector<GameObject*> gameObjects;
+			gameObjects << new GameObject("A") << new GameObject("B") << new GameObject("C");
+			gameObjects[1]->transform()->setPosition(QVector3D(10, 0, 0));
+			gameObjects[2]->transform()->setPosition(QVector3D(10, 0, 10));
+			for (auto gameObject : gameObjects)
+				gameObject->markAsStatic();
+
+			PotentiallyVisibleSet pvs;
+			REQUIRE_THROWS_AS(pvs.build(gameObjects, 0), std::logic_error) ;
+			pvs.build(gameObjects, 5);
+			REQUIRE(pvs.cellCount() == 4) ;
+			REQUIRE(pvs.findCell(QVector3D(1, 0, 1)) == 0) ;
+			REQUIRE(pvs.findCell(QVector3D(9, 0, 9)) == 3) ;
+			REQUIRE(pvs.findCell(QVector3D(100, 0, 0)) == -1) ;
+			// Nothing hides anything without meshes
+			for (int cell = 0; cell < pvs.cellCount(); cell++)
+				REQUIRE(pvs.visibleCount(cell) == 3) ;
+
+			auto path = QDir::temp().filePath("Uros.GameEngine.Tests.pvs");
+			REQUIRE(pvs.save(path)) ;
+			PotentiallyVisibleSet loaded;
+			REQUIRE(loaded.load(path, gameObjects, 5)) ;
+			REQUIRE(loaded.key() == pvs.key()) ;
+			REQUIRE(loaded.cellCount() == pvs.cellCount()) ;
+			REQUIRE(loaded.findCell(QVector3D(9, 0, 9)) == 3) ;
+			// Changed scene or cell size invalidates the file
+			REQUIRE(!loaded.load(path, gameObjects, 4)) ;
+			REQUIRE(loaded.isEmpty()) ;
+			REQUIRE(!loaded.load(path, gameObjects.mid(0, 2), 5)) ;
+			QFile::remove(path);
+
+			pvs.remove(gameObjects[0]);
+			REQUIRE(pvs.visibleCount(0) == 2) ;
+
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("PotentiallyVisibleSet-Occlusion")
+		{
+			// Wall between two cubes lying along x
+			QVector<GameObject*> gameObjects;
+			gameObjects << new GameObject("A") << new GameObject("Wall") << new GameObject("B");
+			gameObjects[1]->transform()->setPosition(QVector3D(10, -5, -5));
+			gameObjects[1]->transform()->setScale(QVector3D(1, 10, 10));
+			gameObjects[2]->transform()->setPosition(QVector3D(20, 0, 0));
+			for (auto gameObject : gameObjects)
+			{
+				gameObject->addComponent<MeshRenderer>()->setMesh(Mesh::cube());
+				gameObject->markAsStatic();
+			}
+
+			PotentiallyVisibleSet pvs;
+			pvs.build(gameObjects, 5);
+			auto cellA = pvs.findCell(QVector3D(0.5f, 0.5f, 0.5f));
+			auto cellB = pvs.findCell(QVector3D(20.5f, 0.5f, 0.5f));
+			REQUIRE(cellA >= 0) ;
+			REQUIRE(cellB >= 0) ;
+			REQUIRE(pvs.isVisible(cellA, 0)) ;
+			REQUIRE(pvs.isVisible(cellA, 1)) ;
+			REQUIRE(!pvs.isVisible(cellA, 2)) ;
+			REQUIRE(!pvs.isVisible(cellB, 0)) ;
+			REQUIRE(pvs.isVisible(cellB, 2)) ;
+			QList<GameObject*> visible;
+			pvs.visibleObjects(cellA, visible);
+			REQUIRE(visible.count() == 2) ;
+			REQUIRE(!visible.contains(gameObjects[2])) ;
+
+			// Same cubes without the wall see each other
+			QVector<GameObject*> open;
+			open << gameObjects[0] << gameObjects[2];
+			PotentiallyVisibleSet openPvs;
+			openPvs.build(open, 5);
+			REQUIRE(openPvs.isVisible(openPvs.findCell(QVector3D(0.5f, 0.5f, 0.5f)), 1)) ;
+
+			// Every bit survives the file
+			auto path = QDir::temp().filePath("Uros.GameEngine.Tests.Occlusion.pvs");
+			REQUIRE(pvs.save(path)) ;
+			PotentiallyVisibleSet loaded;
+			REQUIRE(loaded.load(path, gameObjects, 5)) ;
+			QFile::remove(path);
+			REQUIRE(loaded.cellCount() == pvs.cellCount()) ;
+			REQUIRE(loaded.gameObjectCount() == pvs.gameObjectCount()) ;
+			REQUIRE(loaded.boundingBox().minPoint() == pvs.boundingBox().minPoint()) ;
+			REQUIRE(loaded.boundingBox().maxPoint() == pvs.boundingBox().maxPoint()) ;
+			auto hidden = 0;
+			for (auto cell = 0; cell < pvs.cellCount(); cell++)
+			{
+				REQUIRE(loaded.visibleCount(cell) == pvs.visibleCount(cell)) ;
+				for (auto i = 0; i < gameObjects.count(); i++)
+				{
+					REQUIRE(loaded.isVisible(cell, i) == pvs.isVisible(cell, i)) ;
+					if (!pvs.isVisible(cell, i))
+						hidden++;
+				}
+			}
+			REQUIRE(hidden > 0) ;
+			REQUIRE(loaded.findCell(QVector3D(0.5f, 0.5f, 0.5f)) == cellA) ;
+			REQUIRE(!loaded.isVisible(cellA, 2)) ;
+
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("TriangleBlock")
+		{
+			auto random = []()
+			{
+				return (qrand() % 2000 - 1000) / 1000.0f;
+			};
+			qsrand(11);
+			auto hits = 0;
+			for (int i = 0; i < 2000; i++)
+			{
+				// Random triangles around the origin, random rays through the same area
+				TriangleBlock block;
+				QVector3D triangles[TriangleBlock::Size][3];
+				int count = 1 + i % TriangleBlock::Size;
+				for (int j = 0; j < count; j++)
+				{
+					for (int k = 0; k < 3; k++)
+						triangles[j][k] = QVector3D(random(), random(), random());
+					block.set(j, triangles[j][0], triangles[j][1], triangles[j][2]);
+				}
+				Ray3D ray(QVector3D(random(), random(), random()) * 3, QVector3D(random(), random(), random()));
+
+				auto expected = -1;
+				auto tExpected = std::numeric_limits<float>::max();
+				for (int j = 0; j < count; j++)
+				{
+					float t;
+					if (Intersect::rayAndTriangle(ray, triangles[j][0], triangles[j][1], triangles[j][2], &t) && t < tExpected)
+					{
+						tExpected = t;
+						expected = j;
+					}
+				}
+				float t, u, v;
+				auto hit = block.intersect(ray, std::numeric_limits<float>::max(), &t, &u, &v, count);
+				REQUIRE((hit >= 0) == (expected >= 0)) ;
+				if (hit < 0)
+					continue;
+				hits++;
+				REQUIRE(fabs(t - tExpected) <= EPS) ;
+				// Barycentrics lead back to the same point
+				QVector3D v0, v1, v2;
+				block.get(hit, v0, v1, v2);
+				REQUIRE(equalsApproximately(v0 + (v1 - v0) * u + (v2 - v0) * v, ray.origin() + ray.direction() * t)) ;
+				// Nothing is reported beyond the limit
+				REQUIRE(block.intersect(ray, t, &t, &u, &v, count) < 0) ;
+			}
+			REQUIRE(hits > 0) ;
+		}
+
+		TEST_CASE("TriangleBlock-Benchmark", "[.benchmark]")
+		{
+			const int count = 1 << 16;
+			const int rays = 64;
+			qsrand(5);
+			QVector<QVector3D> vertices;
+			QVector<TriangleBlock> blocks(count / TriangleBlock::Size);
+			for (int i = 0; i < count; i++)
+			{
+				QVector3D v0((qrand() % 2000 - 1000) / 100.0f, (qrand() % 2000 - 1000) / 100.0f, (qrand() % 2000 - 1000) / 100.0f);
+				vertices << v0 << v0 + QVector3D(1, 0, 0) << v0 + QVector3D(0, 1, 0);
+				blocks[i / TriangleBlock::Size].set(i % TriangleBlock::Size, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+			}
+
+			qint64 scalarElapsed = 0;
+			qint64 blockElapsed = 0;
+			for (int r = 0; r < rays; r++)
+			{
+				Ray3D ray(QVector3D(0, 0, -20), QVector3D((qrand() % 200 - 100) / 200.0f, (qrand() % 200 - 100) / 200.0f, 1));
+				QElapsedTimer timer;
+				timer.start();
+				auto tScalar = std::numeric_limits<float>::max();
+				for (int i = 0; i < count; i++)
+				{
+					float t;
+					if (Intersect::rayAndTriangle(ray, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], &t) && t < tScalar)
+						tScalar = t;
+				}
+				scalarElapsed += timer.nsecsElapsed();
+
+				timer.restart();
+				auto tBlock = std::numeric_limits<float>::max();
+				float u, v;
+				for (const auto& block : blocks)
+					block.intersect(ray, tBlock, &tBlock, &u, &v);
+				blockElapsed += timer.nsecsElapsed();
+				REQUIRE(fabs(tScalar - tBlock) <= EPS) ;
+			}
+			auto triangles = double(count) * rays;
+			WARN("Intersect::rayAndTriangle: " << triangles / scalarElapsed * 1000 << "M triangles/s, TriangleBlock: " << triangles / blockElapsed * 1000 << "M triangles/s");
+		}
+
+		TEST_CASE("Mesh-Welding")
+		{
+			// Quad made of two triangles sharing an edge
+			float vertices[] = { 0, 0, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 0, 0 };
+			float normals[] = { 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0 };
+			float texcoords[] = { 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 0, 0, 1, 0, 0, 0, 0 };
+			Mesh quad(vertices, normals, texcoords, 18);
+			REQUIRE(quad.vertexCount() == 6) ;
+			REQUIRE(quad.triangleCount() == 2) ;
+			REQUIRE(quad.indexCount() == 6) ;
+			REQUIRE(quad.uniqueVertexCount() == 4) ;
+			REQUIRE(quad.indexSize() == 2) ;
+			for (int i = 0; i < quad.vertexCount(); i++)
+			{
+				QVector3D v, n, c;
+				quad.getVertexData(i, v, n);
+				quad.getTextureCoord(i, c);
+				REQUIRE(equalsApproximately(v, QVector3D(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]))) ;
+				REQUIRE(equalsApproximately(n, QVector3D(0, 1, 0))) ;
+				REQUIRE(equalsApproximately(c, QVector3D(texcoords[i * 3], texcoords[i * 3 + 1], texcoords[i * 3 + 2]))) ;
+			}
+
+			// Corners differing in anything but position stay apart
+			normals[10] = -1;
+			Mesh creased(vertices, normals, texcoords, 18);
+			REQUIRE(creased.uniqueVertexCount() == 5) ;
+
+			auto sphere = Mesh::sphere();
+			REQUIRE(sphere->uniqueVertexCount() * 2 < sphere->vertexCount()) ;
+
+			// Too many vertices for 16 bits
+			const int triangles = 30000;
+			std::vector<float> positions(triangles * 9);
+			std::vector<float> flat(triangles * 9, 0);
+			for (int i = 0; i < triangles * 9; i++)
+				positions[i] = i;
+			Mesh large(positions.data(), flat.data(), flat.data(), triangles * 9);
+			REQUIRE(large.uniqueVertexCount() == triangles * 3) ;
+			REQUIRE(large.indexSize() == 4) ;
+			QVector3D t0, t1, t2, n0, n1, n2;
+			large.getTriangleData(triangles - 1, t0, t1, t2, n0, n1, n2);
+			REQUIRE(equalsApproximately(t2, QVector3D(positions[triangles * 9 - 3], positions[triangles * 9 - 2], positions[triangles * 9 - 1]))) ;
+		}
+
+		TEST_CASE("VertexFormat")
+		{
+			REQUIRE(sizeof(VertexFormat::CompactVertex) == 16) ;
+			REQUIRE(VertexFormat::CompactStride * 2 < 9 * sizeof(float)) ; // Position, normal and texture coordinate as floats
+
+			// Half floats
+			REQUIRE(VertexFormat::toHalf(1.0f) == 0x3c00) ;
+			REQUIRE(VertexFormat::toHalf(-2.0f) == 0xc000) ;
+			REQUIRE(VertexFormat::toHalf(65504.0f) == 0x7bff) ;
+			REQUIRE(VertexFormat::toHalf(1e6f) == 0x7c00) ;
+			REQUIRE(VertexFormat::fromHalf(VertexFormat::toHalf(0.5f)) == 0.5f) ;
+			REQUIRE(VertexFormat::fromHalf(VertexFormat::toHalf(0.0f)) == 0.0f) ;
+			REQUIRE(VertexFormat::fromHalf(VertexFormat::toHalf(1e-6f)) == Approx(1e-6f).epsilon(0.05)) ;
+
+			// Quantization clamps to the range and survives a zero extent
+			REQUIRE(VertexFormat::quantize(2, 0, 1) == 65535) ;
+			REQUIRE(VertexFormat::quantize(-1, 0, 1) == 0) ;
+			REQUIRE(VertexFormat::dequantize(VertexFormat::quantize(3, 3, 0), 3, 0) == 3) ;
+
+			// Compact vertices must stay close to the full float ones
+			Mesh* meshes[] = { Mesh::cube(), Mesh::sphere(), Mesh::cylinder(), Mesh::cone() };
+			for (auto mesh : meshes)
+			{
+				const auto& bounds = mesh->boundingBox();
+				auto packed = VertexFormat::pack(*mesh);
+				REQUIRE(packed.count() == mesh->uniqueVertexCount()) ;
+				for (int i = 0; i < packed.count(); i++)
+				{
+					QVector3D v, n, c, compactV, compactN, compactC;
+					mesh->getUniqueVertexData(i, v, n, c);
+					VertexFormat::unpack(packed[i], bounds, compactV, compactN, compactC);
+					for (int axis = 0; axis < 3; axis++)
+						REQUIRE(fabs(compactV[axis] - v[axis]) <= bounds.extent()[axis] / 65535 + 1e-6f) ;
+					if (n.length() > 0)
+						REQUIRE(QVector3D::dotProduct(compactN, n.normalized()) > 0.99999f) ;
+					REQUIRE(fabs(compactC.x() - c.x()) <= fabs(c.x()) / 1024 + 1e-6f) ;
+					REQUIRE(fabs(compactC.y() - c.y()) <= fabs(c.y()) / 1024 + 1e-6f) ;
+				}
+			}
+
+			// Normals pointing along the axes and into the lower hemisphere
+			QVector3D directions[] = { QVector3D(0, 0, -1), QVector3D(1, 0, 0), QVector3D(0, -1, 0), QVector3D(-1, -2, -3).normalized() };
+			for (auto& direction : directions)
+			{
+				qint16 encoded[2];
+				VertexFormat::encodeNormal(direction, encoded);
+				REQUIRE(equalsApproximately(VertexFormat::decodeNormal(encoded), direction)) ;
+			}
+		}
+
+		TEST_CASE("Mesh-LoadBenchmark", "[.benchmark]")
+		{
+			// Grid of quads big enough for copies to show, every corner but the border is shared
+			const int size = 400;
+			auto path = QDir::temp().filePath("Uros.GameEngine.Tests.obj");
+			{
+				QFile file(path);
+				REQUIRE(file.open(QFile::WriteOnly | QFile::Text)) ;
+				QTextStream stream(&file);
+				for (int i = 0; i <= size; i++)
+					for (int j = 0; j <= size; j++)
+						stream << "v " << i << " 0 " << j << "\n";
+				stream << "vn 0 1 0\n";
+				stream << "g Grid\n";
+				for (int i = 0; i < size; i++)
+					for (int j = 0; j < size; j++)
+					{
+						auto corner = i * (size + 1) + j + 1;
+						stream << "f " << corner << "//1 " << corner + 1 << "//1 " << corner + size + 1 << "//1 \n";
+						stream << "f " << corner + 1 << "//1 " << corner + size + 2 << "//1 " << corner + size + 1 << "//1 \n";
+					}
+			}
+
+			QElapsedTimer timer;
+			timer.start();
+			auto gameObject = GameObjectReaderOBJ(path).read();
+			auto readElapsed = timer.elapsed();
+			QFile::remove(path);
+			REQUIRE(gameObject) ;
+			REQUIRE(gameObject->transform()->children().count() == 1) ;
+			auto mesh = gameObject->transform()->children()[0]->gameObject()->getComponent<MeshRenderer>()->getMesh();
+			REQUIRE(mesh->triangleCount() == size * size * 2) ;
+			REQUIRE(mesh->uniqueVertexCount() == (size + 1) * (size + 1)) ;
+
+			// Welded data handed over the way batches do it, copied and adopted
+			std::vector<float> vertices, normals, texcoords;
+			std::vector<quint32> indices;
+			for (int i = 0; i < mesh->uniqueVertexCount(); i++)
+			{
+				QVector3D v, n, c;
+				mesh->getUniqueVertexData(i, v, n, c);
+				for (int j = 0; j < 3; j++)
+				{
+					vertices.push_back(v[j]);
+					normals.push_back(n[j]);
+					texcoords.push_back(c[j]);
+				}
+			}
+			for (int i = 0; i < mesh->indexCount(); i++)
+				indices.push_back(mesh->getIndex(i));
+
+			timer.restart();
+			Mesh copied(vertices.data(), normals.data(), texcoords.data(), static_cast<int>(vertices.size()), indices.data(), static_cast<int>(indices.size()));
+			auto copyElapsed = timer.nsecsElapsed();
+			timer.restart();
+			Mesh adopted(std::move(vertices), std::move(normals), std::move(texcoords), std::move(indices));
+			auto adoptElapsed = timer.nsecsElapsed();
+			REQUIRE(adopted.triangleCount() == copied.triangleCount()) ;
+			REQUIRE(adopted.uniqueVertexCount() == copied.uniqueVertexCount()) ;
+
+			WARN("OBJ with " << mesh->triangleCount() << " triangles read in " << readElapsed << " ms, mesh copied in "
+				<< copyElapsed / 1000 << " us, adopted in " << adoptElapsed / 1000 << " us");
+
+			GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("MeshSimplifier")
+		{
+			auto sphere = Mesh::sphere();
+			auto half = MeshSimplifier::simplify(*sphere, sphere->triangleCount() / 2);
+			REQUIRE(half->triangleCount() <= sphere->triangleCount() / 2) ;
+			REQUIRE(half->triangleCount() > 0) ;
+			REQUIRE(BoundingBox::isInsideOf(half->boundingBox(), sphere->boundingBox())) ;
+
+			// Nothing gets simplified until asked to, the mesh is its only level
+			REQUIRE(half->lodCount() == 1) ;
+			REQUIRE(&half->lod(0) == half) ;
+			delete half;
+
+			// Bumpy grid, open border has to stay exactly where it was
+			const int size = 40;
+			std::vector<float> vertices, normals;
+			auto corner = [&](int i, int j)
+			{
+				vertices.insert(vertices.end(), { float(i), 0.01f * ((i * 7 + j * 3) % 5), float(j) });
+				normals.insert(normals.end(), { 0, 1, 0 });
+			};
+			for (int i = 0; i < size; i++)
+				for (int j = 0; j < size; j++)
+				{
+					corner(i, j);
+					corner(i, j + 1);
+					corner(i + 1, j);
+					corner(i + 1, j);
+					corner(i, j + 1);
+					corner(i + 1, j + 1);
+				}
+			Mesh grid(vertices.data(), normals.data(), vertices.data(), static_cast<int>(vertices.size()));
+			auto simplified = MeshSimplifier::simplify(grid, grid.triangleCount() / 4);
+			REQUIRE(simplified->triangleCount() <= grid.triangleCount() / 4) ;
+			auto border = 0;
+			for (int i = 0; i < simplified->uniqueVertexCount(); i++)
+			{
+				QVector3D v, n, c;
+				simplified->getUniqueVertexData(i, v, n, c);
+				auto min = grid.boundingBox().minPoint();
+				auto max = grid.boundingBox().maxPoint();
+				if (v.x() == min.x() || v.x() == max.x() || v.z() == min.z() || v.z() == max.z())
+					border++;
+			}
+			REQUIRE(border == size * 4) ;
+			delete simplified;
+
+			// Every corner of a cube is on a seam, nothing can move
+			auto cube = MeshSimplifier::simplify(*Mesh::cube(), 2);
+			REQUIRE(cube->triangleCount() == Mesh::cube()->triangleCount()) ;
+			delete cube;
+
+			// Chain of levels, each one smaller than the one before
+			sphere->buildLods();
+			REQUIRE(sphere->lodCount() > 1) ;
+			REQUIRE(&sphere->lod(0) == sphere) ;
+			for (int i = 1; i < sphere->lodCount(); i++)
+				REQUIRE(sphere->lod(i).triangleCount() < sphere->lod(i - 1).triangleCount()) ;
+		}
+
+		TEST_CASE("MeshRenderer-Lod")
+		{
+			auto camera = Camera::create();
+			camera->transform()->setPosition(QVector3D(0, 0, 0));
+			camera->transform()->lookAt(QVector3D(0, 0, 10));
+			auto box = BoundingBox(QVector3D(-1, -1, 9), QVector3D(1, 1, 11));
+			auto size = camera->getComponent<Camera>()->projectedSize(box);
+			REQUIRE(fabs(size - sqrt(3.0f) / (10 * tan(30 * 3.1415926 / 180))) < 0.001f) ;
+			REQUIRE(camera->getComponent<Camera>()->projectedSize(BoundingBox(QVector3D(-1, -1, -1), QVector3D(1, 1, 1))) > 1000) ;
+			camera->getComponent<Camera>()->enableOrthographicMode();
+			camera->getComponent<Camera>()->setSize(4);
+			REQUIRE(fabs(camera->getComponent<Camera>()->projectedSize(box) - sqrt(3.0f) / 2) < 0.001f) ;
+
+			auto gameObject = new GameObject("Sphere");
+			auto renderer = gameObject->addComponent<MeshRenderer>();
+			renderer->setMesh(Mesh::sphere());
+			Mesh::sphere()->buildLods();
+			auto last = Mesh::sphere()->lodCount() - 1;
+			REQUIRE(last > 1) ;
+			REQUIRE(renderer->selectLod(1000, 1) == 0) ;
+			REQUIRE(renderer->selectLod(100, 1) == 1) ;
+			// Sizes just past a boundary keep the current level
+			REQUIRE(renderer->selectLod(135, 1) == 1) ;
+			REQUIRE(renderer->selectLod(150, 1) == 0) ;
+			REQUIRE(renderer->selectLod(120, 1) == 0) ;
+			REQUIRE(renderer->selectLod(2, 1) == last) ;
+			// Objects below the cull size aren't drawn
+			REQUIRE(renderer->selectLod(0.5f, 1) == -1) ;
+			REQUIRE(renderer->selectLod(1.1f, 1) == -1) ;
+			REQUIRE(renderer->selectLod(2, 1) == last) ;
+
+			GameObject::destroy(gameObject);
+			GameObject::destroy(camera);
+		}
+
+		TEST_CASE("MeshOptimizer")
+		{
+			// Grid with its triangles in random order, hardly any vertex is still in cache when it's used again
+			const int size = 64;
+			std::vector<float> vertices, normals, texcoords;
+			std::vector<quint32> indices;
+			for (int i = 0; i <= size; i++)
+				for (int j = 0; j <= size; j++)
+				{
+					vertices.insert(vertices.end(), { float(i), 0, float(j) });
+					normals.insert(normals.end(), { 0, 1, 0 });
+					texcoords.insert(texcoords.end(), { float(i) / size, float(j) / size, 0 });
+				}
+			for (int i = 0; i < size; i++)
+				for (int j = 0; j < size; j++)
+				{
+					quint32 a = i * (size + 1) + j;
+					quint32 b = a + size + 1;
+					indices.insert(indices.end(), { a, a + 1, b, b, a + 1, b + 1 });
+				}
+			srand(1);
+			for (int i = static_cast<int>(indices.size() / 3) - 1; i > 0; i--)
+			{
+				auto other = rand() % (i + 1);
+				for (int j = 0; j < 3; j++)
+					std::swap(indices[i * 3 + j], indices[other * 3 + j]);
+			}
+			auto vertexCount = static_cast<int>(vertices.size() / 3);
+			auto before = MeshOptimizer::acmr(indices, vertexCount);
+			REQUIRE(before > 2.5f) ;
+
+			auto cacheOrder = indices;
+			MeshOptimizer::optimizeVertexCache(cacheOrder, vertexCount);
+			REQUIRE(cacheOrder.size() == indices.size()) ;
+			REQUIRE(MeshOptimizer::acmr(cacheOrder, vertexCount) < 0.8f) ;
+
+			// Same triangles in the end, vertices in the order they're first used
+			auto copy = indices;
+			Mesh original(std::move(vertices), std::move(normals), std::move(texcoords), std::move(copy));
+			auto optimized = MeshOptimizer::optimize(original);
+			REQUIRE(optimized->triangleCount() == original.triangleCount()) ;
+			REQUIRE(optimized->uniqueVertexCount() == original.uniqueVertexCount()) ;
+			REQUIRE(MeshOptimizer::acmr(*optimized) < 0.8f) ;
+			REQUIRE(optimized->getIndex(0) == 0) ;
+			quint32 highest = 0;
+			auto ordered = true;
+			for (int i = 0; i < optimized->indexCount(); i++)
+			{
+				ordered &= optimized->getIndex(i) <= highest + 1;
+				highest = qMax(highest, optimized->getIndex(i));
+			}
+			REQUIRE(ordered) ;
+			QVector<QVector3D> originalCorners, optimizedCorners;
+			for (int i = 0; i < original.indexCount(); i++)
+			{
+				QVector3D v, n, c;
+				original.getUniqueVertexData(original.getIndex(i), v, n, c);
+				originalCorners << v + c;
+				optimized->getUniqueVertexData(optimized->getIndex(i), v, n, c);
+				optimizedCorners << v + c;
+			}
+			auto key = [](const QVector3D& a, const QVector3D& b)
+			{
+				return a.x() != b.x() ? a.x() < b.x() : a.y() != b.y() ? a.y() < b.y() : a.z() < b.z();
+			};
+			std::sort(originalCorners.begin(), originalCorners.end(), key);
+			std::sort(optimizedCorners.begin(), optimizedCorners.end(), key);
+			REQUIRE(originalCorners == optimizedCorners) ;
+			delete optimized;
+
+			// Sphere is generated in rows already, it still gets better
+			auto sphere = MeshOptimizer::optimize(*Mesh::sphere());
+			REQUIRE(MeshOptimizer::acmr(*sphere) < MeshOptimizer::acmr(*Mesh::sphere())) ;
+			delete sphere;
+		}
+
+		TEST_CASE("TriangleBvh")
+		{
+			Mesh* meshes[] = { Mesh::cube(), Mesh::sphere() };
+			qsrand(7);
+			for (auto mesh : meshes)
+			{
+				TriangleBvh bvh(*mesh);
+				REQUIRE(bvh.triangleCount() == mesh->triangleCount()) ;
+				REQUIRE(bvh.nodeCount() > 1) ;
+				REQUIRE(TriangleBvh::totalMemoryUsage() >= bvh.memoryUsage()) ;
+
+				// Closest hits must match testing every single triangle
+				for (int i = 0; i < 500; i++)
+				{
+					QVector3D origin((qrand() % 200 - 100) / 25.0f, (qrand() % 200 - 100) / 25.0f, (qrand() % 200 - 100) / 25.0f);
+					QVector3D target((qrand() % 100 - 50) / 80.0f, (qrand() % 100 - 50) / 80.0f, (qrand() % 100 - 50) / 80.0f);
+					Ray3D ray(origin, target - origin);
+					auto expected = std::numeric_limits<float>::max();
+					for (int j = 0; j < mesh->triangleCount(); j++)
+					{
+						float t;
+						QVector3D v0, v1, v2, n0, n1, n2;
+						mesh->getTriangleData(j, v0, v1, v2, n0, n1, n2);
+						if (Intersect::rayAndTriangle(ray, v0, v1, v2, &t) && t < expected)
+							expected = t;
+					}
+					float t;
+					int triangle;
+					auto hit = bvh.raycast(ray, &t, &triangle);
+					REQUIRE(hit == (expected < std::numeric_limits<float>::max())) ;
+					if (hit)
+					{
+						REQUIRE(fabs(t - expected) <= EPS) ;
+						REQUIRE(triangle >= 0) ;
+						REQUIRE(triangle < mesh->triangleCount()) ;
+
+						// Nothing is left in front of the closest hit, any hit can stop anywhere behind it
+						float tAny;
+						REQUIRE(!bvh.raycast(ray, &t, nullptr, nullptr, expected - EPS)) ;
+						REQUIRE(!bvh.intersects(ray, expected - EPS)) ;
+						REQUIRE(bvh.intersects(ray, std::numeric_limits<float>::max(), &tAny)) ;
+						REQUIRE(tAny >= expected - EPS) ;
+					}
+					else
+						REQUIRE(!bvh.intersects(ray, std::numeric_limits<float>::max())) ;
+				}
+			}
+		}
+
+		TEST_CASE("Octree")
+		{
+			// Everything is packed in one corner, the rest of the tree should stay empty
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < 40; i++)
+			{
+				auto gameObject = new GameObject("Point");
+				gameObject->transform()->setPosition(QVector3D(i * 0.01f, 0, 0));
+				gameObjects.push_back(gameObject);
+			}
+			auto farAway = new GameObject("FarAway");
+			farAway->transform()->setPosition(QVector3D(100, 100, 100));
+			gameObjects.push_back(farAway);
+
+			Octree octree(4, 2, 6);
+			octree.initialize(gameObjects);
+			auto nodeCount = octree.nodeCount();
+			REQUIRE(nodeCount > 1) ;
+			REQUIRE(nodeCount < 8 * 6) ;
+
+			QVector<BoundingBox> nodes;
+			REQUIRE(octree.findGameObject(farAway, nodes)) ;
+			REQUIRE(nodes.count() == 1) ;
+
+			// Moving within the same leaf doesn't touch the tree
+			farAway->transform()->setPosition(QVector3D(99.9f, 99.9f, 99.9f));
+			REQUIRE(!octree.update(farAway)) ;
+
+			// Removing objects merges the leaves back
+			for (int i = 0; i < 40; i++)
+				octree.remove(gameObjects[i]);
+			REQUIRE(octree.nodeCount() == 1) ;
+			REQUIRE(octree.findGameObject(farAway, nodes)) ;
+
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("LinearOctree")
+		{
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < 10; i++)
+				for (int j = 0; j < 10; j++)
+				{
+					auto gameObject = new GameObject("Point");
+					gameObject->transform()->setPosition(QVector3D(i * 2, 0, j * 2));
+					gameObjects.push_back(gameObject);
+				}
+
+			LinearOctree octree;
+			octree.initialize(gameObjects);
+			REQUIRE(octree.nodeCount() > 1) ;
+
+			QVector<BoundingBox> nodes;
+			REQUIRE(octree.findGameObject(gameObjects[0], nodes)) ;
+			REQUIRE(BoundingBox::isPointInside(nodes.first(), gameObjects[0]->transform()->getPosition())) ;
+
+			auto camera = Camera::create();
+			camera->transform()->setPosition(QVector3D(9, 0, -30));
+			camera->transform()->lookAt(QVector3D(9, 0, 9));
+			auto frustum = camera->getComponent<Camera>()->frustum().snapshot();
+
+			QList<GameObject*> visible;
+			octree.intersect(frustum, visible);
+			REQUIRE(visible.count() == gameObjects.count()) ;
+
+			// Move one object behind the camera and out of the octree bounds
+			gameObjects[0]->transform()->setPosition(QVector3D(9, 0, -60));
+			octree.update(gameObjects[0]);
+			visible.clear();
+			octree.intersect(frustum, visible);
+			REQUIRE(visible.count() == gameObjects.count() - 1) ;
+			REQUIRE(!visible.contains(gameObjects[0])) ;
+
+			// And back inside
+			gameObjects[0]->transform()->setPosition(QVector3D(1, 0, 1));
+			octree.update(gameObjects[0]);
+			octree.remove(gameObjects[1]);
+			visible.clear();
+			octree.intersect(frustum, visible);
+			REQUIRE(visible.count() == gameObjects.count() - 1) ;
+			REQUIRE(visible.contains(gameObjects[0])) ;
+			REQUIRE(!visible.contains(gameObjects[1])) ;
+			REQUIRE(!octree.findGameObject(gameObjects[1], nodes)) ;
+
+			GameObject::destroy(camera);
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("LooseOctree")
+		{
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < 10; i++)
+			{
+				auto gameObject = new GameObject("Point");
+				gameObject->transform()->setPosition(QVector3D(i * 2, 0, i * 2));
+				gameObjects.push_back(gameObject);
+			}
+
+			LooseOctree octree;
+			octree.initialize(gameObjects);
+			// Every point ends up in its own leaf
+			QVector<BoundingBox> nodes;
+			REQUIRE(octree.findGameObject(gameObjects[0], nodes)) ;
+			REQUIRE(nodes.count() == 1) ;
+			REQUIRE(BoundingBox::isPointInside(nodes.first(), gameObjects[0]->transform()->getPosition())) ;
+
+			auto camera = Camera::create();
+			camera->transform()->setPosition(QVector3D(9, 0, -30));
+			camera->transform()->lookAt(QVector3D(9, 0, 9));
+			auto frustum = camera->getComponent<Camera>()->frustum().snapshot();
+
+			QList<GameObject*> visible;
+			octree.intersect(frustum, visible);
+			REQUIRE(visible.count() == gameObjects.count()) ;
+
+			// Small moves don't leave the node, removing objects prunes empty nodes
+			auto nodeCount = octree.nodeCount();
+			gameObjects[0]->transform()->setPosition(QVector3D(0.001f, 0, 0));
+			REQUIRE(!octree.update(gameObjects[0])) ;
+			for (auto gameObject : gameObjects)
+				octree.remove(gameObject);
+			REQUIRE(octree.nodeCount() == 0) ;
+			for (auto gameObject : gameObjects)
+				octree.add(gameObject);
+			REQUIRE(octree.nodeCount() == nodeCount) ;
+
+			GameObject::destroy(camera);
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("DynamicAabbTree")
+		{
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < 64; i++)
+			{
+				auto gameObject = new GameObject("Point");
+				gameObject->transform()->setPosition(QVector3D(i, 0, i % 8));
+				gameObjects.push_back(gameObject);
+			}
+
+			DynamicAabbTree tree;
+			tree.initialize(gameObjects);
+			REQUIRE(tree.nodeCount() == 2 * 64 - 1) ;
+			// Inserting along a line would degenerate into a list without rotations
+			REQUIRE(tree.height() <= 12) ;
+
+			auto camera = Camera::create();
+			camera->transform()->setPosition(QVector3D(32, 0, -100));
+			camera->transform()->lookAt(QVector3D(32, 0, 4));
+			auto frustum = camera->getComponent<Camera>()->frustum().snapshot();
+
+			QList<GameObject*> visible;
+			tree.intersect(frustum, visible);
+			REQUIRE(visible.count() == gameObjects.count()) ;
+
+			// Small moves stay inside of the fattened bounds
+			gameObjects[0]->transform()->setPosition(QVector3D(0.01f, 0, 0));
+			REQUIRE(!tree.update(gameObjects[0])) ;
+			gameObjects[0]->transform()->setPosition(QVector3D(32, 0, -200));
+			REQUIRE(tree.update(gameObjects[0])) ;
+			visible.clear();
+			tree.intersect(frustum, visible);
+			REQUIRE(!visible.contains(gameObjects[0])) ;
+
+			for (int i = 0; i < 32; i++)
+				tree.remove(gameObjects[i]);
+			REQUIRE(tree.nodeCount() == 2 * 32 - 1) ;
+			QVector<BoundingBox> nodes;
+			REQUIRE(!tree.findGameObject(gameObjects[0], nodes)) ;
+			REQUIRE(tree.findGameObject(gameObjects[32], nodes)) ;
+			REQUIRE(BoundingBox::isPointInside(nodes.first(), gameObjects[32]->transform()->getPosition())) ;
+
+			GameObject::destroy(camera);
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("Scene-DeferredIndexUpdates")
+		{
+			// Grid of cubes big enough for the octree to split, the ones in one corner move to the opposite one
+			initializeRenderingManager();
+			Scene scene;
+			QVector<GameObject*> moved;
+			QVector<QVector3D> from, to;
+			for (int i = 0; i < 5; i++)
+				for (int j = 0; j < 5; j++)
+				{
+					auto gameObject = new GameObject("Cube");
+					gameObject->addComponent<MeshRenderer>()->setMesh(Mesh::cube());
+					gameObject->transform()->setPosition(QVector3D(i * 10, 0, j * 10));
+					scene.addGameObject(gameObject);
+					if (i < 2 && j < 2)
+						moved.push_back(gameObject);
+				}
+			scene.initialize();
+			for (auto gameObject : moved)
+			{
+				auto position = gameObject->transform()->getPosition();
+				from.push_back(position + QVector3D(0.5f, 0.5f, 0.5f));
+				to.push_back(QVector3D(35, 0, 35) - position + QVector3D(0.5f, 0.5f, 0.5f));
+				gameObject->transform()->setPosition(QVector3D(35, 0, 35) - position);
+			}
+
+			// Index keeps the old places until it's reconciled
+			QVector<BoundingBox> nodes;
+			for (int i = 0; i < moved.count(); i++)
+			{
+				REQUIRE(scene.spatialIndex()->findGameObject(moved[i], nodes)) ;
+				for (const auto& node : nodes)
+				{
+					REQUIRE(BoundingBox::isPointInside(node, from[i])) ;
+					REQUIRE(!BoundingBox::isPointInside(node, to[i])) ;
+				}
+			}
+			REQUIRE(scene.movedObjects() == 0) ;
+
+			scene.updateSpatialIndex();
+			REQUIRE(scene.movedObjects() == moved.count()) ;
+			for (int i = 0; i < moved.count(); i++)
+			{
+				REQUIRE(scene.spatialIndex()->findGameObject(moved[i], nodes)) ;
+				for (const auto& node : nodes)
+				{
+					REQUIRE(BoundingBox::isPointInside(node, to[i])) ;
+					REQUIRE(!BoundingBox::isPointInside(node, from[i])) ;
+				}
+			}
+
+			// Dirty set is empty now, reconciling again doesn't count anything twice
+			scene.updateSpatialIndex();
+			REQUIRE(scene.movedObjects() == moved.count()) ;
+		}
+
+		TEST_CASE("Scene-CullMovedObjects")
+		{
+			initializeRenderingManager();
+			Scene scene;
+			auto gameObject = new GameObject("Cube");
+			gameObject->addComponent<MeshRenderer>()->setMesh(Mesh::cube());
+			gameObject->transform()->setPosition(QVector3D(0, 0, 10));
+			scene.addGameObject(gameObject);
+			scene.initialize();
+
+			auto camera = Camera::create();
+			camera->transform()->setPosition(QVector3D(0, 0, 0));
+			camera->transform()->lookAt(QVector3D(0, 0, 10));
+			QList<Camera*> cameras;
+			cameras << camera->getComponent<Camera>();
+			QList<FrustumSet::Visibility> visible;
+			scene.cull(cameras, visible);
+			REQUIRE(visible.count() == 1) ;
+
+			// No frame is rendered in between, cull has to catch up with the move itself
+			gameObject->transform()->setPosition(QVector3D(0, 0, -50));
+			visible.clear();
+			scene.cull(cameras, visible);
+			REQUIRE(visible.isEmpty()) ;
+			gameObject->transform()->setPosition(QVector3D(0, 0, 20));
+			visible.clear();
+			scene.cull(cameras, visible);
+			REQUIRE(visible.count() == 1) ;
+			REQUIRE(visible.first().first == gameObject) ;
+
+			GameObject::destroy(camera);
+		}
+
+		TEST_CASE("StaticBvh")
+		{
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < 20; i++)
+				for (int j = 0; j < 20; j++)
+				{
+					auto gameObject = new GameObject("Static");
+					gameObject->transform()->setPosition(QVector3D(i * 5, (i + j) % 3, j * 5));
+					gameObject->markAsStatic();
+					gameObjects.push_back(gameObject);
+				}
+
+			StaticBvh bvh;
+			bvh.initialize(gameObjects);
+			REQUIRE(bvh.nodeCount() > 1) ;
+			REQUIRE(bvh.outlierStats().gameObjects == gameObjects.count()) ;
+
+			QVector<BoundingBox> nodes;
+			REQUIRE(bvh.findGameObject(gameObjects[42], nodes)) ;
+			REQUIRE(BoundingBox::isPointInside(nodes.first(), gameObjects[42]->transform()->getPosition())) ;
+
+			// Objects moved after the build are still found where they were put
+			auto position = gameObjects[43]->transform()->getPosition();
+			gameObjects[43]->transform()->setPosition(QVector3D(500, 0, 500));
+			REQUIRE(bvh.findGameObject(gameObjects[43], nodes)) ;
+			REQUIRE(BoundingBox::isPointInside(nodes.first(), position)) ;
+			gameObjects[43]->transform()->setPosition(position);
+
+			// Camera sees only a part of the grid, result has to match testing every object
+			auto camera = Camera::create();
+			camera->transform()->setPosition(QVector3D(0, 1, -10));
+			camera->transform()->lookAt(QVector3D(20, 1, 20));
+			auto frustum = camera->getComponent<Camera>()->frustum().snapshot();
+			QList<GameObject*> expected;
+			for (auto gameObject : gameObjects)
+				if (Intersect::frustumAndAABB(frustum, gameObject->boundingBox()))
+					expected.push_back(gameObject);
+			REQUIRE(expected.count() > 0) ;
+			REQUIRE(expected.count() < gameObjects.count()) ;
+
+			QList<GameObject*> visible;
+			bvh.intersect(frustum, visible);
+			REQUIRE(visible.count() == expected.count()) ;
+			for (auto gameObject : expected)
+				REQUIRE(visible.contains(gameObject)) ;
+
+			// Removed objects are skipped, the hierarchy itself can't change
+			bvh.remove(expected.first());
+			visible.clear();
+			bvh.intersect(frustum, visible);
+			REQUIRE(visible.count() == expected.count() - 1) ;
+			REQUIRE(!bvh.findGameObject(expected.first(), nodes)) ;
+			REQUIRE_THROWS_AS(bvh.add(expected.first()), std::logic_error) ;
+
+			GameObject::destroy(camera);
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("SpatialIndex-RaycastModes")
+		{
+			// Row of unit cubes along x, the ray enters the first one five units from its origin
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < 10; i++)
+			{
+				auto gameObject = new GameObject("Cube");
+				gameObject->addComponent<MeshRenderer>()->setMesh(Mesh::cube());
+				gameObject->transform()->setPosition(QVector3D(i * 3, 0, 0));
+				gameObject->markAsStatic();
+				gameObjects.push_back(gameObject);
+			}
+
+			Octree octree(4, 2, 6);
+			LinearOctree linearOctree;
+			LooseOctree looseOctree;
+			DynamicAabbTree tree;
+			StaticBvh bvh;
+			SpatialIndex* indices[] = { &octree, &linearOctree, &looseOctree, &tree, &bvh };
+			Ray3D ray(QVector3D(-5, 0.3f, 0.6f), QVector3D(1, 0, 0));
+			Ray3D back(QVector3D(40, 0.3f, 0.6f), QVector3D(-1, 0, 0));
+			for (auto index : indices)
+			{
+				index->initialize(gameObjects);
+				GameObject* gameObject;
+				QVector3D hitPoint;
+				REQUIRE(index->raycast(ray, gameObject, &hitPoint)) ;
+				REQUIRE(gameObject == gameObjects.first()) ;
+				REQUIRE(equalsApproximately(hitPoint, QVector3D(0, 0.3f, 0.6f))) ;
+				REQUIRE(index->raycast(back, gameObject, &hitPoint)) ;
+				REQUIRE(gameObject == gameObjects.last()) ;
+				REQUIRE(equalsApproximately(hitPoint, QVector3D(28, 0.3f, 0.6f))) ;
+
+				// Nothing is in front of the first cube
+				REQUIRE(!index->raycast(ray, gameObject, &hitPoint, SpatialIndex::ClosestHit, 4.9f)) ;
+				REQUIRE(!index->raycast(ray, gameObject, &hitPoint, SpatialIndex::AnyHit, 4.9f)) ;
+				REQUIRE(!gameObject) ;
+
+				// Any hit takes whatever it finds in range
+				REQUIRE(index->raycast(ray, gameObject, &hitPoint, SpatialIndex::AnyHit)) ;
+				REQUIRE(gameObjects.contains(gameObject)) ;
+				REQUIRE(index->raycast(ray, gameObject, &hitPoint, SpatialIndex::AnyHit, 7.5f)) ;
+				REQUIRE(gameObject == gameObjects.first()) ;
+				REQUIRE(hitPoint.x() < 2.5f) ;
+			}
+
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("SpatialIndex-HierarchicalRaycast")
+		{
+			// Only the root is indexed, the meshes hang below it like sub-objects of a loaded OBJ file
+			auto root = new GameObject("Root");
+			auto child = new GameObject("Child");
+			auto grandchild = new GameObject("Grandchild");
+			auto dynamicChild = new GameObject("Dynamic");
+			child->addComponent<MeshRenderer>()->setMesh(Mesh::cube());
+			grandchild->addComponent<MeshRenderer>()->setMesh(Mesh::cube());
+			dynamicChild->addComponent<MeshRenderer>()->setMesh(Mesh::cube());
+			child->transform()->setParent(root->transform());
+			grandchild->transform()->setParent(child->transform());
+			dynamicChild->transform()->setParent(root->transform());
+			child->transform()->setPosition(QVector3D(5, 0, 0));
+			grandchild->transform()->setPosition(QVector3D(8, 0, 0));
+			dynamicChild->transform()->setPosition(QVector3D(0, 5, 0));
+			root->markAsStatic();
+			child->markAsStatic();
+			grandchild->markAsStatic();
+			QVector<GameObject*> roots;
+			roots.push_back(root);
+
+			Octree octree(4, 2, 6);
+			LinearOctree linearOctree;
+			LooseOctree looseOctree;
+			DynamicAabbTree tree;
+			StaticBvh bvh;
+			SpatialIndex* indices[] = { &octree, &linearOctree, &looseOctree, &tree, &bvh };
+			Ray3D ray(QVector3D(-5, 0.3f, 0.6f), QVector3D(1, 0, 0));
+			Ray3D back(QVector3D(20, 0.3f, 0.6f), QVector3D(-1, 0, 0));
+			Ray3D down(QVector3D(0.3f, 20, 0.6f), QVector3D(0, -1, 0));
+			for (auto index : indices)
+			{
+				index->initialize(roots);
+				GameObject* gameObject;
+				QVector3D hitPoint;
+				REQUIRE(!index->raycast(ray, gameObject, &hitPoint)) ;
+
+				index->setHierarchical(true);
+				REQUIRE(index->raycast(ray, gameObject, &hitPoint)) ;
+				REQUIRE(gameObject == child) ;
+				REQUIRE(equalsApproximately(hitPoint, QVector3D(5, 0.3f, 0.6f))) ;
+				REQUIRE(index->raycast(back, gameObject, &hitPoint)) ;
+				REQUIRE(gameObject == grandchild) ;
+				REQUIRE(index->raycast(ray, gameObject, &hitPoint, SpatialIndex::AnyHit)) ;
+				REQUIRE((gameObject == child || gameObject == grandchild)) ;
+				REQUIRE(!index->raycast(ray, gameObject, &hitPoint, SpatialIndex::ClosestHit, 9.9f)) ;
+
+				// Dynamic children are roots of the dynamic index, this one doesn't look at them
+				REQUIRE(!index->raycast(down, gameObject, &hitPoint)) ;
+			}
+
+			GameObject::destroy(root);
+		}
+
+		TEST_CASE("SpatialIndex-RaycastBatch")
+		{
+			// Dynamic cubes float in front of a wall of static ones
+			QVector<GameObject*> dynamicObjects;
+			QVector<GameObject*> staticObjects;
+			for (int i = 0; i < 10; i++)
+				for (int j = 0; j < 10; j++)
+				{
+					auto gameObject = new GameObject("Wall");
+					gameObject->addComponent<MeshRenderer>()->setMesh(Mesh::cube());
+					gameObject->transform()->setPosition(QVector3D(i * 2 - 10, j * 2 - 10, 10));
+					gameObject->markAsStatic();
+					staticObjects.push_back(gameObject);
+					if (i % 2 || j % 2)
+						continue;
+					gameObject = new GameObject("Cube");
+					gameObject->addComponent<MeshRenderer>()->setMesh(Mesh::cube());
+					gameObject->transform()->setPosition(QVector3D(i * 2 - 9, j * 2 - 9, 5));
+					dynamicObjects.push_back(gameObject);
+				}
+			DynamicAabbTree tree;
+			StaticBvh bvh;
+			tree.initialize(dynamicObjects);
+			bvh.initialize(staticObjects);
+
+			qsrand(11);
+			QVector<Ray3D> rays;
+			for (int i = 0; i < 1000; i++)
+			{
+				QVector3D origin((qrand() % 100 - 50) / 10.0f, (qrand() % 100 - 50) / 10.0f, -5);
+				QVector3D target((qrand() % 240 - 120) / 10.0f, (qrand() % 240 - 120) / 10.0f, 10.5f);
+				rays.push_back(Ray3D(origin, target - origin));
+			}
+
+			// Batches must find exactly what single rays find, with or without threads
+			TaskPool pool(4);
+			QVector<SpatialIndex::RaycastHit> serial;
+			QVector<SpatialIndex::RaycastHit> parallel;
+			QVector<SpatialIndex::RaycastHit> any;
+			tree.raycastBatch(rays, serial);
+			bvh.raycastBatch(rays, serial, SpatialIndex::ClosestHit, std::numeric_limits<float>::max(), nullptr, true);
+			tree.raycastBatch(rays, parallel, SpatialIndex::ClosestHit, std::numeric_limits<float>::max(), &pool);
+			bvh.raycastBatch(rays, parallel, SpatialIndex::ClosestHit, std::numeric_limits<float>::max(), &pool, true);
+			tree.raycastBatch(rays, any, SpatialIndex::AnyHit, std::numeric_limits<float>::max(), &pool);
+			bvh.raycastBatch(rays, any, SpatialIndex::AnyHit, std::numeric_limits<float>::max(), &pool, true);
+			REQUIRE(serial.count() == rays.count()) ;
+			auto hitCount = 0;
+			for (int i = 0; i < rays.count(); i++)
+			{
+				GameObject* dynamicObject;
+				GameObject* staticObject;
+				QVector3D dynamicPoint, staticPoint;
+				tree.raycast(rays[i], dynamicObject, &dynamicPoint);
+				bvh.raycast(rays[i], staticObject, &staticPoint);
+				auto expected = dynamicObject ? dynamicObject : staticObject;
+				REQUIRE(serial[i].gameObject == expected) ;
+				REQUIRE(parallel[i].gameObject == expected) ;
+				REQUIRE((any[i].gameObject != nullptr) == (expected != nullptr)) ;
+				if (expected)
+				{
+					REQUIRE(equalsApproximately(serial[i].hitPoint, dynamicObject ? dynamicPoint : staticPoint)) ;
+					REQUIRE(equalsApproximately(parallel[i].hitPoint, serial[i].hitPoint)) ;
+					hitCount++;
+				}
+			}
+			REQUIRE(hitCount > 0) ;
+			REQUIRE(hitCount < rays.count()) ;
+
+			// Reused buffer starts over unless told to keep its hits, stale ones must not block anything
+			auto reused = serial;
+			for (auto& hit : reused)
+				hit = { dynamicObjects.first(), QVector3D(), 0 };
+			tree.raycastBatch(rays, reused);
+			bvh.raycastBatch(rays, reused, SpatialIndex::ClosestHit, std::numeric_limits<float>::max(), nullptr, true);
+			for (int i = 0; i < rays.count(); i++)
+				REQUIRE(reused[i].gameObject == serial[i].gameObject) ;
+
+			for (auto gameObject : dynamicObjects + staticObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("SpatialIndex-RaycastBatchBenchmark", "[.benchmark]")
+		{
+			// Sensor fans of many agents over a big static grid
+			const int size = 200;
+			const int agents = 500;
+			const int raysPerAgent = 200;
+			QVector<GameObject*> gameObjects;
+			gameObjects.reserve(size * size);
+			for (int i = 0; i < size; i++)
+				for (int j = 0; j < size; j++)
+				{
+					auto gameObject = new GameObject("Sphere");
+					gameObject->addComponent<MeshRenderer>()->setMesh(Mesh::sphere());
+					gameObject->transform()->setPosition(QVector3D((-size / 2 + i) * 3, (i * 7 + j * 3) % 5, (-size / 2 + j) * 3));
+					gameObject->markAsStatic();
+					gameObjects.push_back(gameObject);
+				}
+			StaticBvh bvh;
+			bvh.initialize(gameObjects);
+
+			// Agents are shuffled, so neighbouring rays of the input don't start anywhere near each other
+			qsrand(3);
+			QVector<Ray3D> rays;
+			rays.reserve(agents * raysPerAgent);
+			for (int i = 0; i < agents * raysPerAgent; i++)
+			{
+				auto agent = qrand() % agents;
+				auto angle = (qrand() % 3600) / 10.0f * 3.14159265f / 180;
+				QVector3D origin((agent % 25 - 12) * 20.0f, 1.5f, (agent / 25 - 10) * 20.0f);
+				rays.push_back(Ray3D(origin, QVector3D(cos(angle), -0.05f, sin(angle))));
+			}
+
+			QElapsedTimer timer;
+			timer.start();
+			auto loopHits = 0;
+			for (const auto& ray : rays)
+			{
+				GameObject* gameObject;
+				QVector3D hitPoint;
+				if (bvh.raycast(ray, gameObject, &hitPoint))
+					loopHits++;
+			}
+			auto loopElapsed = timer.nsecsElapsed();
+
+			QVector<SpatialIndex::RaycastHit> serial;
+			timer.restart();
+			bvh.raycastBatch(rays, serial);
+			auto serialElapsed = timer.nsecsElapsed();
+
+			TaskPool pool(QThread::idealThreadCount());
+			QVector<SpatialIndex::RaycastHit> parallel;
+			timer.restart();
+			bvh.raycastBatch(rays, parallel, SpatialIndex::ClosestHit, std::numeric_limits<float>::max(), &pool);
+			auto parallelElapsed = timer.nsecsElapsed();
+
+			auto batchHits = 0;
+			for (const auto& hit : parallel)
+				if (hit.gameObject)
+					batchHits++;
+			REQUIRE(batchHits == loopHits) ;
+			auto raysPerSecond = [&](qint64 elapsed)
+			{
+				return rays.count() / (elapsed / 1000000000.0) / 1000000.0;
+			};
+			WARN("Loop " << raysPerSecond(loopElapsed) << ", batch " << raysPerSecond(serialElapsed) << ", " << pool.threadCount()
+				<< " threads " << raysPerSecond(parallelElapsed) << " million rays per second");
+
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("SpatialIndex-UpdateBenchmark", "[.benchmark]")
+		{
+			// Small bodies orbiting around the center, like planets and moons driven by RotateAround
+			const int count = 10000;
+			const int frames = 100;
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < count; i++)
+			{
+				auto gameObject = new GameObject("Body");
+				gameObject->transform()->setPosition(QVector3D(10 + i % 100, (i / 100) * 0.5f, 0));
+				gameObjects.push_back(gameObject);
+			}
+
+			Octree octree;
+			DynamicAabbTree tree;
+			SpatialIndex* indices[] = { &octree, &tree };
+			const char* names[] = { "Octree", "DynamicAabbTree" };
+			for (auto index : indices)
+				index->initialize(gameObjects);
+
+			for (int j = 0; j < 2; j++)
+			{
+				int moved = 0;
+				qint64 elapsed = 0;
+				for (int frame = 0; frame < frames; frame++)
+				{
+					for (int i = 0; i < count; i++)
+					{
+						auto angle = (frame + 1) * 0.01f * (1 + i % 7);
+						auto radius = 10 + i % 100;
+						gameObjects[i]->transform()->setPosition(QVector3D(radius * cos(angle), (i / 100) * 0.5f, radius * sin(angle)));
+					}
+					QElapsedTimer timer;
+					timer.start();
+					for (auto gameObject : gameObjects)
+						moved += indices[j]->update(gameObject);
+					elapsed += timer.nsecsElapsed();
+				}
+				WARN(names[j] << ": " << elapsed / 1000000.0 / frames << "ms per frame, " << moved / frames << " moved per frame");
+
+				// Reset positions for the next index
+				for (int i = 0; i < count; i++)
+					gameObjects[i]->transform()->setPosition(QVector3D(10 + i % 100, (i / 100) * 0.5f, 0));
+			}
+
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("SpatialIndex-Reroot")
+		{
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < 20; i++)
+			{
+				auto gameObject = new GameObject("Point");
+				gameObject->transform()->setPosition(QVector3D(i % 3, i % 5, i % 7));
+				gameObjects.push_back(gameObject);
+			}
+
+			Octree octree;
+			LinearOctree linearOctree;
+			LooseOctree looseOctree;
+			SpatialIndex* indices[] = { &octree, &linearOctree, &looseOctree };
+			for (auto index : indices)
+			{
+				index->initialize(gameObjects);
+				REQUIRE(index->outlierStats().outliers == 0) ;
+				REQUIRE(index->outlierStats().gameObjects == gameObjects.count()) ;
+			}
+
+			// A single outlier is fine, too many of them grow the bounds
+			gameObjects[0]->transform()->setPosition(QVector3D(50, 0, 0));
+			for (auto index : indices)
+			{
+				index->update(gameObjects[0]);
+				REQUIRE(index->outlierStats().outliers == 1) ;
+				REQUIRE(index->outlierStats().reroots == 0) ;
+			}
+			for (int i = 1; i < 5; i++)
+				gameObjects[i]->transform()->setPosition(QVector3D(-50, 0, i * 10));
+			for (auto index : indices)
+			{
+				for (int i = 1; i < 5; i++)
+					index->update(gameObjects[i]);
+				REQUIRE(index->outlierStats().outliers == 0) ;
+				REQUIRE(index->outlierStats().reroots == 1) ;
+				REQUIRE(index->outlierStats().gameObjects == gameObjects.count()) ;
+
+				QVector<BoundingBox> nodes;
+				REQUIRE(index->findGameObject(gameObjects[0], nodes)) ;
+			}
+
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("SpatialIndex-MultiFrustum")
+		{
+			const int size = 20;
+			QVector<GameObject*> gameObjects;
+			QVector<GameObject*> statics;
+			for (int i = 0; i < size; i++)
+				for (int j = 0; j < size; j++)
+				{
+					auto gameObject = new GameObject("Point");
+					gameObject->transform()->setPosition(QVector3D((-size / 2 + i) * 2, 0, (-size / 2 + j) * 2));
+					gameObjects.push_back(gameObject);
+					auto staticObject = new GameObject("Static");
+					staticObject->transform()->setPosition(QVector3D((-size / 2 + i) * 2, 1, (-size / 2 + j) * 2));
+					staticObject->markAsStatic();
+					statics.push_back(staticObject);
+				}
+
+			// Three views looking in different directions, the first two overlap
+			QVector3D targets[] = { QVector3D(1, 0, 0), QVector3D(1, 0, 1), QVector3D(-1, 0, 0) };
+			QList<GameObject*> cameras;
+			FrustumSet frustums;
+			for (const auto& target : targets)
+			{
+				auto camera = Camera::create();
+				camera->transform()->lookAt(target);
+				frustums.add(camera->getComponent<Camera>()->frustum().snapshot());
+				cameras.push_back(camera);
+			}
+			REQUIRE(frustums.views() == 7) ;
+
+			Octree octree(4, 2, 8);
+			LinearOctree linearOctree;
+			LooseOctree looseOctree;
+			DynamicAabbTree tree;
+			StaticBvh bvh;
+			SpatialIndex* indices[] = { &octree, &linearOctree, &looseOctree, &tree, &bvh };
+			for (auto index : indices)
+			{
+				index->initialize(index == &bvh ? statics : gameObjects);
+				QList<FrustumSet::Visibility> visible;
+				index->intersect(frustums, visible);
+				QHash<GameObject*, quint32> masks;
+				for (const auto& visibility : visible)
+					masks[visibility.first] |= visibility.second;
+
+				// Every view sees exactly what culling it alone would
+				for (int view = 0; view < frustums.count(); view++)
+				{
+					QList<GameObject*> single;
+					index->intersect(frustums.frustum(view), single);
+					REQUIRE(single.count() > 0) ;
+					QSet<GameObject*> expected = single.toSet();
+					QSet<GameObject*> actual;
+					for (auto it = masks.constBegin(); it != masks.constEnd(); ++it)
+						if (it.value() & (1u << view))
+							actual.insert(it.key());
+					REQUIRE(actual == expected) ;
+				}
+			}
+
+			for (auto camera : cameras)
+				GameObject::destroy(camera);
+			for (auto gameObject : gameObjects + statics)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("SpatialIndex-TemporalCoherence")
+		{
+			const int size = 40;
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < size; i++)
+				for (int j = 0; j < size; j++)
+				{
+					auto gameObject = new GameObject("Point");
+					gameObject->transform()->setPosition(QVector3D((-size / 2 + i) * 2, (i + j) % 3, (-size / 2 + j) * 2));
+					gameObjects.push_back(gameObject);
+				}
+			auto camera = Camera::create();
+
+			// Plane caches and whole subtrees inside the frustum must not change the result while the camera turns
+			Octree octree(4, 2, 8);
+			LinearOctree linearOctree;
+			SpatialIndex* indices[] = { &octree, &linearOctree };
+			for (auto index : indices)
+				index->initialize(gameObjects);
+			for (int frame = 0; frame < 30; frame++)
+			{
+				camera->transform()->lookAt(QVector3D(cos(frame * 0.2f), 0, sin(frame * 0.2f)));
+				auto frustum = camera->getComponent<Camera>()->frustum().snapshot();
+				QSet<GameObject*> expected;
+				for (auto gameObject : gameObjects)
+					if (frustum.intersects(gameObject->boundingBox()))
+						expected.insert(gameObject);
+				for (auto index : indices)
+				{
+					QList<GameObject*> visible;
+					index->intersect(frustum, visible);
+					REQUIRE(visible.toSet() == expected) ;
+				}
+			}
+
+			GameObject::destroy(camera);
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("SpatialIndex-ParallelCulling")
+		{
+			// Grid from the culling demo
+			const int size = 40;
+			QVector<GameObject*> gameObjects;
+			for (int i = 0; i < size; i++)
+				for (int j = 0; j < size; j++)
+				{
+					auto gameObject = new GameObject("Sphere");
+					gameObject->transform()->setPosition(QVector3D((-size / 2 + i) * 2, 0, (-size / 2 + j) * 2));
+					gameObjects.push_back(gameObject);
+				}
+			auto camera = Camera::create();
+			camera->transform()->lookAt(QVector3D(1, 0, 1));
+			auto frustum = camera->getComponent<Camera>()->frustum().snapshot();
+
+			TaskPool pool(4);
+			Octree octree(4, 2, 8);
+			LinearOctree linearOctree;
+			SpatialIndex* indices[] = { &octree, &linearOctree };
+			for (auto index : indices)
+			{
+				index->initialize(gameObjects);
+				QList<GameObject*> serial;
+				index->intersect(frustum, serial);
+				REQUIRE(serial.count() > 0) ;
+				REQUIRE(serial.count() < gameObjects.count()) ;
+				// Same objects in the same order, every time
+				for (int run = 0; run < 10; run++)
+				{
+					QList<GameObject*> parallel;
+					index->intersectParallel(frustum, parallel, pool);
+					REQUIRE(parallel == serial) ;
+				}
+			}
+
+			GameObject::destroy(camera);
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
+
+		TEST_CASE("SpatialIndex-ParallelCullingBenchmark", "[.benchmark]")
+		{
+			// Culling demo grid scaled up to a million objects
+			const int size = 1000;
+			const int frames = 20;
+			QVector<GameObject*> gameObjects;
+			gameObjects.reserve(size * size);
+			for (int i = 0; i < size; i++)
+				for (int j = 0; j < size; j++)
+				{
+					auto gameObject = new GameObject("Sphere");
+					gameObject->transform()->setPosition(QVector3D((-size / 2 + i) * 2, 0, (-size / 2 + j) * 2));
+					gameObjects.push_back(gameObject);
+				}
+			auto camera = Camera::create();
+			auto frustum = camera->getComponent<Camera>()->frustum().snapshot();
+
+			TaskPool pool(QThread::idealThreadCount());
+			Octree octree;
+			LinearOctree linearOctree;
+			SpatialIndex* indices[] = { &octree, &linearOctree };
+			const char* names[] = { "Octree", "LinearOctree" };
+			for (int j = 0; j < 2; j++)
+			{
+				indices[j]->initialize(gameObjects);
+				qint64 serialElapsed = 0;
+				qint64 parallelElapsed = 0;
+				for (int frame = 0; frame < frames; frame++)
+				{
+					camera->transform()->lookAt(QVector3D(cos(frame * 0.3f), 0, sin(frame * 0.3f)));
+					frustum = camera->getComponent<Camera>()->frustum().snapshot();
+
+					QList<GameObject*> serial;
+					QElapsedTimer timer;
+					timer.start();
+					indices[j]->intersect(frustum, serial);
+					serialElapsed += timer.nsecsElapsed();
+
+					QList<GameObject*> parallel;
+					timer.restart();
+					indices[j]->intersectParallel(frustum, parallel, pool);
+					parallelElapsed += timer.nsecsElapsed();
+					REQUIRE(parallel == serial) ;
+				}
+				WARN(names[j] << ": serial " << serialElapsed / 1000000.0 / frames << "ms, " << pool.threadCount() << " threads " << parallelElapsed / 1000000.0 / frames << "ms per frame");
+			}
+
+			GameObject::destroy(camera);
+			for (auto gameObject : gameObjects)
+				GameObject::destroy(gameObject);
+		}
 	}
 }
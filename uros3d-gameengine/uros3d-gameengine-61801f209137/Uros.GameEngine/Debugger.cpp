@@ -1,7 +1,7 @@
 #include "Debugger.h"
 #include "GameObject.h"
 #include "Geometry/Segment3D.h"
-#include "Geometry/OctreeNode.h"
+#include "Geometry/SpatialIndex.h"
 #include "Rendering/RenderingManager.h"
 #include "Scene/Scene.h"
 #include "Scene/Light.h"
@@ -93,14 +93,13 @@ void GameEngine::Debugger::render(const Scene* scene) const
 	QVector<Segment3D> segments(12);
 	if (_octree)
 	{
-		QVector<OctreeNode*> nodes;
-		if (scene->octree().findGameObject(gameObject(), nodes))
+		QVector<BoundingBox> nodes;
+		auto spatialIndex = gameObject()->isStatic() ? scene->staticIndex() : scene->spatialIndex();
+		if (spatialIndex && spatialIndex->findGameObject(gameObject(), nodes))
 		{
 			for (int i = 0; i < nodes.count(); i++)
 			{
-				auto node = nodes[i];
-
-				node->boundingBox().getSegments(segments);
+				nodes[i].getSegments(segments);
 				renderingManager->dbgDrawLines(segments.constData(), segments.count(), Qt::white);
 			}
 		}
@@ -176,6 +176,8 @@ bool GameEngine::GameObject::removeComponent(Component* component)
 
 void GameEngine::GameObject::onTransformChanged(Transform* transform)
 {
-	// Invalidate bounding box
+	// Invalidate bounding box, parents fold children's boxes into their own so theirs are stale as well
 	_bboxValid = false;
+	for (auto parent = _transform->getParent(); parent; parent = parent->getParent())
+		parent->gameObject()->_bboxValid = false;
 }
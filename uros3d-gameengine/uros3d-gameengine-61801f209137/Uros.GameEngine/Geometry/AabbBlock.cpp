@@ -0,0 +1,151 @@
+#include "AabbBlock.h"
+#include "CullingFrustum.h"
+#include "GameObject.h"
+
+#if defined(__AVX__)
+#define SIMD_AVX
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 1
+#define SIMD_SSE
+#include <xmmintrin.h>
+#endif
+
+GameEngine::AabbBlock::AabbBlock()
+{
+	for (auto i = 0; i < Size; i++)
+		_minX[i] = _minY[i] = _minZ[i] = _maxX[i] = _maxY[i] = _maxZ[i] = 0;
+}
+
+GameEngine::BoundingBox GameEngine::AabbBlock::get(int index) const
+{
+	return BoundingBox(QVector3D(_minX[index], _minY[index], _minZ[index]), QVector3D(_maxX[index], _maxY[index], _maxZ[index]));
+}
+
+void GameEngine::AabbBlock::set(int index, const BoundingBox& box)
+{
+	_minX[index] = box.minPoint().x();
+	_minY[index] = box.minPoint().y();
+	_minZ[index] = box.minPoint().z();
+	_maxX[index] = box.maxPoint().x();
+	_maxY[index] = box.maxPoint().y();
+	_maxZ[index] = box.maxPoint().z();
+}
+
+int GameEngine::AabbBlock::intersect(const CullingFrustum& frustum, int count) const
+{
+	const auto& frustumMin = frustum.boundingBox().minPoint();
+	const auto& frustumMax = frustum.boundingBox().maxPoint();
+	auto mask = 0;
+
+#if defined(SIMD_AVX)
+	auto minX = _mm256_loadu_ps(_minX);
+	auto minY = _mm256_loadu_ps(_minY);
+	auto minZ = _mm256_loadu_ps(_minZ);
+	auto maxX = _mm256_loadu_ps(_maxX);
+	auto maxY = _mm256_loadu_ps(_maxY);
+	auto maxZ = _mm256_loadu_ps(_maxZ);
+
+	// Reject everything outside of the frustum's bounding box first
+	auto outside = _mm256_or_ps(_mm256_cmp_ps(minX, _mm256_set1_ps(frustumMax.x()), _CMP_GT_OQ), _mm256_cmp_ps(maxX, _mm256_set1_ps(frustumMin.x()), _CMP_LT_OQ));
+	outside = _mm256_or_ps(outside, _mm256_or_ps(_mm256_cmp_ps(minY, _mm256_set1_ps(frustumMax.y()), _CMP_GT_OQ), _mm256_cmp_ps(maxY, _mm256_set1_ps(frustumMin.y()), _CMP_LT_OQ)));
+	outside = _mm256_or_ps(outside, _mm256_or_ps(_mm256_cmp_ps(minZ, _mm256_set1_ps(frustumMax.z()), _CMP_GT_OQ), _mm256_cmp_ps(maxZ, _mm256_set1_ps(frustumMin.z()), _CMP_LT_OQ)));
+
+	for (auto i = 0; i < 6; i++)
+	{
+		// Box is outside if even its furthest corner along the normal is behind the plane
+		const auto& plane = frustum.plane(i);
+		auto signs = frustum.signMask(i);
+		auto distance = _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(signs & 1 ? maxX : minX, _mm256_set1_ps(plane.x())), _mm256_mul_ps(signs & 2 ? maxY : minY, _mm256_set1_ps(plane.y()))),
+			_mm256_add_ps(_mm256_mul_ps(signs & 4 ? maxZ : minZ, _mm256_set1_ps(plane.z())), _mm256_set1_ps(plane.w())));
+		outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+	}
+	mask = ~_mm256_movemask_ps(outside) & 0xFF;
+#elif defined(SIMD_SSE)
+	for (auto offset = 0; offset < Size; offset += 4)
+	{
+		auto minX = _mm_loadu_ps(_minX + offset);
+		auto minY = _mm_loadu_ps(_minY + offset);
+		auto minZ = _mm_loadu_ps(_minZ + offset);
+		auto maxX = _mm_loadu_ps(_maxX + offset);
+		auto maxY = _mm_loadu_ps(_maxY + offset);
+		auto maxZ = _mm_loadu_ps(_maxZ + offset);
+
+		// Reject everything outside of the frustum's bounding box first
+		auto outside = _mm_or_ps(_mm_cmpgt_ps(minX, _mm_set1_ps(frustumMax.x())), _mm_cmplt_ps(maxX, _mm_set1_ps(frustumMin.x())));
+		outside = _mm_or_ps(outside, _mm_or_ps(_mm_cmpgt_ps(minY, _mm_set1_ps(frustumMax.y())), _mm_cmplt_ps(maxY, _mm_set1_ps(frustumMin.y()))));
+		outside = _mm_or_ps(outside, _mm_or_ps(_mm_cmpgt_ps(minZ, _mm_set1_ps(frustumMax.z())), _mm_cmplt_ps(maxZ, _mm_set1_ps(frustumMin.z()))));
+
+		for (auto i = 0; i < 6; i++)
+		{
+			// Box is outside if even its furthest corner along the normal is behind the plane
+			const auto& plane = frustum.plane(i);
+			auto signs = frustum.signMask(i);
+			auto distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(signs & 1 ? maxX : minX, _mm_set1_ps(plane.x())), _mm_mul_ps(signs & 2 ? maxY : minY, _mm_set1_ps(plane.y()))),
+				_mm_add_ps(_mm_mul_ps(signs & 4 ? maxZ : minZ, _mm_set1_ps(plane.z())), _mm_set1_ps(plane.w())));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+		}
+		mask |= (~_mm_movemask_ps(outside) & 0xF) << offset;
+	}
+#else
+	for (auto j = 0; j < count; j++)
+	{
+		auto outside = _minX[j] > frustumMax.x() || _maxX[j] < frustumMin.x()
+			|| _minY[j] > frustumMax.y() || _maxY[j] < frustumMin.y()
+			|| _minZ[j] > frustumMax.z() || _maxZ[j] < frustumMin.z();
+		for (auto i = 0; i < 6 && !outside; i++)
+		{
+			const auto& plane = frustum.plane(i);
+			auto signs = frustum.signMask(i);
+			outside = plane.x() * (signs & 1 ? _maxX[j] : _minX[j])
+				+ plane.y() * (signs & 2 ? _maxY[j] : _minY[j])
+				+ plane.z() * (signs & 4 ? _maxZ[j] : _minZ[j])
+				+ plane.w() < 0;
+		}
+		if (!outside)
+			mask |= 1 << j;
+	}
+#endif
+
+	return mask & ((1 << count) - 1);
+}
+
+template <class GameObjectItor>
+void GameEngine::AabbBlock::intersect(const CullingFrustum& frustum, GameObjectItor begin, GameObjectItor end, QList<GameObject*>& gameObjects)
+{
+	AabbBlock block;
+	GameObject* blockObjects[Size];
+	auto count = 0;
+	auto flush = [&]()
+	{
+		auto mask = block.intersect(frustum, count);
+		for (auto i = 0; i < count; i++)
+			if (mask & (1 << i))
+				gameObjects.push_back(blockObjects[i]);
+		count = 0;
+	};
+
+	for (auto itor = begin; itor != end; ++itor)
+	{
+		auto gameObject = *itor;
+		if (gameObject->isStatic())
+			continue;
+		block.set(count, gameObject->boundingBox());
+		blockObjects[count++] = gameObject;
+		if (count == Size)
+			flush();
+	}
+	if (count)
+		flush();
+}
+
+void GameEngine::AabbBlock::intersect(const CullingFrustum& frustum, const QSet<GameObject*>& candidates, QList<GameObject*>& gameObjects)
+{
+	intersect(frustum, candidates.constBegin(), candidates.constEnd(), gameObjects);
+}
+
+void GameEngine::AabbBlock::intersect(const CullingFrustum& frustum, const QVector<GameObject*>& candidates, QList<GameObject*>& gameObjects)
+{
+	intersect(frustum, candidates.constBegin(), candidates.constEnd(), gameObjects);
+}
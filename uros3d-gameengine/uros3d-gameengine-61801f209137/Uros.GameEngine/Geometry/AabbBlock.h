@@ -0,0 +1,50 @@
+#pragma once
+#include <QList>
+#include <QSet>
+#include <QVector>
+#include "Includes.h"
+#include "BoundingBox.h"
+
+namespace GameEngine {
+	class GameObject;
+	class CullingFrustum;
+
+	/*
+	Block of bounding boxes stored as separate arrays of coordinates, so a whole block can be tested
+	against the frustum planes at once. Uses AVX or SSE when the compiler targets them, plain loops otherwise.
+	*/
+	class AabbBlock final
+	{
+	public:
+		enum
+		{
+			Size = 8
+		};
+
+		EXPORT AabbBlock();
+		EXPORT BoundingBox get(int index) const;
+		EXPORT void set(int index, const BoundingBox& box);
+		/*
+		Tests first count boxes of the block, returns a mask with a bit set for each box intersecting the frustum.
+		*/
+		EXPORT int intersect(const CullingFrustum& frustum, int count = Size) const;
+
+		/*
+		Tests bounding boxes of specified game objects block by block and adds the visible ones.
+		Static objects are skipped, static hierarchy takes care of them.
+		*/
+		EXPORT static void intersect(const CullingFrustum& frustum, const QSet<GameObject*>& candidates, QList<GameObject*>& gameObjects);
+		EXPORT static void intersect(const CullingFrustum& frustum, const QVector<GameObject*>& candidates, QList<GameObject*>& gameObjects);
+
+	private:
+		template <class GameObjectItor>
+		static void intersect(const CullingFrustum& frustum, GameObjectItor begin, GameObjectItor end, QList<GameObject*>& gameObjects);
+
+		float _minX[Size];
+		float _minY[Size];
+		float _minZ[Size];
+		float _maxX[Size];
+		float _maxY[Size];
+		float _maxZ[Size];
+	};
+}
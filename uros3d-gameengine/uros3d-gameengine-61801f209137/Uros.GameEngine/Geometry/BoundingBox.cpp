@@ -76,6 +76,12 @@ GameEngine::BoundingBox GameEngine::BoundingBox::create(const QList<QVector3D>&
 	return BoundingBox(QVector3D(xMin, yMin, zMin), QVector3D(xMax, yMax, zMax));
 }
 
+GameEngine::BoundingBox GameEngine::BoundingBox::combine(const BoundingBox& a, const BoundingBox& b)
+{
+	return BoundingBox(QVector3D(fmin(a._min.x(), b._min.x()), fmin(a._min.y(), b._min.y()), fmin(a._min.z(), b._min.z())),
+	                   QVector3D(fmax(a._max.x(), b._max.x()), fmax(a._max.y(), b._max.y()), fmax(a._max.z(), b._max.z())));
+}
+
 bool GameEngine::BoundingBox::intersect(const BoundingBox& a, const BoundingBox& b)
 {
 	auto d = a.midPoint() - b.midPoint();
@@ -116,6 +122,11 @@ const QVector3D& GameEngine::BoundingBox::extent() const
 	return _extent;
 }
 
+float GameEngine::BoundingBox::surfaceArea() const
+{
+	return 2 * (_extent.x() * _extent.y() + _extent.y() * _extent.z() + _extent.z() * _extent.x());
+}
+
 void GameEngine::BoundingBox::getVertices(QVector<QVector3D>& vertices) const
 {
 	/*
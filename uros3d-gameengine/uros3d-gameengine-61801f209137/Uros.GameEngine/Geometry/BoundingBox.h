@@ -20,6 +20,7 @@ namespace GameEngine {
 		EXPORT static BoundingBox create(const float* vertices, int count);
 		EXPORT static BoundingBox create(const QVector<QVector3D>& vertices);
 		EXPORT static BoundingBox create(const QList<QVector3D>& vertices);
+		EXPORT static BoundingBox combine(const BoundingBox& a, const BoundingBox& b);
 		EXPORT static bool intersect(const BoundingBox& a, const BoundingBox& b);
 		EXPORT static bool isInsideOf(const BoundingBox& a, const BoundingBox& b);
 		EXPORT static bool isPointInside(const BoundingBox& box, const QVector3D& point);
@@ -28,6 +29,7 @@ namespace GameEngine {
 		EXPORT const QVector3D& maxPoint() const;
 		EXPORT const QVector3D& midPoint() const;
 		EXPORT const QVector3D& extent() const;
+		EXPORT float surfaceArea() const;
 
 		EXPORT void getVertices(QVector<QVector3D>& vertices) const;
 		EXPORT void getSegments(QVector<Segment3D>& segments) const;
@@ -0,0 +1,132 @@
+#include "CullingFrustum.h"
+
+GameEngine::CullingFrustum::CullingFrustum()
+{
+	for (auto i = 0; i < 6; i++)
+		_signMasks[i] = 0;
+}
+
+GameEngine::CullingFrustum::CullingFrustum(const QMatrix4x4& viewProjection)
+{
+	update(viewProjection);
+}
+
+void GameEngine::CullingFrustum::update(const QMatrix4x4& viewProjection)
+{
+	// Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix, Gribb & Hartmann
+	auto x = viewProjection.row(0);
+	auto y = viewProjection.row(1);
+	auto z = viewProjection.row(2);
+	auto w = viewProjection.row(3);
+	_planes[Left] = w + x;
+	_planes[Right] = w - x;
+	_planes[Bottom] = w + y;
+	_planes[Top] = w - y;
+	_planes[Near] = w + z;
+	_planes[Far] = w - z;
+
+	for (auto i = 0; i < 6; i++)
+	{
+		auto& plane = _planes[i];
+		plane /= plane.toVector3D().length();
+		_signMasks[i] = (plane.x() > 0 ? 1 : 0) | (plane.y() > 0 ? 2 : 0) | (plane.z() > 0 ? 4 : 0);
+	}
+
+	// Corners of the clip space cube moved back to world space
+	static const float ndc[8][3] =
+	{
+		{ -1, -1, -1 }, { 1, -1, -1 }, { 1, 1, -1 }, { -1, 1, -1 },
+		{ -1, -1, 1 }, { 1, -1, 1 }, { 1, 1, 1 }, { -1, 1, 1 }
+	};
+	auto inverse = viewProjection.inverted();
+	auto min = QVector3D(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+	auto max = -min;
+	for (auto i = 0; i < 8; i++)
+	{
+		auto corner = inverse * QVector4D(ndc[i][0], ndc[i][1], ndc[i][2], 1);
+		_corners[i] = corner.toVector3D() / corner.w();
+		min = QVector3D(fmin(min.x(), _corners[i].x()), fmin(min.y(), _corners[i].y()), fmin(min.z(), _corners[i].z()));
+		max = QVector3D(fmax(max.x(), _corners[i].x()), fmax(max.y(), _corners[i].y()), fmax(max.z(), _corners[i].z()));
+	}
+	_bbox = BoundingBox(min, max);
+}
+
+const QVector4D& GameEngine::CullingFrustum::plane(int index) const
+{
+	return _planes[index];
+}
+
+int GameEngine::CullingFrustum::signMask(int index) const
+{
+	return _signMasks[index];
+}
+
+const QVector3D& GameEngine::CullingFrustum::corner(int index) const
+{
+	return _corners[index];
+}
+
+const GameEngine::BoundingBox& GameEngine::CullingFrustum::boundingBox() const
+{
+	return _bbox;
+}
+
+bool GameEngine::CullingFrustum::intersects(const BoundingBox& box) const
+{
+	const auto& min = box.minPoint();
+	const auto& max = box.maxPoint();
+	if (min.x() > _bbox.maxPoint().x() || max.x() < _bbox.minPoint().x()
+		|| min.y() > _bbox.maxPoint().y() || max.y() < _bbox.minPoint().y()
+		|| min.z() > _bbox.maxPoint().z() || max.z() < _bbox.minPoint().z())
+		return false;
+
+	for (auto i = 0; i < 6; i++)
+	{
+		// Box is outside if even its furthest corner along the normal is behind the plane
+		const auto& plane = _planes[i];
+		auto mask = _signMasks[i];
+		auto distance = plane.x() * (mask & 1 ? max.x() : min.x())
+			+ plane.y() * (mask & 2 ? max.y() : min.y())
+			+ plane.z() * (mask & 4 ? max.z() : min.z())
+			+ plane.w();
+		if (distance < 0)
+			return false;
+	}
+	return true;
+}
+
+GameEngine::CullingFrustum::Containment GameEngine::CullingFrustum::classify(const BoundingBox& box, int& lastPlane) const
+{
+	const auto& min = box.minPoint();
+	const auto& max = box.maxPoint();
+	auto distance = [&](int i, bool furthest)
+	{
+		const auto& plane = _planes[i];
+		auto mask = furthest ? _signMasks[i] : ~_signMasks[i];
+		return plane.x() * (mask & 1 ? max.x() : min.x())
+			+ plane.y() * (mask & 2 ? max.y() : min.y())
+			+ plane.z() * (mask & 4 ? max.z() : min.z())
+			+ plane.w();
+	};
+
+	// Whatever rejected the box last frame most likely rejects it again
+	if (distance(lastPlane, true) < 0)
+		return Outside;
+	if (min.x() > _bbox.maxPoint().x() || max.x() < _bbox.minPoint().x()
+		|| min.y() > _bbox.maxPoint().y() || max.y() < _bbox.minPoint().y()
+		|| min.z() > _bbox.maxPoint().z() || max.z() < _bbox.minPoint().z())
+		return Outside;
+
+	// Box is inside if even its nearest corner along every normal is in front of the plane
+	auto inside = true;
+	for (auto i = 0; i < 6; i++)
+	{
+		if (i != lastPlane && distance(i, true) < 0)
+		{
+			lastPlane = i;
+			return Outside;
+		}
+		inside = inside && distance(i, false) >= 0;
+	}
+	return inside ? Inside : Intersecting;
+}
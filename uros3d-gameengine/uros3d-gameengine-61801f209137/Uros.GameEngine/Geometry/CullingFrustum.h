@@ -0,0 +1,64 @@
+#pragma once
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+#include "Includes.h"
+#include "BoundingBox.h"
+
+namespace GameEngine {
+	/*
+	Snapshot of a view frustum taken once per frame from the view-projection matrix. Planes are extracted
+	directly from the matrix (Gribb-Hartmann) with normals pointing inside. For each plane the sign mask
+	tells which corner of a box is the furthest along the normal, so testing a box is just 6 dot products.
+	Everything is stored inline, testing against the snapshot never allocates.
+	*/
+	class CullingFrustum final
+	{
+	public:
+		enum PlaneType
+		{
+			Left = 0,
+			Right,
+			Bottom,
+			Top,
+			Near,
+			Far
+		};
+		enum Containment
+		{
+			Outside,
+			Intersecting,
+			Inside
+		};
+
+		EXPORT CullingFrustum();
+		EXPORT explicit CullingFrustum(const QMatrix4x4& viewProjection);
+
+		/*
+		Recomputes the snapshot from specified view-projection matrix.
+		*/
+		EXPORT void update(const QMatrix4x4& viewProjection);
+		/*
+		Returns plane as (normal, distance), a point is inside if dot(normal, point) + distance >= 0.
+		*/
+		EXPORT const QVector4D& plane(int index) const;
+		EXPORT int signMask(int index) const;
+		/*
+		Corners in the same order as CameraFrustum::getCorners, near plane first.
+		*/
+		EXPORT const QVector3D& corner(int index) const;
+		EXPORT const BoundingBox& boundingBox() const;
+		EXPORT bool intersects(const BoundingBox& box) const;
+		/*
+		Tells whether the box is outside, partially or completely inside the frustum. Plane stored in lastPlane is
+		tested first and receives the plane which rejected the box, so coherent queries usually need just one test.
+		*/
+		EXPORT Containment classify(const BoundingBox& box, int& lastPlane) const;
+
+	private:
+		QVector4D _planes[6];
+		int _signMasks[6]; // Bit set if the normal points along the positive axis
+		QVector3D _corners[8];
+		BoundingBox _bbox;
+	};
+}
@@ -0,0 +1,402 @@
+#include <QTime>
+#include <QVarLengthArray>
+#include "DynamicAabbTree.h"
+#include "Ray3D.h"
+#include "CullingFrustum.h"
+#include "Intersect.h"
+#include "GameObject.h"
+
+#define MIN_MARGIN 0.05f
+
+GameEngine::DynamicAabbTree::DynamicAabbTree(float margin)
+	: _root(-1),
+	  _freeList(-1),
+	  _margin(margin),
+	  _initialized(false)
+{
+	if (_margin < 0)
+		throw std::logic_error("DynamicAabbTree::DynamicAabbTree: Margin can't be negative.");
+}
+
+GameEngine::DynamicAabbTree::~DynamicAabbTree() {}
+
+bool GameEngine::DynamicAabbTree::findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const
+{
+	auto it = _leaves.constFind(gameObject);
+	if (it != _leaves.constEnd())
+	{
+		nodes.clear();
+		nodes.push_back(_nodes[*it].bbox);
+		return true;
+	}
+	return false;
+}
+
+bool GameEngine::DynamicAabbTree::raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode, float maxDistance) const
+{
+	// Nearer child is visited first and subtrees behind the best hit so far are skipped
+	gameObject = nullptr;
+	auto tHit = maxDistance;
+	QVarLengthArray<QPair<int, float>, 64> stack;
+	float t;
+	if (_root != -1 && Intersect::rayAndAABB(ray, _nodes[_root].bbox, &t) && t < tHit)
+		stack.push_back(qMakePair(_root, t));
+	while (!stack.isEmpty())
+	{
+		auto entry = stack.last();
+		stack.pop_back();
+		if (entry.second >= tHit)
+			continue;
+
+		const auto& node = _nodes[entry.first];
+		if (node.isLeaf())
+		{
+			if (!Intersect::rayAndAABB(ray, node.gameObject->boundingBox(), &t) || t >= tHit)
+				continue;
+			if (auto hit = raycastGameObject(ray, node.gameObject, mode, tHit, &t))
+			{
+				tHit = t;
+				gameObject = hit;
+				if (mode == AnyHit)
+					break;
+			}
+			continue;
+		}
+
+		float tLeft, tRight;
+		auto hitsLeft = Intersect::rayAndAABB(ray, _nodes[node.left].bbox, &tLeft) && tLeft < tHit;
+		auto hitsRight = Intersect::rayAndAABB(ray, _nodes[node.right].bbox, &tRight) && tRight < tHit;
+		if (hitsLeft && hitsRight && tLeft < tRight)
+		{
+			stack.push_back(qMakePair(node.right, tRight));
+			stack.push_back(qMakePair(node.left, tLeft));
+		}
+		else
+		{
+			if (hitsLeft)
+				stack.push_back(qMakePair(node.left, tLeft));
+			if (hitsRight)
+				stack.push_back(qMakePair(node.right, tRight));
+		}
+	}
+	if (gameObject && hitPoint)
+		*hitPoint = ray.origin() + ray.direction() * tHit;
+	return gameObject;
+}
+
+void GameEngine::DynamicAabbTree::intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const
+{
+	if (_root != -1)
+		intersectNode(_root, frustum, gameObjects);
+}
+
+void GameEngine::DynamicAabbTree::intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const
+{
+	if (_root != -1)
+		intersectNode(_root, frustums, frustums.views(), gameObjects);
+}
+
+void GameEngine::DynamicAabbTree::add(GameObject* gameObject)
+{
+	if (!_initialized)
+		return;
+	auto leaf = allocateNode();
+	_nodes[leaf].bbox = fatten(gameObject->boundingBox());
+	_nodes[leaf].gameObject = gameObject;
+	insertLeaf(leaf);
+	_leaves.insert(gameObject, leaf);
+}
+
+void GameEngine::DynamicAabbTree::remove(GameObject* gameObject)
+{
+	if (!_initialized)
+		return;
+	auto it = _leaves.find(gameObject);
+	if (it == _leaves.end())
+		return;
+	removeLeaf(*it);
+	freeNode(*it);
+	_leaves.erase(it);
+}
+
+bool GameEngine::DynamicAabbTree::update(GameObject* gameObject)
+{
+	if (!_initialized)
+		return false;
+	auto it = _leaves.constFind(gameObject);
+	if (it == _leaves.constEnd())
+		return false;
+
+	// Still inside of the fattened bounds, nothing to do
+	const auto& box = gameObject->boundingBox();
+	if (BoundingBox::isInsideOf(box, _nodes[*it].bbox))
+		return false;
+
+	removeLeaf(*it);
+	_nodes[*it].bbox = fatten(box);
+	insertLeaf(*it);
+	return true;
+}
+
+void GameEngine::DynamicAabbTree::initialize(const QVector<GameObject*>& gameObjects)
+{
+	if (_initialized)
+	{
+		ERROR_LOG("> DynamicAabbTree::initialize: Tree is already initialized.");
+		return;
+	}
+
+	QTime timer;
+	timer.start();
+
+	_initialized = true;
+	_nodes.reserve(2 * gameObjects.count());
+	_leaves.reserve(gameObjects.count());
+	for (auto gameObject : gameObjects)
+		add(gameObject);
+
+	DEBUG_LOG("> DynamicAabbTree::initialize: took " << timer.elapsed() / 1000.0f << "s, " << nodeCount() << " nodes, height " << height());
+}
+
+GameEngine::SpatialIndex::OutlierStats GameEngine::DynamicAabbTree::outlierStats() const
+{
+	// The tree has no fixed bounds, so there are never any outliers
+	OutlierStats stats = { 0, _leaves.count(), 0 };
+	return stats;
+}
+
+int GameEngine::DynamicAabbTree::nodeCount() const
+{
+	return _leaves.isEmpty() ? 0 : 2 * _leaves.count() - 1;
+}
+
+int GameEngine::DynamicAabbTree::height() const
+{
+	return _root == -1 ? 0 : _nodes[_root].height;
+}
+
+int GameEngine::DynamicAabbTree::allocateNode()
+{
+	int index;
+	if (_freeList == -1)
+	{
+		index = _nodes.count();
+		_nodes.push_back(Node());
+	}
+	else
+	{
+		index = _freeList;
+		_freeList = _nodes[index].parent;
+	}
+
+	auto& node = _nodes[index];
+	node.gameObject = nullptr;
+	node.parent = -1;
+	node.left = -1;
+	node.right = -1;
+	node.height = 0;
+	return index;
+}
+
+void GameEngine::DynamicAabbTree::freeNode(int node)
+{
+	_nodes[node].gameObject = nullptr;
+	_nodes[node].height = -1;
+	_nodes[node].parent = _freeList;
+	_freeList = node;
+}
+
+void GameEngine::DynamicAabbTree::insertLeaf(int leaf)
+{
+	if (_root == -1)
+	{
+		_root = leaf;
+		_nodes[leaf].parent = -1;
+		return;
+	}
+
+	// Walk down to the sibling which makes the tree grow the least
+	auto leafBox = _nodes[leaf].bbox;
+	auto index = _root;
+	while (!_nodes[index].isLeaf())
+	{
+		const auto& node = _nodes[index];
+		auto combinedArea = BoundingBox::combine(node.bbox, leafBox).surfaceArea();
+		// Cost of making a new parent for this node and the leaf
+		auto cost = 2 * combinedArea;
+		// Cost which every node below pays because this node grows
+		auto inheritanceCost = 2 * (combinedArea - node.bbox.surfaceArea());
+
+		float childCost[2];
+		int children[2] = { node.left, node.right };
+		for (auto i = 0; i < 2; i++)
+		{
+			const auto& child = _nodes[children[i]];
+			childCost[i] = BoundingBox::combine(child.bbox, leafBox).surfaceArea() + inheritanceCost;
+			if (!child.isLeaf())
+				childCost[i] -= child.bbox.surfaceArea();
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+
+	auto sibling = index;
+	auto oldParent = _nodes[sibling].parent;
+	auto newParent = allocateNode();
+	_nodes[newParent].parent = oldParent;
+	_nodes[newParent].bbox = BoundingBox::combine(leafBox, _nodes[sibling].bbox);
+	_nodes[newParent].height = _nodes[sibling].height + 1;
+	_nodes[newParent].left = sibling;
+	_nodes[newParent].right = leaf;
+	_nodes[sibling].parent = newParent;
+	_nodes[leaf].parent = newParent;
+
+	if (oldParent == -1)
+		_root = newParent;
+	else if (_nodes[oldParent].left == sibling)
+		_nodes[oldParent].left = newParent;
+	else
+		_nodes[oldParent].right = newParent;
+
+	// Fix heights and bounds on the way up
+	for (auto i = _nodes[leaf].parent; i != -1; i = _nodes[i].parent)
+	{
+		i = balance(i);
+		auto& node = _nodes[i];
+		node.height = 1 + qMax(_nodes[node.left].height, _nodes[node.right].height);
+		node.bbox = BoundingBox::combine(_nodes[node.left].bbox, _nodes[node.right].bbox);
+	}
+}
+
+void GameEngine::DynamicAabbTree::removeLeaf(int leaf)
+{
+	if (leaf == _root)
+	{
+		_root = -1;
+		return;
+	}
+
+	auto parent = _nodes[leaf].parent;
+	auto grandParent = _nodes[parent].parent;
+	auto sibling = _nodes[parent].left == leaf ? _nodes[parent].right : _nodes[parent].left;
+	freeNode(parent);
+
+	// Sibling takes the place of the parent
+	_nodes[sibling].parent = grandParent;
+	if (grandParent == -1)
+	{
+		_root = sibling;
+		return;
+	}
+	if (_nodes[grandParent].left == parent)
+		_nodes[grandParent].left = sibling;
+	else
+		_nodes[grandParent].right = sibling;
+
+	for (auto i = grandParent; i != -1; i = _nodes[i].parent)
+	{
+		i = balance(i);
+		auto& node = _nodes[i];
+		node.height = 1 + qMax(_nodes[node.left].height, _nodes[node.right].height);
+		node.bbox = BoundingBox::combine(_nodes[node.left].bbox, _nodes[node.right].bbox);
+	}
+}
+
+int GameEngine::DynamicAabbTree::balance(int node)
+{
+	const auto& a = _nodes[node];
+	if (a.isLeaf() || a.height < 2)
+		return node;
+
+	auto difference = _nodes[a.right].height - _nodes[a.left].height;
+	if (difference > 1)
+		return rotate(node, a.right);
+	if (difference < -1)
+		return rotate(node, a.left);
+	return node;
+}
+
+int GameEngine::DynamicAabbTree::rotate(int node, int child)
+{
+	// Child takes the place of the node and the node becomes its left child
+	auto& a = _nodes[node];
+	auto& c = _nodes[child];
+	auto childIsLeft = a.left == child;
+	auto other = childIsLeft ? a.right : a.left;
+	auto f = c.left;
+	auto g = c.right;
+
+	c.left = node;
+	c.parent = a.parent;
+	a.parent = child;
+	if (c.parent == -1)
+		_root = child;
+	else if (_nodes[c.parent].left == node)
+		_nodes[c.parent].left = child;
+	else
+		_nodes[c.parent].right = child;
+
+	// Taller grandchild stays with the child, the shorter one goes down in its place
+	if (_nodes[f].height < _nodes[g].height)
+		std::swap(f, g);
+	c.right = f;
+	if (childIsLeft)
+		a.left = g;
+	else
+		a.right = g;
+	_nodes[g].parent = node;
+
+	a.bbox = BoundingBox::combine(_nodes[other].bbox, _nodes[g].bbox);
+	a.height = 1 + qMax(_nodes[other].height, _nodes[g].height);
+	c.bbox = BoundingBox::combine(a.bbox, _nodes[f].bbox);
+	c.height = 1 + qMax(a.height, _nodes[f].height);
+	return child;
+}
+
+GameEngine::BoundingBox GameEngine::DynamicAabbTree::fatten(const BoundingBox& box) const
+{
+	const auto& extent = box.extent();
+	auto margin = fmax(MIN_MARGIN, _margin * fmax(extent.z(), fmax(extent.x(), extent.y())));
+	auto offset = QVector3D(margin, margin, margin);
+	return BoundingBox(box.minPoint() - offset, box.maxPoint() + offset);
+}
+
+void GameEngine::DynamicAabbTree::intersectNode(int node, const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const
+{
+	const auto& n = _nodes[node];
+	if (n.isLeaf())
+	{
+		// Leaves are tested with the real bounds, the fattened ones would let too much through
+		const auto& box = n.gameObject->boundingBox();
+		if (!n.gameObject->isStatic() && frustum.intersects(box))
+			gameObjects.push_back(n.gameObject);
+		return;
+	}
+
+	if (!frustum.intersects(n.bbox))
+		return;
+	intersectNode(n.left, frustum, gameObjects);
+	intersectNode(n.right, frustum, gameObjects);
+}
+
+void GameEngine::DynamicAabbTree::intersectNode(int node, const FrustumSet& frustums, quint32 views, QList<FrustumSet::Visibility>& gameObjects) const
+{
+	const auto& n = _nodes[node];
+	if (n.isLeaf())
+	{
+		if (n.gameObject->isStatic())
+			return;
+		views = frustums.intersects(n.gameObject->boundingBox(), views);
+		if (views)
+			gameObjects.push_back(qMakePair(n.gameObject, views));
+		return;
+	}
+
+	views = frustums.intersects(n.bbox, views);
+	if (!views)
+		return;
+	intersectNode(n.left, frustums, views, gameObjects);
+	intersectNode(n.right, frustums, views, gameObjects);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <QHash>
+#include <QVector>
+#include "Includes.h"
+#include "SpatialIndex.h"
+
+namespace GameEngine {
+	/*
+	Dynamic bounding volume tree. Every game object is a leaf with a fattened bounding box, so objects moving
+	by small amounts don't touch the tree at all. Leaves are inserted next to the sibling which grows the
+	total surface area the least and the tree is kept balanced with rotations on the way back to the root.
+	*/
+	class DynamicAabbTree final : public SpatialIndex
+	{
+		NOCOPY(DynamicAabbTree)
+
+	public:
+		EXPORT explicit DynamicAabbTree(float margin = 0.1f);
+		EXPORT ~DynamicAabbTree();
+		EXPORT bool findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const override;
+		EXPORT bool raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode = ClosestHit,
+		                    float maxDistance = std::numeric_limits<float>::max()) const override;
+		EXPORT void intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const override;
+		EXPORT void intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const override;
+		EXPORT void add(GameObject* gameObject) override;
+		EXPORT void remove(GameObject* gameObject) override;
+		EXPORT bool update(GameObject* gameObject) override;
+		EXPORT void initialize(const QVector<GameObject*>& gameObjects) override;
+		EXPORT OutlierStats outlierStats() const override;
+		EXPORT int nodeCount() const;
+		EXPORT int height() const;
+
+	private:
+		struct Node
+		{
+			BoundingBox bbox; // Fattened bounds for leaves
+			GameObject* gameObject;
+			int parent; // Next free node while the node is unused
+			int left;
+			int right;
+			int height; // 0 for leaves, -1 for unused nodes
+
+			bool isLeaf() const
+			{
+				return left == -1;
+			}
+		};
+
+		int allocateNode();
+		void freeNode(int node);
+		void insertLeaf(int leaf);
+		void removeLeaf(int leaf);
+		int balance(int node);
+		int rotate(int node, int child);
+		BoundingBox fatten(const BoundingBox& box) const;
+		void intersectNode(int node, const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const;
+		void intersectNode(int node, const FrustumSet& frustums, quint32 views, QList<FrustumSet::Visibility>& gameObjects) const;
+
+		QVector<Node> _nodes;
+		QHash<GameObject*, int> _leaves;
+		int _root;
+		int _freeList;
+		float _margin;
+		bool _initialized;
+	};
+}
@@ -0,0 +1,96 @@
+#include "FrustumSet.h"
+#include "AabbBlock.h"
+#include "GameObject.h"
+
+GameEngine::FrustumSet::FrustumSet() {}
+
+int GameEngine::FrustumSet::count() const
+{
+	return _frustums.count();
+}
+
+quint32 GameEngine::FrustumSet::views() const
+{
+	return _frustums.count() == MaxCount ? 0xFFFFFFFFu : (1u << _frustums.count()) - 1;
+}
+
+const GameEngine::CullingFrustum& GameEngine::FrustumSet::frustum(int view) const
+{
+	return _frustums[view];
+}
+
+int GameEngine::FrustumSet::add(const CullingFrustum& frustum)
+{
+	if (_frustums.count() == MaxCount)
+		throw std::logic_error("FrustumSet::add: Frustum set is full.");
+	_frustums.push_back(frustum);
+	return _frustums.count() - 1;
+}
+
+void GameEngine::FrustumSet::clear()
+{
+	_frustums.clear();
+}
+
+quint32 GameEngine::FrustumSet::intersects(const BoundingBox& box, quint32 views) const
+{
+	auto visible = 0u;
+	for (auto i = 0; i < _frustums.count(); i++)
+		if ((views & (1u << i)) && _frustums[i].intersects(box))
+			visible |= 1u << i;
+	return visible;
+}
+
+void GameEngine::FrustumSet::intersect(const AabbBlock& block, int count, quint32 views, quint32* masks) const
+{
+	for (auto j = 0; j < count; j++)
+		masks[j] = 0;
+	for (auto i = 0; i < _frustums.count(); i++)
+		if (views & (1u << i))
+		{
+			auto visible = block.intersect(_frustums[i], count);
+			for (auto j = 0; j < count; j++)
+				if (visible & (1 << j))
+					masks[j] |= 1u << i;
+		}
+}
+
+template <class GameObjectItor>
+void GameEngine::FrustumSet::intersect(GameObjectItor begin, GameObjectItor end, quint32 views, QList<Visibility>& gameObjects) const
+{
+	AabbBlock block;
+	GameObject* blockObjects[AabbBlock::Size];
+	quint32 masks[AabbBlock::Size];
+	auto count = 0;
+	auto flush = [&]()
+	{
+		intersect(block, count, views, masks);
+		for (auto i = 0; i < count; i++)
+			if (masks[i])
+				gameObjects.push_back(qMakePair(blockObjects[i], masks[i]));
+		count = 0;
+	};
+
+	for (auto itor = begin; itor != end; ++itor)
+	{
+		auto gameObject = *itor;
+		if (gameObject->isStatic())
+			continue;
+		block.set(count, gameObject->boundingBox());
+		blockObjects[count++] = gameObject;
+		if (count == AabbBlock::Size)
+			flush();
+	}
+	if (count)
+		flush();
+}
+
+void GameEngine::FrustumSet::intersect(const QSet<GameObject*>& candidates, quint32 views, QList<Visibility>& gameObjects) const
+{
+	intersect(candidates.constBegin(), candidates.constEnd(), views, gameObjects);
+}
+
+void GameEngine::FrustumSet::intersect(const QVector<GameObject*>& candidates, quint32 views, QList<Visibility>& gameObjects) const
+{
+	intersect(candidates.constBegin(), candidates.constEnd(), views, gameObjects);
+}
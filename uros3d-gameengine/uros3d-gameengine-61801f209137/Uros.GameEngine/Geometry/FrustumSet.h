@@ -0,0 +1,60 @@
+#pragma once
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+#include "Includes.h"
+#include "CullingFrustum.h"
+
+namespace GameEngine {
+	class GameObject;
+	class AabbBlock;
+
+	/*
+	Frustums of several views culled together in one traversal. Views are identified by bits, every node is
+	tested only against the views which saw its parent, so views which lost sight of a subtree cost nothing
+	below it. Culling results carry a mask of the views each object is visible in.
+	*/
+	class FrustumSet final
+	{
+	public:
+		enum
+		{
+			MaxCount = 32
+		};
+		typedef QPair<GameObject*, quint32> Visibility;
+
+		EXPORT FrustumSet();
+		EXPORT int count() const;
+		/*
+		Mask with a bit set for every view in the set.
+		*/
+		EXPORT quint32 views() const;
+		EXPORT const CullingFrustum& frustum(int view) const;
+		/*
+		Adds a view and returns its index, the set holds at most MaxCount views.
+		*/
+		EXPORT int add(const CullingFrustum& frustum);
+		EXPORT void clear();
+		/*
+		Returns the specified views whose frustums intersect the box.
+		*/
+		EXPORT quint32 intersects(const BoundingBox& box, quint32 views) const;
+		/*
+		Tests first count boxes of the block against specified views, masks receive the views each box is visible in.
+		*/
+		EXPORT void intersect(const AabbBlock& block, int count, quint32 views, quint32* masks) const;
+		/*
+		Tests bounding boxes of specified game objects and adds those visible in at least one of the views.
+		Static objects are skipped, static hierarchy takes care of them.
+		*/
+		EXPORT void intersect(const QSet<GameObject*>& candidates, quint32 views, QList<Visibility>& gameObjects) const;
+		EXPORT void intersect(const QVector<GameObject*>& candidates, quint32 views, QList<Visibility>& gameObjects) const;
+
+	private:
+		template <class GameObjectItor>
+		void intersect(GameObjectItor begin, GameObjectItor end, quint32 views, QList<Visibility>& gameObjects) const;
+
+		QVector<CullingFrustum> _frustums;
+	};
+}
@@ -70,56 +70,12 @@ bool GameEngine::Intersect::triangleAndAABB(const QVector3D& a, const QVector3D&
 
 bool GameEngine::Intersect::frustumAndAABB(const CameraFrustum& frustum, const BoundingBox& box)
 {
-	// From Geometric Approach - Testing Boxes II at
-	// http://zach.in.tu-clausthal.de/teaching/cg_literatur/lighthouse3d_view_frustum_culling/index.html
-
-	QVector3D n, p;
-	QVector<Plane3D> planes(6);
-
-	frustum.getPlanes(planes);
-	auto min = box.minPoint();
-	auto max = box.maxPoint();
-
-	for (int i = 0; i < 6; i++)
-	{
-		// X axis 
-		if (planes[i].normal().x() > 0)
-		{
-			n.setX(min.x());
-			p.setX(max.x());
-		}
-		else
-		{
-			n.setX(max.x());
-			p.setX(min.x());
-		}
-		// Y axis 
-		if (planes[i].normal().y() > 0)
-		{
-			n.setY(min.y());
-			p.setY(max.y());
-		}
-		else
-		{
-			n.setY(max.y());
-			p.setY(min.y());
-		}
-		// Z axis 
-		if (planes[i].normal().z() > 0)
-		{
-			n.setZ(min.z());
-			p.setZ(max.z());
-		}
-		else
-		{
-			n.setZ(max.z());
-			p.setZ(min.z());
-		}
+	return frustum.snapshot().intersects(box);
+}
 
-		if (planes[i].signedDistanceToPoint(n) > 0)
-			return false;
-	}
-	return true;
+bool GameEngine::Intersect::frustumAndAABB(const CullingFrustum& frustum, const BoundingBox& box)
+{
+	return frustum.intersects(box);
 }
 
 bool GameEngine::Intersect::rayAndAABB(const Ray3D& ray, const BoundingBox& box, float* t)
@@ -6,6 +6,7 @@ namespace GameEngine {
 	class Ray3D;
 	class BoundingBox;
 	class CameraFrustum;
+	class CullingFrustum;
 	class Intersect final
 	{
 		NOCOPY(Intersect)
@@ -15,7 +16,8 @@ namespace GameEngine {
 	public:
 		static bool aabbAndAABB(const BoundingBox& box1, const BoundingBox& box2);
 		static bool triangleAndAABB(const QVector3D& a, const QVector3D& b, const QVector3D& c, const BoundingBox& box);
-		static bool frustumAndAABB(const CameraFrustum& frustum, const BoundingBox& box);
+		EXPORT static bool frustumAndAABB(const CameraFrustum& frustum, const BoundingBox& box);
+		EXPORT static bool frustumAndAABB(const CullingFrustum& frustum, const BoundingBox& box);
 		static bool rayAndAABB(const Ray3D& ray, const BoundingBox& box, float* t);
 		static bool rayAndTriangle(const Ray3D& ray, const QVector3D& a, const QVector3D& b, const QVector3D& c, float* t);
 
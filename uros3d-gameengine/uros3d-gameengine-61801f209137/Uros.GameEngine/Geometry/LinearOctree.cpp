@@ -0,0 +1,469 @@
+#include <QTime>
+#include "LinearOctree.h"
+#include "Morton.h"
+#include "Ray3D.h"
+#include "CullingFrustum.h"
+#include "AabbBlock.h"
+#include "TaskPool.h"
+#include "Intersect.h"
+#include "GameObject.h"
+
+#define MAX_LEVEL 10
+#define MAX_LEAF_SIZE 8
+#define MIN_REBUILD_COUNT 32
+#define TASKS_PER_THREAD 4
+
+GameEngine::LinearOctree::LinearOctree()
+	: _size(0),
+	  _removed(0),
+	  _reroots(0),
+	  _initialized(false) {}
+
+GameEngine::LinearOctree::~LinearOctree() {}
+
+bool GameEngine::LinearOctree::findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const
+{
+	auto it = _indices.constFind(gameObject);
+	if (it != _indices.constEnd())
+	{
+		nodes.clear();
+		nodes.push_back(_nodes[_entries[*it].leaf].bbox);
+		return true;
+	}
+	return false;
+}
+
+bool GameEngine::LinearOctree::raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode, float maxDistance) const
+{
+	RaycastCandidates candidates;
+	if (!_nodes.isEmpty())
+		raycastNode(0, ray, maxDistance, candidates);
+	// Objects which are not in the arrays yet
+	for (auto gObject : _pending)
+	{
+		float t;
+		if (Intersect::rayAndAABB(ray, gObject->boundingBox(), &t) && t < maxDistance)
+			candidates.push_back(qMakePair(t, gObject));
+	}
+	for (auto gObject : _outliers)
+	{
+		float t;
+		if (Intersect::rayAndAABB(ray, gObject->boundingBox(), &t) && t < maxDistance)
+			candidates.push_back(qMakePair(t, gObject));
+	}
+	gameObject = raycastCandidates(ray, candidates, mode, maxDistance, hitPoint);
+	return gameObject;
+}
+
+void GameEngine::LinearOctree::intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const
+{
+	if (!_nodes.isEmpty())
+		intersectNode(0, frustum, gameObjects);
+	AabbBlock::intersect(frustum, _pending, gameObjects);
+	AabbBlock::intersect(frustum, _outliers, gameObjects);
+}
+
+void GameEngine::LinearOctree::intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const
+{
+	if (!_nodes.isEmpty())
+		intersectNode(0, frustums, frustums.views(), gameObjects);
+	frustums.intersect(_pending, frustums.views(), gameObjects);
+	frustums.intersect(_outliers, frustums.views(), gameObjects);
+}
+
+void GameEngine::LinearOctree::intersectParallel(const CullingFrustum& frustum, QList<GameObject*>& gameObjects, TaskPool& pool) const
+{
+	// Children are stored next to each other, so replacing a node with its child range keeps the serial order
+	QVector<int> subtrees;
+	if (!_nodes.isEmpty())
+		subtrees.push_back(0);
+	auto expanded = true;
+	while (expanded && subtrees.count() < pool.threadCount() * TASKS_PER_THREAD)
+	{
+		expanded = false;
+		QVector<int> next;
+		for (auto node : subtrees)
+		{
+			const auto& n = _nodes[node];
+			if (n.childCount == 0)
+				next.push_back(node);
+			else if (frustum.intersects(n.bbox))
+			{
+				for (auto i = n.firstChild; i < n.firstChild + n.childCount; i++)
+					next.push_back(i);
+				expanded = true;
+			}
+		}
+		subtrees = next;
+	}
+
+	QVector<CullingTask> tasks;
+	for (auto node : subtrees)
+		tasks.push_back([this, node, &frustum](QList<GameObject*>& visible)
+		{
+			intersectNode(node, frustum, visible);
+		});
+	tasks.push_back([this, &frustum](QList<GameObject*>& visible)
+	{
+		AabbBlock::intersect(frustum, _pending, visible);
+		AabbBlock::intersect(frustum, _outliers, visible);
+	});
+	runCullingTasks(tasks, gameObjects, pool);
+}
+
+void GameEngine::LinearOctree::add(GameObject* gameObject)
+{
+	if (!_initialized)
+		return;
+	quint32 code;
+	if (encode(gameObject->boundingBox().midPoint(), &code))
+	{
+		_pending.push_back(gameObject);
+		rebuildIfNeeded();
+	}
+	else
+	{
+		_outliers.insert(gameObject);
+		if (needsReroot(_outliers.count(), _indices.count() + _pending.count() + _outliers.count()))
+			reroot();
+	}
+}
+
+void GameEngine::LinearOctree::remove(GameObject* gameObject)
+{
+	if (!_initialized)
+		return;
+	auto it = _indices.find(gameObject);
+	if (it != _indices.end())
+	{
+		// Leave a hole, it's cleaned up on the next rebuild
+		_entries[*it].gameObject = nullptr;
+		_indices.erase(it);
+		_removed++;
+		rebuildIfNeeded();
+	}
+	else if (!_pending.removeOne(gameObject))
+		_outliers.remove(gameObject);
+}
+
+bool GameEngine::LinearOctree::update(GameObject* gameObject)
+{
+	if (!_initialized)
+		return false;
+	auto it = _indices.constFind(gameObject);
+	quint32 code;
+	if (it != _indices.constEnd() && encode(gameObject->boundingBox().midPoint(), &code))
+	{
+		auto& entry = _entries[*it];
+		const auto& leaf = _nodes[entry.leaf];
+		auto shift = 3 * (MAX_LEVEL - leaf.level);
+		if (((code >> shift) | (1u << (3 * leaf.level))) == leaf.key)
+		{
+			// Still inside the same leaf, only the bounds need refitting
+			entry.code = code;
+			entry.bbox = gameObject->boundingBox();
+			refit(entry.leaf);
+			return false;
+		}
+	}
+	auto wasOutlier = _outliers.contains(gameObject);
+	remove(gameObject);
+	add(gameObject);
+	return !wasOutlier || !_outliers.contains(gameObject);
+}
+
+void GameEngine::LinearOctree::initialize(const QVector<GameObject*>& gameObjects)
+{
+	QVector3D min, max;
+	bounds(gameObjects, min, max);
+	initialize(gameObjects, min, max);
+}
+
+void GameEngine::LinearOctree::initialize(const QVector<GameObject*>& gameObjects, const QVector3D& min, const QVector3D& max)
+{
+	if (_initialized)
+	{
+		ERROR_LOG("> LinearOctree::initialize: Octree is already initialized.");
+		return;
+	}
+
+	QTime timer;
+	timer.start();
+
+	auto extent = max - min;
+	_size = fmax(extent.z(), fmax(extent.x(), extent.y()));
+	if (_size <= 0)
+		_size = 1;
+	_min = (min + max) / 2 - QVector3D(_size, _size, _size) / 2;
+	_initialized = true;
+
+	for (auto gameObject : gameObjects)
+	{
+		quint32 code;
+		if (encode(gameObject->boundingBox().midPoint(), &code))
+			_pending.push_back(gameObject);
+		else
+			_outliers.insert(gameObject);
+	}
+	rebuild();
+
+	DEBUG_LOG("> LinearOctree::initialize: took " << timer.elapsed() / 1000.0f << "s, " << _nodes.count() << " nodes");
+}
+
+GameEngine::SpatialIndex::OutlierStats GameEngine::LinearOctree::outlierStats() const
+{
+	OutlierStats stats = { _outliers.count(), _indices.count() + _pending.count() + _outliers.count(), _reroots };
+	return stats;
+}
+
+int GameEngine::LinearOctree::nodeCount() const
+{
+	return _nodes.count();
+}
+
+bool GameEngine::LinearOctree::encode(const QVector3D& point, quint32* code) const
+{
+	const quint32 cells = 1 << MAX_LEVEL;
+	quint32 cell[3];
+	for (int i = 0; i < 3; i++)
+	{
+		auto p = (point[i] - _min[i]) / _size;
+		if (p < 0 || p > 1)
+			return false;
+		cell[i] = qMin(static_cast<quint32>(p * cells), cells - 1);
+	}
+	*code = Morton::encode(cell[0], cell[1], cell[2]);
+	return true;
+}
+
+void GameEngine::LinearOctree::fit(int node)
+{
+	auto& n = _nodes[node];
+	QVector3D min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+	QVector3D max(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+	if (n.childCount == 0)
+		// Removed entries are kept, bounds just stay a bit too large until the next rebuild
+		for (auto i = n.first; i < n.first + n.count; i++)
+		{
+			const auto& box = _entries[i].bbox;
+			min = QVector3D(fmin(min.x(), box.minPoint().x()), fmin(min.y(), box.minPoint().y()), fmin(min.z(), box.minPoint().z()));
+			max = QVector3D(fmax(max.x(), box.maxPoint().x()), fmax(max.y(), box.maxPoint().y()), fmax(max.z(), box.maxPoint().z()));
+		}
+	else
+		for (auto i = n.firstChild; i < n.firstChild + n.childCount; i++)
+		{
+			const auto& box = _nodes[i].bbox;
+			min = QVector3D(fmin(min.x(), box.minPoint().x()), fmin(min.y(), box.minPoint().y()), fmin(min.z(), box.minPoint().z()));
+			max = QVector3D(fmax(max.x(), box.maxPoint().x()), fmax(max.y(), box.maxPoint().y()), fmax(max.z(), box.maxPoint().z()));
+		}
+	n.bbox = BoundingBox(min, max);
+}
+
+void GameEngine::LinearOctree::refit(int node)
+{
+	for (; node >= 0; node = _nodes[node].parent)
+		fit(node);
+}
+
+void GameEngine::LinearOctree::rebuild()
+{
+	QVector<Entry> entries;
+	entries.reserve(_entries.count() - _removed + _pending.count());
+	for (const auto& entry : _entries)
+		if (entry.gameObject)
+			entries.push_back(entry);
+	for (auto gameObject : _pending)
+	{
+		Entry entry;
+		if (!encode(gameObject->boundingBox().midPoint(), &entry.code))
+		{
+			_outliers.insert(gameObject);
+			continue;
+		}
+		entry.leaf = -1;
+		entry.isStatic = gameObject->isStatic();
+		entry.gameObject = gameObject;
+		entry.bbox = gameObject->boundingBox();
+		entries.push_back(entry);
+	}
+	std::sort(entries.begin(), entries.end(),
+	          [](const Entry& a, const Entry& b)
+	          {
+		          return a.code < b.code;
+	          });
+
+	_entries.swap(entries);
+	_pending.clear();
+	_removed = 0;
+	_indices.clear();
+	_indices.reserve(_entries.count());
+	for (auto i = 0; i < _entries.count(); i++)
+		_indices.insert(_entries[i].gameObject, i);
+
+	_nodes.clear();
+	if (_entries.isEmpty())
+		return;
+
+	// Nodes are created breadth first, so siblings end up next to each other
+	// and every child is stored after its parent
+	Node root = { 1, 0, -1, -1, 0, 0, _entries.count(), BoundingBox() };
+	_nodes.push_back(root);
+	for (auto i = 0; i < _nodes.count(); i++)
+	{
+		auto level = _nodes[i].level;
+		auto first = _nodes[i].first;
+		auto end = first + _nodes[i].count;
+		if (_nodes[i].count <= MAX_LEAF_SIZE || level == MAX_LEVEL)
+		{
+			for (auto j = first; j < end; j++)
+				_entries[j].leaf = i;
+			continue;
+		}
+
+		// Entries are sorted, so each occupied octant is a contiguous range
+		auto shift = 3 * (MAX_LEVEL - level - 1);
+		_nodes[i].firstChild = _nodes.count();
+		while (first < end)
+		{
+			auto octant = (_entries[first].code >> shift) & 7;
+			auto last = first + 1;
+			while (last < end && ((_entries[last].code >> shift) & 7) == octant)
+				last++;
+			Node child = { (_nodes[i].key << 3) | octant, level + 1, i, -1, 0, first, last - first, BoundingBox() };
+			_nodes.push_back(child);
+			first = last;
+		}
+		_nodes[i].childCount = _nodes.count() - _nodes[i].firstChild;
+	}
+	for (auto i = _nodes.count() - 1; i >= 0; i--)
+		fit(i);
+}
+
+void GameEngine::LinearOctree::rebuildIfNeeded()
+{
+	if (_pending.count() + _removed > qMax(MIN_REBUILD_COUNT, _entries.count() / 8))
+		rebuild();
+}
+
+void GameEngine::LinearOctree::reroot()
+{
+	QTime timer;
+	timer.start();
+
+	auto gameObjects = _indices.keys().toVector() + _pending + _outliers.toList().toVector();
+	QVector3D min, max;
+	grow(gameObjects, BoundingBox(_min, _min + QVector3D(_size, _size, _size)), min, max);
+	_min = min;
+	_size = max.x() - min.x();
+
+	// Every Morton code changes with the bounds, so everything goes through the pending list again
+	_entries.clear();
+	_indices.clear();
+	_outliers.clear();
+	_removed = 0;
+	_pending = gameObjects;
+	rebuild();
+	_reroots++;
+
+	DEBUG_LOG("> LinearOctree::reroot: took " << timer.elapsed() / 1000.0f << "s, " << gameObjects.count() << " objects");
+}
+
+void GameEngine::LinearOctree::intersectNode(int node, const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const
+{
+	const auto& n = _nodes[node];
+	auto containment = frustum.classify(n.bbox, n.lastPlane);
+	if (containment == CullingFrustum::Outside)
+		return;
+	if (containment == CullingFrustum::Inside)
+	{
+		// Node owns a contiguous range of entries, so the whole subtree is taken without any more tests
+		for (auto i = n.first; i < n.first + n.count; i++)
+			if (_entries[i].gameObject && !_entries[i].isStatic)
+				gameObjects.push_back(_entries[i].gameObject);
+		return;
+	}
+
+	if (n.childCount == 0)
+	{
+		AabbBlock block;
+		GameObject* blockObjects[AabbBlock::Size];
+		auto count = 0;
+		for (auto i = n.first; i < n.first + n.count; i++)
+		{
+			const auto& entry = _entries[i];
+			if (entry.gameObject && !entry.isStatic)
+			{
+				block.set(count, entry.bbox);
+				blockObjects[count++] = entry.gameObject;
+			}
+			if (!count || (count < AabbBlock::Size && i < n.first + n.count - 1))
+				continue;
+
+			auto mask = block.intersect(frustum, count);
+			for (auto j = 0; j < count; j++)
+				if (mask & (1 << j))
+					gameObjects.push_back(blockObjects[j]);
+			count = 0;
+		}
+	}
+	else
+		for (auto i = n.firstChild; i < n.firstChild + n.childCount; i++)
+			intersectNode(i, frustum, gameObjects);
+}
+
+void GameEngine::LinearOctree::intersectNode(int node, const FrustumSet& frustums, quint32 views, QList<FrustumSet::Visibility>& gameObjects) const
+{
+	const auto& n = _nodes[node];
+	views = frustums.intersects(n.bbox, views);
+	if (!views)
+		return;
+
+	if (n.childCount == 0)
+	{
+		AabbBlock block;
+		GameObject* blockObjects[AabbBlock::Size];
+		quint32 masks[AabbBlock::Size];
+		auto count = 0;
+		for (auto i = n.first; i < n.first + n.count; i++)
+		{
+			const auto& entry = _entries[i];
+			if (entry.gameObject && !entry.isStatic)
+			{
+				block.set(count, entry.bbox);
+				blockObjects[count++] = entry.gameObject;
+			}
+			if (!count || (count < AabbBlock::Size && i < n.first + n.count - 1))
+				continue;
+
+			frustums.intersect(block, count, views, masks);
+			for (auto j = 0; j < count; j++)
+				if (masks[j])
+					gameObjects.push_back(qMakePair(blockObjects[j], masks[j]));
+			count = 0;
+		}
+	}
+	else
+		for (auto i = n.firstChild; i < n.firstChild + n.childCount; i++)
+			intersectNode(i, frustums, views, gameObjects);
+}
+
+void GameEngine::LinearOctree::raycastNode(int node, const Ray3D& ray, float maxDistance, RaycastCandidates& candidates) const
+{
+	float t;
+	const auto& n = _nodes[node];
+	if (!Intersect::rayAndAABB(ray, n.bbox, &t) || t >= maxDistance)
+		return;
+
+	if (n.childCount == 0)
+	{
+		for (auto i = n.first; i < n.first + n.count; i++)
+		{
+			const auto& entry = _entries[i];
+			if (entry.gameObject && Intersect::rayAndAABB(ray, entry.bbox, &t) && t < maxDistance)
+				candidates.push_back(qMakePair(t, entry.gameObject));
+		}
+	}
+	else
+		for (auto i = n.firstChild; i < n.firstChild + n.childCount; i++)
+			raycastNode(i, ray, maxDistance, candidates);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include "Includes.h"
+#include "SpatialIndex.h"
+
+namespace GameEngine {
+	/*
+	Octree stored in flat arrays. Game objects are sorted by the Morton code of their bounding box center,
+	so every node owns a contiguous range of objects. Only occupied nodes are stored and children of a node
+	are stored next to each other. Node bounds are the tight bounds of their contents.
+	*/
+	class LinearOctree final : public SpatialIndex
+	{
+		NOCOPY(LinearOctree)
+
+	public:
+		EXPORT LinearOctree();
+		EXPORT ~LinearOctree();
+		EXPORT bool findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const override;
+		EXPORT bool raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode = ClosestHit,
+		                    float maxDistance = std::numeric_limits<float>::max()) const override;
+		EXPORT void intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const override;
+		EXPORT void intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const override;
+		EXPORT void intersectParallel(const CullingFrustum& frustum, QList<GameObject*>& gameObjects, TaskPool& pool) const override;
+		EXPORT void add(GameObject* gameObject) override;
+		EXPORT void remove(GameObject* gameObject) override;
+		EXPORT bool update(GameObject* gameObject) override;
+		EXPORT void initialize(const QVector<GameObject*>& gameObjects) override;
+		EXPORT void initialize(const QVector<GameObject*>& gameObjects, const QVector3D& min, const QVector3D& max);
+		EXPORT OutlierStats outlierStats() const override;
+		EXPORT int nodeCount() const;
+
+	private:
+		struct Node
+		{
+			quint32 key; // Morton code of the node prefixed with a sentinel bit
+			int level;
+			int parent;
+			int firstChild;
+			int childCount;
+			int first;
+			int count;
+			BoundingBox bbox;
+			mutable int lastPlane; // Frustum plane which rejected the node last time
+		};
+		struct Entry
+		{
+			quint32 code;
+			int leaf;
+			bool isStatic;
+			GameObject* gameObject;
+			BoundingBox bbox;
+		};
+
+		bool encode(const QVector3D& point, quint32* code) const;
+		void fit(int node);
+		void refit(int node);
+		void rebuild();
+		void rebuildIfNeeded();
+		void reroot();
+		void intersectNode(int node, const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const;
+		void intersectNode(int node, const FrustumSet& frustums, quint32 views, QList<FrustumSet::Visibility>& gameObjects) const;
+		void raycastNode(int node, const Ray3D& ray, float maxDistance, RaycastCandidates& candidates) const;
+
+		QVector<Node> _nodes;
+		QVector<Entry> _entries;
+		QHash<GameObject*, int> _indices;
+		QVector<GameObject*> _pending;
+		QSet<GameObject*> _outliers;
+		QVector3D _min;
+		float _size;
+		int _removed;
+		int _reroots;
+		bool _initialized;
+	};
+}
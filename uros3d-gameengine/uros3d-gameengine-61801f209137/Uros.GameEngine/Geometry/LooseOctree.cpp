@@ -0,0 +1,289 @@
+#include <QTime>
+#include "LooseOctree.h"
+#include "Morton.h"
+#include "Ray3D.h"
+#include "CullingFrustum.h"
+#include "AabbBlock.h"
+#include "Intersect.h"
+#include "GameObject.h"
+
+#define MAX_LEVEL 10
+#define ROOT_KEY 1u
+
+GameEngine::LooseOctree::LooseOctree(float looseness)
+	: _size(0),
+	  _looseness(looseness),
+	  _reroots(0),
+	  _initialized(false)
+{
+	if (_looseness <= 1)
+		throw std::logic_error("LooseOctree::LooseOctree: Looseness must be greater than 1.");
+}
+
+GameEngine::LooseOctree::~LooseOctree() {}
+
+bool GameEngine::LooseOctree::findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const
+{
+	auto it = _mapping.constFind(gameObject);
+	if (it != _mapping.constEnd())
+	{
+		nodes.clear();
+		nodes.push_back(_nodes.constFind(*it)->bbox);
+		return true;
+	}
+	return false;
+}
+
+bool GameEngine::LooseOctree::raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode, float maxDistance) const
+{
+	RaycastCandidates candidates;
+	if (_nodes.contains(ROOT_KEY))
+		raycastNode(ROOT_KEY, ray, maxDistance, candidates);
+	for (auto gObject : _outliers)
+	{
+		float t;
+		if (Intersect::rayAndAABB(ray, gObject->boundingBox(), &t) && t < maxDistance)
+			candidates.push_back(qMakePair(t, gObject));
+	}
+	gameObject = raycastCandidates(ray, candidates, mode, maxDistance, hitPoint);
+	return gameObject;
+}
+
+void GameEngine::LooseOctree::intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const
+{
+	if (_nodes.contains(ROOT_KEY))
+		intersectNode(ROOT_KEY, frustum, gameObjects);
+	AabbBlock::intersect(frustum, _outliers, gameObjects);
+}
+
+void GameEngine::LooseOctree::intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const
+{
+	if (_nodes.contains(ROOT_KEY))
+		intersectNode(ROOT_KEY, frustums, frustums.views(), gameObjects);
+	frustums.intersect(_outliers, frustums.views(), gameObjects);
+}
+
+void GameEngine::LooseOctree::add(GameObject* gameObject)
+{
+	if (!_initialized)
+		return;
+	quint32 key;
+	if (locate(gameObject->boundingBox(), &key))
+		insert(gameObject, key);
+	else
+	{
+		_outliers.insert(gameObject);
+		if (needsReroot(_outliers.count(), _mapping.count() + _outliers.count()))
+			reroot();
+	}
+}
+
+void GameEngine::LooseOctree::remove(GameObject* gameObject)
+{
+	if (!_initialized)
+		return;
+	auto it = _mapping.find(gameObject);
+	if (it == _mapping.end())
+	{
+		_outliers.remove(gameObject);
+		return;
+	}
+
+	auto key = *it;
+	_mapping.erase(it);
+	_nodes.find(key)->gameObjects.removeOne(gameObject);
+	// Walk up and drop nodes which became empty
+	for (auto k = key; k; k >>= 3)
+	{
+		auto node = _nodes.find(k);
+		if (--node->count == 0)
+		{
+			_nodes.erase(node);
+			if (k != ROOT_KEY)
+				_nodes.find(k >> 3)->childMask &= ~(1 << (k & 7));
+		}
+	}
+}
+
+bool GameEngine::LooseOctree::update(GameObject* gameObject)
+{
+	if (!_initialized)
+		return false;
+	quint32 key;
+	auto fits = locate(gameObject->boundingBox(), &key);
+	auto it = _mapping.constFind(gameObject);
+	if (it != _mapping.constEnd() ? fits && *it == key : !fits)
+		return false;
+	remove(gameObject);
+	add(gameObject);
+	return true;
+}
+
+void GameEngine::LooseOctree::initialize(const QVector<GameObject*>& gameObjects)
+{
+	QVector3D min, max;
+	bounds(gameObjects, min, max);
+	initialize(gameObjects, min, max);
+}
+
+void GameEngine::LooseOctree::initialize(const QVector<GameObject*>& gameObjects, const QVector3D& min, const QVector3D& max)
+{
+	if (_initialized)
+	{
+		ERROR_LOG("> LooseOctree::initialize: Octree is already initialized.");
+		return;
+	}
+
+	QTime timer;
+	timer.start();
+
+	auto extent = max - min;
+	_size = fmax(extent.z(), fmax(extent.x(), extent.y()));
+	if (_size <= 0)
+		_size = 1;
+	_min = (min + max) / 2 - QVector3D(_size, _size, _size) / 2;
+	_initialized = true;
+
+	for (auto gameObject : gameObjects)
+		add(gameObject);
+
+	DEBUG_LOG("> LooseOctree::initialize: took " << timer.elapsed() / 1000.0f << "s, " << _nodes.count() << " nodes");
+}
+
+GameEngine::SpatialIndex::OutlierStats GameEngine::LooseOctree::outlierStats() const
+{
+	OutlierStats stats = { _outliers.count(), _mapping.count() + _outliers.count(), _reroots };
+	return stats;
+}
+
+int GameEngine::LooseOctree::nodeCount() const
+{
+	return _nodes.count();
+}
+
+float GameEngine::LooseOctree::looseness() const
+{
+	return _looseness;
+}
+
+bool GameEngine::LooseOctree::locate(const BoundingBox& box, quint32* key) const
+{
+	const quint32 cells = 1 << MAX_LEVEL;
+	quint32 cell[3];
+	for (int i = 0; i < 3; i++)
+	{
+		auto p = (box.midPoint()[i] - _min[i]) / _size;
+		if (p < 0 || p > 1)
+			return false;
+		cell[i] = qMin(static_cast<quint32>(p * cells), cells - 1);
+	}
+
+	// Deepest level at which the object still fits into the loose bounds of its cell
+	auto level = MAX_LEVEL;
+	auto size = fmax(box.extent().z(), fmax(box.extent().x(), box.extent().y()));
+	if (size > 0)
+		level = qMin(MAX_LEVEL, static_cast<int>(floor(log2(_size * (_looseness - 1) / size))));
+	if (level < 0)
+		return false;
+
+	auto shift = 3 * (MAX_LEVEL - level);
+	*key = (Morton::encode(cell[0], cell[1], cell[2]) >> shift) | (1u << (3 * level));
+	return true;
+}
+
+GameEngine::BoundingBox GameEngine::LooseOctree::looseBounds(quint32 key) const
+{
+	auto level = 0;
+	for (auto k = key; k > ROOT_KEY; k >>= 3)
+		level++;
+	quint32 x, y, z;
+	Morton::decode(key & ~(1u << (3 * level)), x, y, z);
+
+	auto cellSize = _size / (1 << level);
+	auto center = _min + QVector3D(x + 0.5f, y + 0.5f, z + 0.5f) * cellSize;
+	auto halfSize = cellSize * _looseness / 2;
+	return BoundingBox(center - QVector3D(halfSize, halfSize, halfSize), center + QVector3D(halfSize, halfSize, halfSize));
+}
+
+void GameEngine::LooseOctree::insert(GameObject* gameObject, quint32 key)
+{
+	_mapping.insert(gameObject, key);
+	// Walk up and create missing nodes on the way to the root
+	quint32 child = 0;
+	for (auto k = key; k; k >>= 3)
+	{
+		auto node = _nodes.find(k);
+		if (node == _nodes.end())
+		{
+			Node newNode = { looseBounds(k), QVector<GameObject*>(), 0, 0 };
+			node = _nodes.insert(k, newNode);
+		}
+		if (child)
+			node->childMask |= 1 << (child & 7);
+		else
+			node->gameObjects.push_back(gameObject);
+		node->count++;
+		child = k;
+	}
+}
+
+void GameEngine::LooseOctree::reroot()
+{
+	QTime timer;
+	timer.start();
+
+	auto gameObjects = _mapping.keys().toVector() + _outliers.toList().toVector();
+	QVector3D min, max;
+	grow(gameObjects, BoundingBox(_min, _min + QVector3D(_size, _size, _size)), min, max);
+	_min = min;
+	_size = max.x() - min.x();
+
+	_nodes.clear();
+	_mapping.clear();
+	_outliers.clear();
+	for (auto gameObject : gameObjects)
+		add(gameObject);
+	_reroots++;
+
+	DEBUG_LOG("> LooseOctree::reroot: took " << timer.elapsed() / 1000.0f << "s, " << gameObjects.count() << " objects");
+}
+
+void GameEngine::LooseOctree::intersectNode(quint32 key, const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const
+{
+	const auto& node = *_nodes.constFind(key);
+	if (!frustum.intersects(node.bbox))
+		return;
+
+	AabbBlock::intersect(frustum, node.gameObjects, gameObjects);
+	for (auto i = 0; i < 8; i++)
+		if (node.childMask & (1 << i))
+			intersectNode((key << 3) | i, frustum, gameObjects);
+}
+
+void GameEngine::LooseOctree::intersectNode(quint32 key, const FrustumSet& frustums, quint32 views, QList<FrustumSet::Visibility>& gameObjects) const
+{
+	const auto& node = *_nodes.constFind(key);
+	views = frustums.intersects(node.bbox, views);
+	if (!views)
+		return;
+
+	frustums.intersect(node.gameObjects, views, gameObjects);
+	for (auto i = 0; i < 8; i++)
+		if (node.childMask & (1 << i))
+			intersectNode((key << 3) | i, frustums, views, gameObjects);
+}
+
+void GameEngine::LooseOctree::raycastNode(quint32 key, const Ray3D& ray, float maxDistance, RaycastCandidates& candidates) const
+{
+	float t;
+	const auto& node = *_nodes.constFind(key);
+	if (!Intersect::rayAndAABB(ray, node.bbox, &t) || t >= maxDistance)
+		return;
+
+	for (auto gameObject : node.gameObjects)
+		if (Intersect::rayAndAABB(ray, gameObject->boundingBox(), &t) && t < maxDistance)
+			candidates.push_back(qMakePair(t, gameObject));
+	for (auto i = 0; i < 8; i++)
+		if (node.childMask & (1 << i))
+			raycastNode((key << 3) | i, ray, maxDistance, candidates);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include "Includes.h"
+#include "SpatialIndex.h"
+
+namespace GameEngine {
+	/*
+	Loose octree, bounds of every node are enlarged by the looseness factor. Each game object is stored
+	in exactly one node, picked by the object's center and size, so culling never returns duplicates.
+	Nodes are kept in a hash by their Morton code and only exist while something is stored below them.
+	*/
+	class LooseOctree final : public SpatialIndex
+	{
+		NOCOPY(LooseOctree)
+
+	public:
+		EXPORT explicit LooseOctree(float looseness = 2);
+		EXPORT ~LooseOctree();
+		EXPORT bool findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const override;
+		EXPORT bool raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode = ClosestHit,
+		                    float maxDistance = std::numeric_limits<float>::max()) const override;
+		EXPORT void intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const override;
+		EXPORT void intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const override;
+		EXPORT void add(GameObject* gameObject) override;
+		EXPORT void remove(GameObject* gameObject) override;
+		EXPORT bool update(GameObject* gameObject) override;
+		EXPORT void initialize(const QVector<GameObject*>& gameObjects) override;
+		EXPORT void initialize(const QVector<GameObject*>& gameObjects, const QVector3D& min, const QVector3D& max);
+		EXPORT OutlierStats outlierStats() const override;
+		EXPORT int nodeCount() const;
+		EXPORT float looseness() const;
+
+	private:
+		struct Node
+		{
+			BoundingBox bbox;
+			QVector<GameObject*> gameObjects;
+			int childMask;
+			int count; // Number of game objects in the whole subtree
+		};
+
+		bool locate(const BoundingBox& box, quint32* key) const;
+		BoundingBox looseBounds(quint32 key) const;
+		void insert(GameObject* gameObject, quint32 key);
+		void reroot();
+		void intersectNode(quint32 key, const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const;
+		void intersectNode(quint32 key, const FrustumSet& frustums, quint32 views, QList<FrustumSet::Visibility>& gameObjects) const;
+		void raycastNode(quint32 key, const Ray3D& ray, float maxDistance, RaycastCandidates& candidates) const;
+
+		QHash<quint32, Node> _nodes;
+		QHash<GameObject*, quint32> _mapping;
+		QSet<GameObject*> _outliers;
+		QVector3D _min;
+		float _size;
+		float _looseness;
+		int _reroots;
+		bool _initialized;
+	};
+}
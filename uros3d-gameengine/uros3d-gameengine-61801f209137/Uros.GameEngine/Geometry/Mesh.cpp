@@ -1,61 +1,58 @@
+#include <cstring>
+#include <QHash>
 #include <QQuaternion>
 #include "Mesh.h"
+#include "TriangleBvh.h"
+#include "MeshSimplifier.h"
 
-GameEngine::Mesh::Mesh()
-	: _vertices(nullptr),
-	  _normals(nullptr),
-	  _texcoords(nullptr),
-	  _verticesCount(0) {}
+#define LOD_LEVELS 4
+#define LOD_MIN_TRIANGLES 64
+#define LOD_MIN_REDUCTION 0.8f
+
+GameEngine::Mesh::Mesh() {}
 
 GameEngine::Mesh::Mesh(float* vertices, float* normals, int count, float* texcoords)
+	: Mesh()
 {
 	auto boundingBox = BoundingBox::create(vertices, count);
 
-	auto verts = new float[count];
-	auto norms = new float[count];
-	auto coords = new float[count];
-
+	// Vertices are centered while welding, so the source is never copied
 	QVector3D center = boundingBox.midPoint();
-	for (int i = 0; i < count; i += 3)
-	{
-		verts[i] = vertices[i] - center.x();
-		verts[i + 1] = vertices[i + 1] - center.y();
-		verts[i + 2] = vertices[i + 2] - center.z();
-	}
-	std::copy(normals, normals + count, norms);
-
-	texcoords = texcoords ? texcoords : vertices;
-	std::copy(texcoords, texcoords + count, coords);
-
-	_vertices = verts;
-	_normals = norms;
-	_texcoords = coords;
-	_verticesCount = count;
+	weld(vertices, normals, texcoords ? texcoords : vertices, count, center);
 	_boundingBox = BoundingBox(boundingBox.minPoint() - center, boundingBox.maxPoint() - center);
 }
 
 GameEngine::Mesh::Mesh(float* vertices, float* normals, float* texcoords, int count)
+	: Mesh()
 {
-	auto verts = new float[count];
-	auto norms = new float[count];
-	auto coords = new float[count];
-
-	std::copy(vertices, vertices + count, verts);
-	std::copy(normals, normals + count, norms);
-	std::copy(texcoords, texcoords + count, coords);
-
-	_vertices = verts;
-	_normals = norms;
-	_texcoords = coords;
-	_verticesCount = count;
-	_boundingBox = BoundingBox::create(_vertices, _verticesCount);
+	weld(vertices, normals, texcoords, count);
+	_boundingBox = BoundingBox::create(vertices, count);
+}
+
+GameEngine::Mesh::Mesh(float* vertices, float* normals, float* texcoords, int count, const quint32* indices, int indexCount)
+	: Mesh(std::vector<float>(vertices, vertices + count), std::vector<float>(normals, normals + count),
+	       std::vector<float>(texcoords, texcoords + count), std::vector<quint32>(indices, indices + indexCount)) {}
+
+GameEngine::Mesh::Mesh(std::vector<float>&& vertices, std::vector<float>&& normals, std::vector<float>&& texcoords, std::vector<quint32>&& indices)
+	: _vertices(std::move(vertices)),
+	  _normals(std::move(normals)),
+	  _texcoords(std::move(texcoords))
+{
+	Q_ASSERT(_normals.size() == _vertices.size() && _texcoords.size() == _vertices.size());
+
+	setIndices(std::move(indices));
+	_boundingBox = BoundingBox::create(_vertices.data(), static_cast<int>(_vertices.size()));
 }
 
 GameEngine::Mesh::~Mesh()
 {
-	delete[] _vertices;
-	delete[] _normals;
-	delete[] _texcoords;
+	delete _triangleBvh.load();
+	if (auto lods = _lods.load())
+	{
+		for (auto i = 1; i < lods->count(); i++)
+			delete (*lods)[i];
+		delete lods;
+	}
 }
 
 GameEngine::Mesh* GameEngine::Mesh::cone()
@@ -420,33 +417,32 @@ GameEngine::Mesh* GameEngine::Mesh::cylinder()
 GameEngine::GeometryBase* GameEngine::Mesh::clone() const
 {
 	auto mesh = new Mesh();
-	mesh->_vertices = new float[_verticesCount];
-	mesh->_normals = new float[_verticesCount];
-	mesh->_texcoords = new float[_verticesCount];
-	mesh->_verticesCount = _verticesCount;
+	mesh->_vertices = _vertices;
+	mesh->_normals = _normals;
+	mesh->_texcoords = _texcoords;
+	mesh->_shortIndices = _shortIndices;
+	mesh->_longIndices = _longIndices;
 	mesh->_boundingBox = _boundingBox;
-	std::copy(_vertices, _vertices + _verticesCount, mesh->_vertices);
-	std::copy(_normals, _normals + _verticesCount, mesh->_normals);
-	std::copy(_texcoords, _texcoords + _verticesCount, mesh->_texcoords);
 	return mesh;
 }
 
 int GameEngine::Mesh::vertexCount() const
 {
-	return _verticesCount / 3;
+	return indexCount();
 }
 
 int GameEngine::Mesh::triangleCount() const
 {
-	return _verticesCount / 9;
+	return indexCount() / 3;
 }
 
 void GameEngine::Mesh::getVertexData(int index, QVector3D& v, QVector3D& n) const
 {
 	Q_ASSERT(index >= 0 && index < vertexCount());
 
-	v = QVector3D(_vertices[index * 3], _vertices[index * 3 + 1], _vertices[index * 3 + 2]);
-	n = QVector3D(_normals[index * 3], _normals[index * 3 + 1], _normals[index * 3 + 2]);
+	auto vertex = getIndex(index);
+	v = QVector3D(_vertices[vertex * 3], _vertices[vertex * 3 + 1], _vertices[vertex * 3 + 2]);
+	n = QVector3D(_normals[vertex * 3], _normals[vertex * 3 + 1], _normals[vertex * 3 + 2]);
 }
 
 void GameEngine::Mesh::getTriangleData(int index, QVector3D& t0, QVector3D& t1, QVector3D& t2, QVector3D& n0, QVector3D& n1, QVector3D& n2) const
@@ -467,5 +463,166 @@ void GameEngine::Mesh::getTextureCoord(int index, QVector3D& coord)
 {
 	Q_ASSERT(index >= 0 && index < vertexCount());
 
+	auto vertex = getIndex(index);
+	coord = QVector3D(_texcoords[vertex * 3], _texcoords[vertex * 3 + 1], _texcoords[vertex * 3 + 2]);
+}
+
+int GameEngine::Mesh::uniqueVertexCount() const
+{
+	return static_cast<int>(_vertices.size() / 3);
+}
+
+void GameEngine::Mesh::getUniqueVertexData(int index, QVector3D& v, QVector3D& n, QVector3D& coord) const
+{
+	Q_ASSERT(index >= 0 && index < uniqueVertexCount());
+
+	v = QVector3D(_vertices[index * 3], _vertices[index * 3 + 1], _vertices[index * 3 + 2]);
+	n = QVector3D(_normals[index * 3], _normals[index * 3 + 1], _normals[index * 3 + 2]);
 	coord = QVector3D(_texcoords[index * 3], _texcoords[index * 3 + 1], _texcoords[index * 3 + 2]);
 }
+
+int GameEngine::Mesh::indexCount() const
+{
+	return static_cast<int>(_longIndices.empty() ? _shortIndices.size() : _longIndices.size());
+}
+
+int GameEngine::Mesh::indexSize() const
+{
+	return _longIndices.empty() ? 2 : 4;
+}
+
+quint32 GameEngine::Mesh::getIndex(int index) const
+{
+	Q_ASSERT(index >= 0 && index < indexCount());
+
+	if (_longIndices.empty())
+		return _shortIndices[index];
+	return _longIndices[index];
+}
+
+const GameEngine::TriangleBvh& GameEngine::Mesh::triangleBvh() const
+{
+	// Several threads may raycast the same mesh, only the first one builds
+	if (auto bvh = _triangleBvh.loadAcquire())
+		return *bvh;
+	QMutexLocker locker(&_triangleBvhMutex);
+	if (!_triangleBvh.load())
+		_triangleBvh.storeRelease(new TriangleBvh(*this));
+	return *_triangleBvh.load();
+}
+
+int GameEngine::Mesh::lodCount() const
+{
+	auto lods = _lods.loadAcquire();
+	return lods ? lods->count() : 1;
+}
+
+const GameEngine::Mesh& GameEngine::Mesh::lod(int level) const
+{
+	Q_ASSERT(level >= 0 && level < lodCount());
+
+	auto lods = _lods.loadAcquire();
+	return lods ? *(*lods)[level] : *this;
+}
+
+void GameEngine::Mesh::buildLods() const
+{
+	if (_lods.loadAcquire())
+		return;
+	QMutexLocker locker(&_lodsMutex);
+	if (_lods.load())
+		return;
+
+	// Levels stop once the mesh is small or simplification can't take enough away, mostly seams left then
+	auto lods = new QVector<Mesh*>();
+	lods->push_back(const_cast<Mesh*>(this));
+	while (lods->count() < LOD_LEVELS && lods->last()->triangleCount() >= LOD_MIN_TRIANGLES * 2)
+	{
+		auto previous = lods->last()->triangleCount();
+		auto simplified = MeshSimplifier::simplify(*lods->last(), previous / 2);
+		if (simplified->triangleCount() > previous * LOD_MIN_REDUCTION)
+		{
+			delete simplified;
+			break;
+		}
+		lods->push_back(simplified);
+	}
+	DEBUG_LOG("> Mesh: " << lods->count() << " levels of detail down to " << lods->last()->triangleCount() << " triangles");
+	_lods.storeRelease(lods);
+}
+
+void GameEngine::Mesh::weld(const float* vertices, const float* normals, const float* texcoords, int count, const QVector3D& offset)
+{
+	// Corners are welded only when position, normal and texture coordinate are all bitwise equal. The table
+	// points back to the first corner of every unique vertex, so the source is compared in place and the
+	// welded arrays are allocated once their size is known.
+	auto corners = count / 3;
+	auto tableSize = 1;
+	while (tableSize < corners * 2)
+		tableSize <<= 1;
+	QVector<int> table(tableSize, -1);
+	QVector<int> firstCorners;
+	std::vector<quint32> indices(corners);
+	auto equals = [&](int a, int b)
+	{
+		return memcmp(vertices + a * 3, vertices + b * 3, 3 * sizeof(float)) == 0
+			&& memcmp(normals + a * 3, normals + b * 3, 3 * sizeof(float)) == 0
+			&& memcmp(texcoords + a * 3, texcoords + b * 3, 3 * sizeof(float)) == 0;
+	};
+	for (auto i = 0; i < corners; i++)
+	{
+		const float tuple[9] =
+			{
+				vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2],
+				normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2],
+				texcoords[i * 3], texcoords[i * 3 + 1], texcoords[i * 3 + 2]
+			};
+		auto slot = static_cast<int>(qHashBits(tuple, sizeof(tuple)) & (tableSize - 1));
+		while (table[slot] >= 0 && !equals(firstCorners[table[slot]], i))
+			slot = (slot + 1) & (tableSize - 1);
+		if (table[slot] < 0)
+		{
+			table[slot] = firstCorners.count();
+			firstCorners.push_back(i);
+		}
+		indices[i] = table[slot];
+	}
+
+	auto uniqueCount = firstCorners.count();
+	_vertices.resize(uniqueCount * 3);
+	_normals.resize(uniqueCount * 3);
+	_texcoords.resize(uniqueCount * 3);
+	for (auto i = 0; i < uniqueCount; i++)
+	{
+		auto corner = firstCorners[i];
+		for (auto j = 0; j < 3; j++)
+		{
+			_vertices[i * 3 + j] = vertices[corner * 3 + j] - offset[j];
+			_normals[i * 3 + j] = normals[corner * 3 + j];
+			_texcoords[i * 3 + j] = texcoords[corner * 3 + j];
+		}
+	}
+	setIndices(std::move(indices));
+}
+
+void GameEngine::Mesh::setIndices(std::vector<quint32>&& indices)
+{
+	// Short indices halve the buffer whenever every vertex fits in them, long ones are taken over as they are
+	_shortIndices.clear();
+	_longIndices.clear();
+	if (uniqueVertexCount() <= 0x10000)
+	{
+		_shortIndices.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+			_shortIndices[i] = static_cast<quint16>(indices[i]);
+	}
+	else
+		_longIndices = std::move(indices);
+}
+
+const void* GameEngine::Mesh::indexData() const
+{
+	if (_longIndices.empty())
+		return _shortIndices.data();
+	return _longIndices.data();
+}
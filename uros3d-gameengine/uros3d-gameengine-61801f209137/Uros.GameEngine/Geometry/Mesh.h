@@ -1,23 +1,47 @@
 #pragma once
+#include <QAtomicPointer>
+#include <QMutex>
+#include <vector>
 #include "GeometryBase.h"
 
 namespace GameEngine {
 	class RenderingManagerOGL;
+	class TriangleBvh;
+
 	class Mesh final : public GeometryBase
 	{
 		NOCOPY(Mesh)
 
 	private:
 		Mesh();
-		float* _vertices;
-		float* _normals;
-		float* _texcoords;
-		int _verticesCount;
+		std::vector<float> _vertices; // Welded vertices, shared by all triangles using them
+		std::vector<float> _normals;
+		std::vector<float> _texcoords;
+		std::vector<quint16> _shortIndices; // Three per triangle, only one of the two is filled
+		std::vector<quint32> _longIndices;
 		BoundingBox _boundingBox;
+		mutable QAtomicPointer<TriangleBvh> _triangleBvh;
+		mutable QMutex _triangleBvhMutex;
+		mutable QAtomicPointer<QVector<Mesh*>> _lods;
+		mutable QMutex _lodsMutex;
+
+		void weld(const float* vertices, const float* normals, const float* texcoords, int count, const QVector3D& offset = QVector3D());
+		void setIndices(std::vector<quint32>&& indices);
+		const void* indexData() const;
 
 	public:
 		Mesh(float* vertices, float* normals, int count, float* texcoords = nullptr);
 		Mesh(float* vertices, float* normals, float* texcoords, int count);
+		/*
+		Takes already welded vertices, count is the number of floats in each array. Indices point to vertices,
+		three per triangle.
+		*/
+		Mesh(float* vertices, float* normals, float* texcoords, int count, const quint32* indices, int indexCount);
+		/*
+		Same as above, but takes over the buffers instead of copying them. Only indices get copied, and only
+		when they can be narrowed to 16 bits.
+		*/
+		Mesh(std::vector<float>&& vertices, std::vector<float>&& normals, std::vector<float>&& texcoords, std::vector<quint32>&& indices);
 		~Mesh() override;
 
 		static Mesh* cone();
@@ -29,6 +53,9 @@ namespace GameEngine {
 		/* GeometryBase Members */
 
 		GeometryBase* clone() const override;
+		/*
+		Vertices are still counted per triangle corner, so the count always equals indexCount.
+		*/
 		int vertexCount() const override;
 		int triangleCount() const override;
 		void getVertexData(int index, QVector3D& v, QVector3D& n) const override;
@@ -38,6 +65,29 @@ namespace GameEngine {
 		/* Members */
 
 		void getTextureCoord(int index, QVector3D& coord);
+		/*
+		Number of vertices left after welding corners with equal position, normal and texture coordinate.
+		*/
+		int uniqueVertexCount() const;
+		void getUniqueVertexData(int index, QVector3D& v, QVector3D& n, QVector3D& coord) const;
+		int indexCount() const;
+		/*
+		Bytes per index, 2 while all vertices can be addressed with 16 bits and 4 otherwise.
+		*/
+		int indexSize() const;
+		quint32 getIndex(int index) const;
+		/*
+		Hierarchy over mesh's triangles used for raycasting, it's built on first use and kept until the mesh dies.
+		*/
+		const TriangleBvh& triangleBvh() const;
+		/*
+		Simplified copies of the mesh, each with about half the triangles of the level before. Level zero is the
+		mesh itself. Simplifying takes a while, so levels exist only once buildLods was called, until then the
+		mesh is its only level. They are kept until the mesh dies.
+		*/
+		int lodCount() const;
+		const Mesh& lod(int level) const;
+		void buildLods() const;
 
 		/* Friend classes */
 
@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <QVector3D>
+#include "MeshOptimizer.h"
+#include "Mesh.h"
+
+#define OVERDRAW_THRESHOLD 1.05f
+
+float GameEngine::MeshOptimizer::acmr(const std::vector<quint32>& indices, int vertexCount)
+{
+	if (indices.empty())
+		return 0;
+
+	// Vertex is in cache while fewer than CacheSize misses happened since it was loaded
+	QVector<int> cacheTime(vertexCount, 0);
+	auto time = CacheSize + 1;
+	auto misses = 0;
+	for (auto index : indices)
+		if (time - cacheTime[index] > CacheSize)
+		{
+			cacheTime[index] = time++;
+			misses++;
+		}
+	return float(misses) / (indices.size() / 3);
+}
+
+float GameEngine::MeshOptimizer::acmr(const Mesh& mesh)
+{
+	std::vector<quint32> indices(mesh.indexCount());
+	for (auto i = 0; i < mesh.indexCount(); i++)
+		indices[i] = mesh.getIndex(i);
+	return acmr(indices, mesh.uniqueVertexCount());
+}
+
+void GameEngine::MeshOptimizer::optimizeVertexCache(std::vector<quint32>& indices, int vertexCount, QVector<int>* clusters)
+{
+	// Triangles around every vertex, and how many of them are still waiting to be emitted
+	QVector<int> live(vertexCount, 0);
+	for (auto index : indices)
+		live[index]++;
+	QVector<int> adjacencyOffsets(vertexCount + 1, 0);
+	for (auto i = 0; i < vertexCount; i++)
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + live[i];
+	QVector<int> adjacency(static_cast<int>(indices.size()));
+	auto fill = adjacencyOffsets;
+	for (size_t i = 0; i < indices.size(); i++)
+		adjacency[fill[indices[i]]++] = static_cast<int>(i / 3);
+
+	QVector<int> cacheTime(vertexCount, 0);
+	QVector<bool> emitted(static_cast<int>(indices.size() / 3), false);
+	QVector<int> deadEnds;
+	QVector<int> candidates;
+	std::vector<quint32> result;
+	result.reserve(indices.size());
+	auto time = CacheSize + 1;
+	auto cursor = 0;
+	auto fanning = -1;
+	if (clusters)
+		clusters->clear();
+	while (true)
+	{
+		// Dead end, go back to recently used vertices first, then on through the input order
+		if (fanning < 0)
+		{
+			while (fanning < 0 && !deadEnds.isEmpty())
+			{
+				auto vertex = deadEnds.takeLast();
+				if (live[vertex] > 0)
+					fanning = vertex;
+			}
+			while (fanning < 0 && cursor < vertexCount)
+			{
+				if (live[cursor] > 0)
+					fanning = cursor;
+				else
+					cursor++;
+			}
+			if (fanning < 0)
+				break;
+			if (clusters)
+				clusters->push_back(static_cast<int>(result.size() / 3));
+		}
+
+		candidates.clear();
+		for (auto i = adjacencyOffsets[fanning]; i < adjacencyOffsets[fanning + 1]; i++)
+		{
+			auto triangle = adjacency[i];
+			if (emitted[triangle])
+				continue;
+			for (auto j = 0; j < 3; j++)
+			{
+				auto vertex = indices[triangle * 3 + j];
+				result.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+				if (time - cacheTime[vertex] > CacheSize)
+					cacheTime[vertex] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		// Next fan goes around the oldest vertex that is still in cache after its remaining triangles are emitted
+		fanning = -1;
+		auto priority = -1;
+		for (auto vertex : candidates)
+		{
+			if (live[vertex] <= 0)
+				continue;
+			auto age = time - cacheTime[vertex];
+			auto vertexPriority = age + 2 * live[vertex] <= CacheSize ? age : 0;
+			if (vertexPriority > priority)
+			{
+				priority = vertexPriority;
+				fanning = vertex;
+			}
+		}
+	}
+	indices.swap(result);
+}
+
+void GameEngine::MeshOptimizer::optimizeOverdraw(std::vector<quint32>& indices, const std::vector<float>& vertices, const QVector<int>& clusters, float threshold)
+{
+	auto triangleCount = static_cast<int>(indices.size() / 3);
+	auto vertexCount = static_cast<int>(vertices.size() / 3);
+	QVector<int> cacheTime(vertexCount, 0);
+	auto time = CacheSize + 1;
+	auto misses = [&](int triangle)
+	{
+		auto count = 0;
+		for (auto i = 0; i < 3; i++)
+		{
+			auto vertex = indices[triangle * 3 + i];
+			if (time - cacheTime[vertex] > CacheSize)
+			{
+				cacheTime[vertex] = time++;
+				count++;
+			}
+		}
+		return count;
+	};
+
+	// Every cluster starts from a cold cache, so splitting one costs the misses its cache had warmed up to.
+	// A cluster is split once its running ACMR is within threshold of what the whole cluster achieves.
+	QVector<int> softClusters;
+	for (auto i = 0; i < clusters.count(); i++)
+	{
+		auto start = clusters[i];
+		auto end = i + 1 < clusters.count() ? clusters[i + 1] : triangleCount;
+		time += CacheSize + 1;
+		auto clusterMisses = 0;
+		for (auto triangle = start; triangle < end; triangle++)
+			clusterMisses += misses(triangle);
+		auto clusterAcmr = float(clusterMisses) / (end - start);
+
+		time += CacheSize + 1;
+		softClusters.push_back(start);
+		auto softMisses = 0;
+		auto softTriangles = 0;
+		for (auto triangle = start; triangle < end - 1; triangle++)
+		{
+			softMisses += misses(triangle);
+			softTriangles++;
+			if (softMisses <= threshold * clusterAcmr * softTriangles)
+			{
+				time += CacheSize + 1;
+				softClusters.push_back(triangle + 1);
+				softMisses = 0;
+				softTriangles = 0;
+			}
+		}
+	}
+
+	// Clusters facing away from the centre occlude the ones behind them, so they go first
+	auto position = [&](int triangle, int corner)
+	{
+		auto vertex = indices[triangle * 3 + corner] * 3;
+		return QVector3D(vertices[vertex], vertices[vertex + 1], vertices[vertex + 2]);
+	};
+	QVector<QVector3D> centroids(softClusters.count());
+	QVector<QVector3D> normals(softClusters.count());
+	QVector3D meshCentroid;
+	auto meshArea = 0.0f;
+	for (auto i = 0; i < softClusters.count(); i++)
+	{
+		auto end = i + 1 < softClusters.count() ? softClusters[i + 1] : triangleCount;
+		auto area = 0.0f;
+		for (auto triangle = softClusters[i]; triangle < end; triangle++)
+		{
+			auto a = position(triangle, 0);
+			auto b = position(triangle, 1);
+			auto c = position(triangle, 2);
+			auto normal = QVector3D::crossProduct(b - a, c - a);
+			auto triangleArea = normal.length();
+			centroids[i] += (a + b + c) / 3 * triangleArea;
+			normals[i] += normal;
+			area += triangleArea;
+		}
+		meshCentroid += centroids[i];
+		meshArea += area;
+		if (area > 0)
+			centroids[i] /= area;
+	}
+	if (meshArea > 0)
+		meshCentroid /= meshArea;
+
+	QVector<float> facing(softClusters.count());
+	QVector<int> order(softClusters.count());
+	for (auto i = 0; i < softClusters.count(); i++)
+	{
+		facing[i] = QVector3D::dotProduct(centroids[i] - meshCentroid, normals[i].normalized());
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+	                 {
+		                 return facing[a] > facing[b];
+	                 });
+
+	std::vector<quint32> result;
+	result.reserve(indices.size());
+	for (auto cluster : order)
+	{
+		auto end = cluster + 1 < softClusters.count() ? softClusters[cluster + 1] : triangleCount;
+		result.insert(result.end(), indices.begin() + softClusters[cluster] * 3, indices.begin() + end * 3);
+	}
+	indices.swap(result);
+}
+
+void GameEngine::MeshOptimizer::optimizeVertexFetch(std::vector<quint32>& indices, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& texcoords)
+{
+	QVector<int> newIndex(static_cast<int>(vertices.size() / 3), -1);
+	std::vector<float> newVertices, newNormals, newTexcoords;
+	newVertices.reserve(vertices.size());
+	newNormals.reserve(normals.size());
+	newTexcoords.reserve(texcoords.size());
+	for (auto& index : indices)
+	{
+		if (newIndex[index] < 0)
+		{
+			newIndex[index] = static_cast<int>(newVertices.size() / 3);
+			newVertices.insert(newVertices.end(), vertices.begin() + index * 3, vertices.begin() + index * 3 + 3);
+			newNormals.insert(newNormals.end(), normals.begin() + index * 3, normals.begin() + index * 3 + 3);
+			newTexcoords.insert(newTexcoords.end(), texcoords.begin() + index * 3, texcoords.begin() + index * 3 + 3);
+		}
+		index = newIndex[index];
+	}
+	vertices.swap(newVertices);
+	normals.swap(newNormals);
+	texcoords.swap(newTexcoords);
+}
+
+void GameEngine::MeshOptimizer::optimize(std::vector<quint32>& indices, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& texcoords)
+{
+	auto vertexCount = static_cast<int>(vertices.size() / 3);
+	auto before = acmr(indices, vertexCount);
+	QVector<int> clusters;
+	optimizeVertexCache(indices, vertexCount, &clusters);
+	optimizeOverdraw(indices, vertices, clusters, OVERDRAW_THRESHOLD);
+	optimizeVertexFetch(indices, vertices, normals, texcoords);
+	DEBUG_LOG("> MeshOptimizer: " << indices.size() / 3 << " triangles, ACMR " << before << " -> " << acmr(indices, static_cast<int>(vertices.size() / 3)));
+}
+
+GameEngine::Mesh* GameEngine::MeshOptimizer::optimize(const Mesh& mesh)
+{
+	std::vector<float> vertices, normals, texcoords;
+	vertices.reserve(mesh.uniqueVertexCount() * 3);
+	normals.reserve(mesh.uniqueVertexCount() * 3);
+	texcoords.reserve(mesh.uniqueVertexCount() * 3);
+	for (auto i = 0; i < mesh.uniqueVertexCount(); i++)
+	{
+		QVector3D v, n, coord;
+		mesh.getUniqueVertexData(i, v, n, coord);
+		for (auto j = 0; j < 3; j++)
+		{
+			vertices.push_back(v[j]);
+			normals.push_back(n[j]);
+			texcoords.push_back(coord[j]);
+		}
+	}
+	std::vector<quint32> indices(mesh.indexCount());
+	for (auto i = 0; i < mesh.indexCount(); i++)
+		indices[i] = mesh.getIndex(i);
+
+	optimize(indices, vertices, normals, texcoords);
+	return new Mesh(std::move(vertices), std::move(normals), std::move(texcoords), std::move(indices));
+}
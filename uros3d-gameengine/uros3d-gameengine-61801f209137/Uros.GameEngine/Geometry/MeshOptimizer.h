@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <QVector>
+#include "Includes.h"
+
+namespace GameEngine {
+	class Mesh;
+
+	/*
+	Reorders triangles and vertices of indexed geometry for the GPU, following Tipsify (Sander, Nehab & Barczak).
+	Triangles are first ordered for post-transform vertex cache reuse, the resulting clusters are then sorted so
+	outward facing ones are drawn first, and finally vertices are laid out in the order they are first fetched.
+	Geometry itself never changes, only the order it is stored in.
+	*/
+	class MeshOptimizer final
+	{
+		NOCOPY(MeshOptimizer)
+		MeshOptimizer();
+		~MeshOptimizer();
+
+	public:
+		enum
+		{
+			CacheSize = 16
+		};
+
+		/*
+		Average cache miss ratio, transformed vertices per triangle with a FIFO cache of CacheSize entries.
+		Goes from 3 for no reuse at all down to about 0.5 for large regular meshes.
+		*/
+		EXPORT static float acmr(const std::vector<quint32>& indices, int vertexCount);
+		EXPORT static float acmr(const Mesh& mesh);
+
+		/*
+		Orders triangles as fans around vertices still in cache. When clusters isn't null, it receives the first
+		triangle of every run that had to restart from a cold cache.
+		*/
+		EXPORT static void optimizeVertexCache(std::vector<quint32>& indices, int vertexCount, QVector<int>* clusters = nullptr);
+		/*
+		Splits clusters further where the cache has warmed up to within threshold of the cluster's own ACMR, then
+		sorts them by how much they face away from the mesh centre. Threshold of 1 keeps the cache order intact.
+		*/
+		EXPORT static void optimizeOverdraw(std::vector<quint32>& indices, const std::vector<float>& vertices, const QVector<int>& clusters, float threshold);
+		/*
+		Moves vertices into the order indices first refer to them, vertices no triangle uses are dropped.
+		*/
+		EXPORT static void optimizeVertexFetch(std::vector<quint32>& indices, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& texcoords);
+
+		/*
+		Runs all three passes in order on buffers of the layout Mesh takes over.
+		*/
+		EXPORT static void optimize(std::vector<quint32>& indices, std::vector<float>& vertices, std::vector<float>& normals, std::vector<float>& texcoords);
+		/*
+		Returns a new, optimized copy of the mesh.
+		*/
+		EXPORT static Mesh* optimize(const Mesh& mesh);
+	};
+}
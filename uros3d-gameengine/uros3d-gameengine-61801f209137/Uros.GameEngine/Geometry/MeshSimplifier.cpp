@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <vector>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include "MeshSimplifier.h"
+#include "Mesh.h"
+
+GameEngine::Mesh* GameEngine::MeshSimplifier::simplify(const Mesh& mesh, int targetTriangles)
+{
+	auto vertexCount = mesh.uniqueVertexCount();
+	QVector<QVector3D> positions(vertexCount);
+	QVector<QVector3D> normals(vertexCount);
+	QVector<QVector3D> texcoords(vertexCount);
+	for (auto i = 0; i < vertexCount; i++)
+		mesh.getUniqueVertexData(i, positions[i], normals[i], texcoords[i]);
+	std::vector<quint32> indices(mesh.indexCount());
+	for (auto i = 0; i < mesh.indexCount(); i++)
+		indices[i] = mesh.getIndex(i);
+
+	// Corners at one position form one vertex of the topology, whatever their normals and texture coordinates.
+	// Each such vertex is represented by the first of its corners.
+	QVector<int> order(vertexCount);
+	for (auto i = 0; i < vertexCount; i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](int a, int b)
+	          {
+		          const auto& p = positions[a];
+		          const auto& q = positions[b];
+		          if (p.x() != q.x())
+			          return p.x() < q.x();
+		          if (p.y() != q.y())
+			          return p.y() < q.y();
+		          if (p.z() != q.z())
+			          return p.z() < q.z();
+		          return a < b;
+	          });
+	QVector<int> remap(vertexCount);
+	QVector<int> corners(vertexCount, 0);
+	for (auto i = 0; i < vertexCount; i++)
+	{
+		auto first = i > 0 && positions[order[i]] == positions[order[i - 1]] ? remap[order[i - 1]] : order[i];
+		remap[order[i]] = first;
+		corners[first]++;
+	}
+
+	// Seams and open borders stay locked, an edge used by a single triangle is on a border
+	QVector<bool> locked(vertexCount);
+	for (auto i = 0; i < vertexCount; i++)
+		locked[i] = corners[i] > 1;
+	QHash<quint64, int> edges;
+	auto edgeKey = [](quint32 a, quint32 b)
+	{
+		return a < b ? quint64(a) << 32 | b : quint64(b) << 32 | a;
+	};
+	for (size_t i = 0; i < indices.size(); i += 3)
+		for (auto j = 0; j < 3; j++)
+			edges[edgeKey(remap[indices[i + j]], remap[indices[i + (j + 1) % 3]])]++;
+	for (auto it = edges.constBegin(); it != edges.constEnd(); ++it)
+		if (it.value() == 1)
+			locked[static_cast<int>(it.key() >> 32)] = locked[static_cast<int>(it.key() & 0xffffffff)] = true;
+
+	QVector<Quadric> quadrics(vertexCount);
+	for (auto& quadric : quadrics)
+		std::fill(quadric.a, quadric.a + 10, 0.0);
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		Quadric plane;
+		std::fill(plane.a, plane.a + 10, 0.0);
+		addPlane(plane, positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]);
+		for (auto j = 0; j < 3; j++)
+			add(quadrics[remap[indices[i + j]]], plane);
+	}
+
+	// Collapses go in passes, each vertex takes part in at most one collapse per pass
+	auto triangleCount = static_cast<int>(indices.size() / 3);
+	QVector<int> target(vertexCount);
+	QVector<bool> touched(vertexCount);
+	QVector<int> adjacencyOffsets(vertexCount + 1);
+	QVector<int> adjacency;
+	QVector<QPair<double, quint64>> collapses;
+	while (triangleCount > targetTriangles)
+	{
+		// Triangles around every topology vertex
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (auto index : indices)
+			adjacencyOffsets[remap[index] + 1]++;
+		for (auto i = 0; i < vertexCount; i++)
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		adjacency.resize(static_cast<int>(indices.size()));
+		auto fill = adjacencyOffsets;
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency[fill[remap[indices[i]]]++] = static_cast<int>(i / 3);
+
+		// Vertex u moves onto v, v keeps its corner, so it can't be on a seam
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3)
+			for (auto j = 0; j < 3; j++)
+			{
+				auto a = remap[indices[i + j]];
+				auto b = remap[indices[i + (j + 1) % 3]];
+				for (auto k = 0; k < 2; k++, std::swap(a, b))
+					if (!locked[a] && corners[b] == 1)
+					{
+						Quadric quadric = quadrics[a];
+						add(quadric, quadrics[b]);
+						collapses.push_back(qMakePair(error(quadric, positions[b]), quint64(a) << 32 | quint64(b)));
+					}
+			}
+		std::sort(collapses.begin(), collapses.end());
+
+		for (auto i = 0; i < vertexCount; i++)
+			target[i] = i;
+		std::fill(touched.begin(), touched.end(), false);
+		auto collapsed = 0;
+		for (const auto& collapse : collapses)
+		{
+			if (triangleCount <= targetTriangles)
+				break;
+			auto u = static_cast<int>(collapse.second >> 32);
+			auto v = static_cast<int>(collapse.second & 0xffffffff);
+			if (touched[u] || touched[v])
+				continue;
+
+			// Triangles around u must not flip, those shared with v disappear
+			auto flips = false;
+			auto removed = 0;
+			for (auto j = adjacencyOffsets[u]; j < adjacencyOffsets[u + 1] && !flips; j++)
+			{
+				auto triangle = adjacency[j] * 3;
+				QVector3D before[3], after[3];
+				auto sharesV = false;
+				for (auto k = 0; k < 3; k++)
+				{
+					auto vertex = remap[indices[triangle + k]];
+					sharesV |= vertex == v;
+					before[k] = positions[vertex];
+					after[k] = vertex == u ? positions[v] : before[k];
+				}
+				if (sharesV)
+				{
+					removed++;
+					continue;
+				}
+				auto normalBefore = QVector3D::crossProduct(before[1] - before[0], before[2] - before[0]);
+				auto normalAfter = QVector3D::crossProduct(after[1] - after[0], after[2] - after[0]);
+				flips = QVector3D::dotProduct(normalBefore, normalAfter) <= 0;
+			}
+			if (flips || !removed)
+				continue;
+
+			// Neighbours of u are left for the next pass, their triangles change shape now
+			for (auto j = adjacencyOffsets[u]; j < adjacencyOffsets[u + 1]; j++)
+				for (auto k = 0; k < 3; k++)
+					touched[remap[indices[adjacency[j] * 3 + k]]] = true;
+			target[u] = v;
+			add(quadrics[v], quadrics[u]);
+			triangleCount -= removed;
+			collapsed++;
+		}
+		if (!collapsed)
+			break;
+
+		// Collapsed corners take over the corner of their target, triangles left without area are dropped
+		std::vector<quint32> kept;
+		kept.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			quint32 triangle[3];
+			for (auto j = 0; j < 3; j++)
+			{
+				auto vertex = remap[indices[i + j]];
+				triangle[j] = target[vertex] != vertex ? target[vertex] : indices[i + j];
+			}
+			if (remap[triangle[0]] != remap[triangle[1]] && remap[triangle[1]] != remap[triangle[2]] && remap[triangle[0]] != remap[triangle[2]])
+				kept.insert(kept.end(), triangle, triangle + 3);
+		}
+		indices.swap(kept);
+		triangleCount = static_cast<int>(indices.size() / 3);
+	}
+
+	// Only vertices still in use are kept
+	QVector<int> newIndex(vertexCount, -1);
+	std::vector<float> newVertices, newNormals, newTexcoords;
+	for (auto& index : indices)
+	{
+		if (newIndex[index] < 0)
+		{
+			newIndex[index] = static_cast<int>(newVertices.size() / 3);
+			for (auto j = 0; j < 3; j++)
+			{
+				newVertices.push_back(positions[index][j]);
+				newNormals.push_back(normals[index][j]);
+				newTexcoords.push_back(texcoords[index][j]);
+			}
+		}
+		index = newIndex[index];
+	}
+	return new Mesh(std::move(newVertices), std::move(newNormals), std::move(newTexcoords), std::move(indices));
+}
+
+void GameEngine::MeshSimplifier::addPlane(Quadric& quadric, const QVector3D& a, const QVector3D& b, const QVector3D& c)
+{
+	// Planes are weighted by triangle area, so large flat areas resist more than slivers
+	auto cross = QVector3D::crossProduct(b - a, c - a);
+	double length = cross.length();
+	if (length <= 0)
+		return;
+	double area = length / 2;
+	double x = cross.x() / length, y = cross.y() / length, z = cross.z() / length;
+	double d = -(x * a.x() + y * a.y() + z * a.z());
+	double plane[10] = { x * x, x * y, x * z, y * y, y * z, z * z, x * d, y * d, z * d, d * d };
+	for (auto i = 0; i < 10; i++)
+		quadric.a[i] += plane[i] * area;
+}
+
+void GameEngine::MeshSimplifier::add(Quadric& quadric, const Quadric& other)
+{
+	for (auto i = 0; i < 10; i++)
+		quadric.a[i] += other.a[i];
+}
+
+double GameEngine::MeshSimplifier::error(const Quadric& quadric, const QVector3D& point)
+{
+	double x = point.x(), y = point.y(), z = point.z();
+	const auto& a = quadric.a;
+	return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + a[3] * y * y + 2 * a[4] * y * z + a[5] * z * z
+		+ 2 * (a[6] * x + a[7] * y + a[8] * z) + a[9];
+}
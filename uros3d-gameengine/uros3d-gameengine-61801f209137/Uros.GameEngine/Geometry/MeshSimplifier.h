@@ -0,0 +1,36 @@
+#pragma once
+#include <QVector3D>
+#include "Includes.h"
+
+namespace GameEngine {
+	class Mesh;
+
+	/*
+	Reduces triangle count of a mesh by collapsing edges in order of their quadric error (Garland & Heckbert).
+	Every collapse moves one vertex onto a neighbouring one, so no new vertices or attributes are made up.
+	Vertices on open borders and on seams, where corners at one position differ in normal or texture
+	coordinate, never move, which keeps holes, outlines and texture seams where they were.
+	*/
+	class MeshSimplifier final
+	{
+		NOCOPY(MeshSimplifier)
+		MeshSimplifier();
+		~MeshSimplifier();
+
+	public:
+		/*
+		Returns a new mesh with at most targetTriangles triangles, or as close to it as collapses allowed.
+		*/
+		EXPORT static Mesh* simplify(const Mesh& mesh, int targetTriangles);
+
+	private:
+		struct Quadric
+		{
+			double a[10]; // xx, xy, xz, yy, yz, zz of the plane normal product, then normal times offset and offset squared
+		};
+
+		static void addPlane(Quadric& quadric, const QVector3D& a, const QVector3D& b, const QVector3D& c);
+		static void add(Quadric& quadric, const Quadric& other);
+		static double error(const Quadric& quadric, const QVector3D& point);
+	};
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <QtGlobal>
+#include "Includes.h"
+
+namespace GameEngine {
+	/*
+	Helpers for 30-bit Morton (Z-order) codes, 10 bits per axis.
+	*/
+	class Morton final
+	{
+		NOCOPY(Morton)
+		Morton();
+		~Morton();
+
+	public:
+		static quint32 expandBits(quint32 value)
+		{
+			value &= 0x000003ff;
+			value = (value | (value << 16)) & 0x030000ff;
+			value = (value | (value << 8)) & 0x0300f00f;
+			value = (value | (value << 4)) & 0x030c30c3;
+			value = (value | (value << 2)) & 0x09249249;
+			return value;
+		}
+
+		static quint32 compactBits(quint32 value)
+		{
+			value &= 0x09249249;
+			value = (value | (value >> 2)) & 0x030c30c3;
+			value = (value | (value >> 4)) & 0x0300f00f;
+			value = (value | (value >> 8)) & 0x030000ff;
+			value = (value | (value >> 16)) & 0x000003ff;
+			return value;
+		}
+
+		static quint32 encode(quint32 x, quint32 y, quint32 z)
+		{
+			return expandBits(x) | (expandBits(y) << 1) | (expandBits(z) << 2);
+		}
+
+		static void decode(quint32 code, quint32& x, quint32& y, quint32& z)
+		{
+			x = compactBits(code);
+			y = compactBits(code >> 1);
+			z = compactBits(code >> 2);
+		}
+	};
+}
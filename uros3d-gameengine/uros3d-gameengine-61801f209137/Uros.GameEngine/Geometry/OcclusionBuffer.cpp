@@ -0,0 +1,211 @@
+#include <QVector4D>
+#include "OcclusionBuffer.h"
+#include "GeometryBase.h"
+
+#define MIN_W 1e-5f
+#define MIN_AREA 1e-6f
+
+GameEngine::OcclusionBuffer::OcclusionBuffer(int width, int height)
+	: _width(width),
+	  _height(height),
+	  _tilesX(width / TileSize),
+	  _triangleCount(0)
+{
+	if (width <= 0 || height <= 0 || width % TileSize || height % TileSize)
+		throw std::logic_error("OcclusionBuffer::OcclusionBuffer: Dimensions must be positive multiples of tile size.");
+
+	_depth.fill(1, width * height);
+	_tileDepth.fill(1, _tilesX * (height / TileSize));
+}
+
+int GameEngine::OcclusionBuffer::width() const
+{
+	return _width;
+}
+
+int GameEngine::OcclusionBuffer::height() const
+{
+	return _height;
+}
+
+int GameEngine::OcclusionBuffer::triangleCount() const
+{
+	return _triangleCount;
+}
+
+float GameEngine::OcclusionBuffer::depth(int x, int y) const
+{
+	Q_ASSERT(x >= 0 && x < _width && y >= 0 && y < _height);
+
+	auto tile = y / TileSize * _tilesX + x / TileSize;
+	return _depth[tile * TileSize * TileSize + y % TileSize * TileSize + x % TileSize];
+}
+
+void GameEngine::OcclusionBuffer::clear(const QMatrix4x4& viewProjection)
+{
+	_viewProjection = viewProjection;
+	_depth.fill(1);
+	_tileDepth.fill(1);
+	_triangleCount = 0;
+}
+
+void GameEngine::OcclusionBuffer::rasterize(const QVector3D& v0, const QVector3D& v1, const QVector3D& v2)
+{
+	QVector3D s0, s1, s2;
+	if (project(_viewProjection, v0, &s0) && project(_viewProjection, v1, &s1) && project(_viewProjection, v2, &s2))
+	{
+		rasterizeScreen(s0, s1, s2);
+		_triangleCount++;
+	}
+}
+
+void GameEngine::OcclusionBuffer::rasterize(const GeometryBase& geometry, const QMatrix4x4& model)
+{
+	auto matrix = _viewProjection * model;
+	for (auto i = 0; i < geometry.triangleCount(); i++)
+	{
+		QVector3D v0, v1, v2, n0, n1, n2;
+		geometry.getTriangleData(i, v0, v1, v2, n0, n1, n2);
+		QVector3D s0, s1, s2;
+		if (project(matrix, v0, &s0) && project(matrix, v1, &s1) && project(matrix, v2, &s2))
+		{
+			rasterizeScreen(s0, s1, s2);
+			_triangleCount++;
+		}
+	}
+}
+
+bool GameEngine::OcclusionBuffer::isOccluded(const BoundingBox& box) const
+{
+	const auto& min = box.minPoint();
+	const auto& max = box.maxPoint();
+	auto minX = std::numeric_limits<float>::max();
+	auto minY = std::numeric_limits<float>::max();
+	auto minZ = std::numeric_limits<float>::max();
+	auto maxX = std::numeric_limits<float>::lowest();
+	auto maxY = std::numeric_limits<float>::lowest();
+	for (auto i = 0; i < 8; i++)
+	{
+		QVector3D corner(i & 1 ? max.x() : min.x(), i & 2 ? max.y() : min.y(), i & 4 ? max.z() : min.z());
+		QVector3D screen;
+		// Boxes reaching behind the camera can't be hidden by anything in front of it
+		if (!project(_viewProjection, corner, &screen))
+			return false;
+		minX = qMin(minX, screen.x());
+		minY = qMin(minY, screen.y());
+		minZ = qMin(minZ, screen.z());
+		maxX = qMax(maxX, screen.x());
+		maxY = qMax(maxY, screen.y());
+	}
+
+	if (maxX < 0 || maxY < 0 || minX >= _width || minY >= _height)
+		return false;
+	auto x0 = static_cast<int>(qMax(0.0f, minX));
+	auto y0 = static_cast<int>(qMax(0.0f, minY));
+	auto x1 = static_cast<int>(qMin(_width - 1.0f, maxX));
+	auto y1 = static_cast<int>(qMin(_height - 1.0f, maxY));
+
+	// Box is hidden if every pixel it covers holds something nearer than its nearest point
+	for (auto ty = y0 / TileSize; ty <= y1 / TileSize; ty++)
+		for (auto tx = x0 / TileSize; tx <= x1 / TileSize; tx++)
+		{
+			auto tile = ty * _tilesX + tx;
+			if (_tileDepth[tile] < minZ)
+				continue;
+
+			auto pixels = _depth.constData() + tile * TileSize * TileSize;
+			for (auto y = qMax(y0, ty * TileSize); y <= qMin(y1, ty * TileSize + TileSize - 1); y++)
+				for (auto x = qMax(x0, tx * TileSize); x <= qMin(x1, tx * TileSize + TileSize - 1); x++)
+					if (pixels[y % TileSize * TileSize + x % TileSize] >= minZ)
+						return false;
+		}
+	return true;
+}
+
+bool GameEngine::OcclusionBuffer::project(const QMatrix4x4& matrix, const QVector3D& point, QVector3D* screen) const
+{
+	auto clip = matrix * QVector4D(point, 1);
+	if (clip.w() < MIN_W)
+		return false;
+
+	auto ndc = clip.toVector3D() / clip.w();
+	*screen = QVector3D((ndc.x() * 0.5f + 0.5f) * _width, (ndc.y() * 0.5f + 0.5f) * _height, ndc.z() * 0.5f + 0.5f);
+	return screen->z() >= 0;
+}
+
+void GameEngine::OcclusionBuffer::rasterizeScreen(QVector3D s0, QVector3D s1, QVector3D s2)
+{
+	auto area = (s1.x() - s0.x()) * (s2.y() - s0.y()) - (s1.y() - s0.y()) * (s2.x() - s0.x());
+	if (qAbs(area) < MIN_AREA)
+		return;
+	// Occluders are drawn from both sides, so just fix the winding
+	if (area < 0)
+	{
+		std::swap(s1, s2);
+		area = -area;
+	}
+
+	// Edge functions and depth are linear in screen space, f(x, y) = a * x + b * y + c
+	const QVector3D* vertices[] = { &s0, &s1, &s2 };
+	float a[3], b[3], c[3];
+	float za = 0, zb = 0, zc = 0;
+	for (auto i = 0; i < 3; i++)
+	{
+		const auto& p = *vertices[(i + 1) % 3];
+		const auto& q = *vertices[(i + 2) % 3];
+		a[i] = p.y() - q.y();
+		b[i] = q.x() - p.x();
+		c[i] = p.x() * q.y() - p.y() * q.x();
+		za += a[i] * vertices[i]->z() / area;
+		zb += b[i] * vertices[i]->z() / area;
+		zc += c[i] * vertices[i]->z() / area;
+	}
+
+	auto minX = qMin(s0.x(), qMin(s1.x(), s2.x()));
+	auto minY = qMin(s0.y(), qMin(s1.y(), s2.y()));
+	auto maxX = qMax(s0.x(), qMax(s1.x(), s2.x()));
+	auto maxY = qMax(s0.y(), qMax(s1.y(), s2.y()));
+	if (maxX < 0 || maxY < 0 || minX >= _width || minY >= _height)
+		return;
+	auto x0 = static_cast<int>(qMax(0.0f, minX));
+	auto y0 = static_cast<int>(qMax(0.0f, minY));
+	auto x1 = static_cast<int>(qMin(_width - 1.0f, maxX));
+	auto y1 = static_cast<int>(qMin(_height - 1.0f, maxY));
+
+	for (auto ty = y0 / TileSize; ty <= y1 / TileSize; ty++)
+		for (auto tx = x0 / TileSize; tx <= x1 / TileSize; tx++)
+		{
+			auto tile = ty * _tilesX + tx;
+			auto pixels = _depth.data() + tile * TileSize * TileSize;
+			auto written = false;
+			for (auto y = qMax(y0, ty * TileSize); y <= qMin(y1, ty * TileSize + TileSize - 1); y++)
+			{
+				auto py = y + 0.5f;
+				for (auto x = qMax(x0, tx * TileSize); x <= qMin(x1, tx * TileSize + TileSize - 1); x++)
+				{
+					auto px = x + 0.5f;
+					if (a[0] * px + b[0] * py + c[0] < 0 || a[1] * px + b[1] * py + c[1] < 0 || a[2] * px + b[2] * py + c[2] < 0)
+						continue;
+					auto z = za * px + zb * py + zc;
+					auto& pixel = pixels[y % TileSize * TileSize + x % TileSize];
+					if (z < pixel)
+					{
+						pixel = z;
+						written = true;
+					}
+				}
+			}
+			if (written)
+				updateTile(tile);
+		}
+}
+
+void GameEngine::OcclusionBuffer::updateTile(int tile)
+{
+	// Tile is contiguous, so the compiler is free to vectorize this
+	auto pixels = _depth.constData() + tile * TileSize * TileSize;
+	auto farthest = pixels[0];
+	for (auto i = 1; i < TileSize * TileSize; i++)
+		farthest = qMax(farthest, pixels[i]);
+	_tileDepth[tile] = farthest;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <QMatrix4x4>
+#include <QVector>
+#include <QVector3D>
+#include "Includes.h"
+#include "BoundingBox.h"
+
+namespace GameEngine {
+	class GeometryBase;
+
+	/*
+	Low resolution depth buffer rasterized on the CPU. Occluders are drawn into it and bounding boxes of other
+	objects are then tested against it. Pixels are stored in 8x8 tiles, each tile keeps its farthest depth, so
+	most boxes are accepted or rejected on the tile level. Depth goes from 0 at the near plane to 1 at the far.
+	*/
+	class OcclusionBuffer final
+	{
+		NOCOPY(OcclusionBuffer)
+
+	public:
+		enum
+		{
+			TileSize = 8
+		};
+
+		/*
+		Both dimensions must be multiples of tile size.
+		*/
+		EXPORT OcclusionBuffer(int width = 256, int height = 128);
+		EXPORT int width() const;
+		EXPORT int height() const;
+		EXPORT int triangleCount() const;
+		EXPORT float depth(int x, int y) const;
+		/*
+		Clears the buffer, following calls project everything with specified view projection matrix.
+		*/
+		EXPORT void clear(const QMatrix4x4& viewProjection);
+		/*
+		Rasterizes a triangle in world space. Triangles crossing the near plane are skipped, which is safe
+		since missing occluders only make the test less effective.
+		*/
+		EXPORT void rasterize(const QVector3D& v0, const QVector3D& v1, const QVector3D& v2);
+		EXPORT void rasterize(const GeometryBase& geometry, const QMatrix4x4& model);
+		/*
+		Returns true if the box is completely hidden behind rasterized occluders.
+		*/
+		EXPORT bool isOccluded(const BoundingBox& box) const;
+
+	private:
+		bool project(const QMatrix4x4& matrix, const QVector3D& point, QVector3D* screen) const;
+		void rasterizeScreen(QVector3D s0, QVector3D s1, QVector3D s2);
+		void updateTile(int tile);
+
+		QMatrix4x4 _viewProjection;
+		QVector<float> _depth; // Tile after tile, rows within a tile
+		QVector<float> _tileDepth; // Farthest depth in each tile
+		int _width;
+		int _height;
+		int _tilesX;
+		int _triangleCount;
+	};
+}
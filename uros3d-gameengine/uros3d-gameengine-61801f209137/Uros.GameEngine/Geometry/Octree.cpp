@@ -4,80 +4,106 @@
 #include "OctreeNode.h"
 #include "GameObject.h"
 #include "Intersect.h"
+#include "CullingFrustum.h"
+#include "AabbBlock.h"
+#include "TaskPool.h"
 #include "Rendering/MeshRenderer.h"
 
-GameEngine::Octree::Octree()
+#define TASKS_PER_THREAD 4
+
+GameEngine::Octree::Octree(int splitThreshold, int mergeThreshold, int maxDepth)
 	: OctreeNode(nullptr, QVector3D(), 0),
-	  _initialized(false) {}
+	  _splitThreshold(splitThreshold),
+	  _mergeThreshold(mergeThreshold),
+	  _maxDepth(maxDepth),
+	  _reroots(0),
+	  _initialized(false)
+{
+	if (_mergeThreshold >= _splitThreshold)
+		throw std::logic_error("Octree::Octree: Merge threshold must be lower than split threshold.");
+	if (_maxDepth < 1)
+		throw std::logic_error("Octree::Octree: Maximum depth must be at least 1.");
+}
 
 GameEngine::Octree::~Octree() {}
 
-bool GameEngine::Octree::findGameObject(GameObject* gameObject, QVector<OctreeNode*>& nodes) const
+bool GameEngine::Octree::findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const
 {
 	auto it = _mapping.constFind(gameObject);
 	if (it != _mapping.constEnd())
 	{
-		nodes = *it;
+		nodes.clear();
+		for (auto node : *it)
+			nodes.push_back(node->boundingBox());
 		return true;
 	}
 	return false;
 }
 
-bool GameEngine::Octree::raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint) const
+bool GameEngine::Octree::raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode, float maxDistance) const
 {
-	gameObject = nullptr;
-	QMap<float, GameObject*> candidates;
-	QMap<float, const OctreeNode*> leafNodes;
-	getIntersectingLeafNodes(ray, leafNodes);
-	if (leafNodes.count() > 0)
-	{
-		for (auto leafNode : leafNodes)
-			for (auto gObject : leafNode->gameObjects())
-				if (auto meshRenderer = gObject->getComponent<MeshRenderer>())
-				{
-					float t;
-					if (Intersect::rayAndAABB(ray, meshRenderer->boundingBox(), &t))
-						candidates.insert(t, gObject);
-				}
-	}
+	RaycastCandidates candidates;
+	raycastProtected(ray, maxDistance, candidates);
 	// Don't forget them outliers...
 	for (auto gObject : _outliers)
 		if (auto meshRenderer = gObject->getComponent<MeshRenderer>())
 		{
 			float t;
-			if (Intersect::rayAndAABB(ray, meshRenderer->boundingBox(), &t))
-				candidates.insert(t, gObject);
+			if (Intersect::rayAndAABB(ray, meshRenderer->boundingBox(), &t) && t < maxDistance)
+				candidates.push_back(qMakePair(t, gObject));
 		}
-	for (auto gObject : candidates)
+	gameObject = raycastCandidates(ray, candidates, mode, maxDistance, hitPoint);
+	return gameObject;
+}
+
+void GameEngine::Octree::intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const
+{
+	intersectProtected(frustum, gameObjects);
+	AabbBlock::intersect(frustum, _outliers, gameObjects);
+}
+
+void GameEngine::Octree::intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const
+{
+	intersectProtected(frustums, frustums.views(), gameObjects);
+	frustums.intersect(_outliers, frustums.views(), gameObjects);
+}
+
+void GameEngine::Octree::intersectParallel(const CullingFrustum& frustum, QList<GameObject*>& gameObjects, TaskPool& pool) const
+{
+	// Open up visible inner nodes level by level until there's enough subtrees to keep every thread busy,
+	// children replace their parent in place, so the subtrees stay in the order the serial descent visits them
+	QVector<const OctreeNode*> subtrees;
+	subtrees.push_back(this);
+	auto expanded = true;
+	while (expanded && subtrees.count() < pool.threadCount() * TASKS_PER_THREAD)
 	{
-		float t;
-		//TODO: Use colliders here when implemented
-		QMatrix4x4 mat = gObject->transform()->getMatrix();
-		auto mesh = gObject->getComponent<MeshRenderer>()->getMesh();
-		for (int j = 0; j < mesh->triangleCount(); j++)
+		expanded = false;
+		QVector<const OctreeNode*> next;
+		for (auto node : subtrees)
 		{
-			QVector3D t0, t1, t2, n0, n1, n2;
-			mesh->getTriangleData(j, t0, t1, t2, n0, n1, n2);
-			t0 = mat * t0;
-			t1 = mat * t1;
-			t2 = mat * t2;
-			if (Intersect::rayAndTriangle(ray, t0, t1, t2, &t))
+			if (node->isLeaf())
+				next.push_back(node);
+			else if (frustum.intersects(node->boundingBox()))
 			{
-				gameObject = gObject;
-				*hitPoint = ray.origin() + ray.direction() * t;
-				return gameObject;
+				for (auto child : node->children())
+					next.push_back(child);
+				expanded = true;
 			}
 		}
+		subtrees = next;
 	}
-	return false;
-}
 
-void GameEngine::Octree::intersect(const CameraFrustum& frustum, QList<GameObject*>& gameObjects) const
-{
-	intersectProtected(frustum, gameObjects);
-	for (auto outlier : _outliers)
-		if (Intersect::frustumAndAABB(frustum, outlier->boundingBox()))
-			gameObjects.push_back(outlier);
+	QVector<CullingTask> tasks;
+	for (auto node : subtrees)
+		tasks.push_back([node, &frustum](QList<GameObject*>& visible)
+		{
+			node->intersectProtected(frustum, visible);
+		});
+	tasks.push_back([this, &frustum](QList<GameObject*>& visible)
+	{
+		AabbBlock::intersect(frustum, _outliers, visible);
+	});
+	runCullingTasks(tasks, gameObjects, pool);
 }
 
 void GameEngine::Octree::add(GameObject* gameObject)
@@ -87,59 +113,69 @@ void GameEngine::Octree::add(GameObject* gameObject)
 	QVector<OctreeNode*> nodes;
 	addProtected(gameObject, nodes);
 	if (nodes.count() > 0)
+	{
 		_mapping.insert(gameObject, nodes);
+		for (auto node : nodes)
+			split(node);
+	}
 	else
+	{
 		_outliers.insert(gameObject);
+		if (needsReroot(_outliers.count(), _mapping.count() + _outliers.count()))
+			reroot();
+	}
 }
 
 void GameEngine::Octree::remove(GameObject* gameObject)
 {
 	if (!_initialized)
 		return;
-	removeProtected(gameObject);
-	_mapping.remove(gameObject);
-	_outliers.remove(gameObject);
+	auto it = _mapping.find(gameObject);
+	if (it != _mapping.end())
+	{
+		QVector<OctreeNode*> parents;
+		for (auto node : *it)
+		{
+			node->_gameObjects.remove(gameObject);
+			if (node->parent())
+				parents.push_back(node->parent());
+		}
+		_mapping.erase(it);
+		merge(parents);
+	}
+	else
+		_outliers.remove(gameObject);
 }
 
-void GameEngine::Octree::update(GameObject* gameObject)
+bool GameEngine::Octree::update(GameObject* gameObject)
 {
 	if (!_initialized)
-		return;
+		return false;
+
+	auto it = _mapping.constFind(gameObject);
+	if (it != _mapping.constEnd())
+	{
+		// Nothing to do if the new bounds overlap the very same leaves
+		QVector<OctreeNode*> nodes;
+		findLeafNodes(gameObject->boundingBox(), nodes);
+		auto same = nodes.count() == it->count();
+		for (auto i = 0; same && i < nodes.count(); i++)
+			same = it->contains(nodes[i]);
+		if (same)
+			return false;
+	}
+
+	auto wasOutlier = _outliers.contains(gameObject);
 	remove(gameObject);
 	add(gameObject);
+	return !wasOutlier || !_outliers.contains(gameObject);
 }
 
 void GameEngine::Octree::initialize(const QVector<GameObject*>& gameObjects)
 {
-	float x, y, z;
-	float xMin, yMin, zMin;
-	float xMax, yMax, zMax;
-	xMin = yMin = zMin = std::numeric_limits<float>::max();
-	xMax = yMax = zMax = std::numeric_limits<float>::lowest();
-	for (auto gameObject : gameObjects)
-	{
-		auto min = gameObject->boundingBox().minPoint();
-		auto max = gameObject->boundingBox().maxPoint();
-		x = min[0];
-		y = min[1];
-		z = min[2];
-		xMin = x < xMin ? x : xMin;
-		yMin = y < yMin ? y : yMin;
-		zMin = z < zMin ? z : zMin;
-		xMax = x > xMax ? x : xMax;
-		yMax = y > yMax ? y : yMax;
-		zMax = z > zMax ? z : zMax;
-		x = max[0];
-		y = max[1];
-		z = max[2];
-		xMin = x < xMin ? x : xMin;
-		yMin = y < yMin ? y : yMin;
-		zMin = z < zMin ? z : zMin;
-		xMax = x > xMax ? x : xMax;
-		yMax = y > yMax ? y : yMax;
-		zMax = z > zMax ? z : zMax;
-	}
-	initialize(gameObjects, QVector3D(xMin, yMin, zMin), QVector3D(xMax, yMax, zMax));
+	QVector3D min, max;
+	bounds(gameObjects, min, max);
+	initialize(gameObjects, min, max);
 }
 
 void GameEngine::Octree::initialize(const QVector<GameObject*>& gameObjects, const QVector3D& min, const QVector3D& max)
@@ -162,5 +198,128 @@ void GameEngine::Octree::initialize(const QVector<GameObject*>& gameObjects, con
 	for (auto i = 0; i < gameObjects.count(); i++)
 		add(gameObjects[i]);
 
-	DEBUG_LOG("> Octree::initialize: took " << timer.elapsed() / 1000.0f << "s");
+	DEBUG_LOG("> Octree::initialize: took " << timer.elapsed() / 1000.0f << "s, " << nodeCount() << " nodes");
+}
+
+GameEngine::SpatialIndex::OutlierStats GameEngine::Octree::outlierStats() const
+{
+	OutlierStats stats = { _outliers.count(), _mapping.count() + _outliers.count(), _reroots };
+	return stats;
+}
+
+int GameEngine::Octree::nodeCount() const
+{
+	return countNodes();
+}
+
+void GameEngine::Octree::reroot()
+{
+	QTime timer;
+	timer.start();
+
+	auto gameObjects = _mapping.keys().toVector() + _outliers.toList().toVector();
+	QVector3D min, max;
+	grow(gameObjects, boundingBox(), min, max);
+
+	_mapping.clear();
+	_outliers.clear();
+	_gameObjects.clear();
+	init((min + max) / 2, max.x() - min.x());
+	for (auto gameObject : gameObjects)
+		add(gameObject);
+	_reroots++;
+
+	DEBUG_LOG("> Octree::reroot: took " << timer.elapsed() / 1000.0f << "s, " << gameObjects.count() << " objects");
+}
+
+void GameEngine::Octree::split(OctreeNode* node)
+{
+	if (node->_gameObjects.count() <= _splitThreshold || node->level() >= _maxDepth - 1)
+		return;
+
+	node->subdivide();
+	for (auto gameObject : node->_gameObjects)
+	{
+		auto& nodes = _mapping[gameObject];
+		nodes.removeOne(node);
+		const auto& box = gameObject->boundingBox();
+		for (auto child : node->_children)
+			if (Intersect::aabbAndAABB(child->boundingBox(), box))
+			{
+				child->_gameObjects.insert(gameObject);
+				nodes.push_back(child);
+			}
+		// Object has moved since it was last updated and no longer overlaps this node,
+		// keep it with the outliers until its update comes
+		if (nodes.isEmpty())
+		{
+			_mapping.remove(gameObject);
+			_outliers.insert(gameObject);
+		}
+	}
+	node->_gameObjects.clear();
+
+	for (auto child : node->_children)
+		split(child);
+}
+
+void GameEngine::Octree::merge(QVector<OctreeNode*> nodes)
+{
+	// Deepest nodes go first. Merging a node deletes only its children, which are
+	// deeper and were already processed, so no pointer in the list is left dangling
+	auto deeper = [](const OctreeNode* a, const OctreeNode* b)
+		{
+			return a->level() > b->level();
+		};
+	std::sort(nodes.begin(), nodes.end(), deeper);
+
+	QSet<OctreeNode*> processed;
+	for (auto i = 0; i < nodes.count(); i++)
+	{
+		auto node = nodes[i];
+		if (processed.contains(node))
+			continue;
+		processed.insert(node);
+		if (!canMerge(node))
+			continue;
+
+		QSet<GameObject*> gameObjects;
+		for (auto child : node->_children)
+			gameObjects.unite(child->_gameObjects);
+		for (auto gameObject : gameObjects)
+		{
+			auto& mapping = _mapping[gameObject];
+			for (auto child : node->_children)
+				mapping.removeOne(child);
+			mapping.push_back(node);
+		}
+		node->_gameObjects = gameObjects;
+		node->clear();
+
+		// Parent may be able to merge now too
+		if (auto parent = node->parent())
+			nodes.insert(std::upper_bound(nodes.begin() + i + 1, nodes.end(), parent, deeper), parent);
+	}
+}
+
+bool GameEngine::Octree::canMerge(const OctreeNode* node) const
+{
+	if (node->isLeaf())
+		return false;
+
+	auto count = 0;
+	for (auto child : node->_children)
+	{
+		if (!child->isLeaf() || child->_gameObjects.count() > _mergeThreshold)
+			return false;
+		count += child->_gameObjects.count();
+	}
+	if (count <= _mergeThreshold)
+		return true;
+
+	// Objects overlapping several children are counted more than once
+	QSet<GameObject*> gameObjects;
+	for (auto child : node->_children)
+		gameObjects.unite(child->_gameObjects);
+	return gameObjects.count() <= _mergeThreshold;
 }
@@ -2,29 +2,48 @@
 #include <QVector>
 #include "Includes.h"
 #include "OctreeNode.h"
+#include "SpatialIndex.h"
 
 namespace GameEngine {
 	class GameObject;
 
-	class Octree final : public OctreeNode
+	class Octree final : public SpatialIndex, public OctreeNode
 	{
 		NOCOPY(Octree)
 
 	public:
-		Octree();
-		~Octree();
-		bool findGameObject(GameObject* gameObject, QVector<OctreeNode*>& nodes) const;
-		bool raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint) const;
-		void intersect(const CameraFrustum& frustum, QList<GameObject*>& gameObjects) const;
-		void add(GameObject* gameObject);
-		void remove(GameObject* gameObject);
-		void update(GameObject* gameObject);
-		void initialize(const QVector<GameObject*>& gameObjects);
-		void initialize(const QVector<GameObject*>& gameObjects, const QVector3D& min, const QVector3D& max);
+		/*
+		Leaves are split when they hold more than splitThreshold objects and siblings are merged back
+		when together they hold mergeThreshold objects or less. Tree never gets deeper than maxDepth.
+		*/
+		EXPORT Octree(int splitThreshold = 16, int mergeThreshold = 8, int maxDepth = 8);
+		EXPORT ~Octree();
+		EXPORT bool findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const override;
+		EXPORT bool raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode = ClosestHit,
+		                    float maxDistance = std::numeric_limits<float>::max()) const override;
+		EXPORT void intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const override;
+		EXPORT void intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const override;
+		EXPORT void intersectParallel(const CullingFrustum& frustum, QList<GameObject*>& gameObjects, TaskPool& pool) const override;
+		EXPORT void add(GameObject* gameObject) override;
+		EXPORT void remove(GameObject* gameObject) override;
+		EXPORT bool update(GameObject* gameObject) override;
+		EXPORT void initialize(const QVector<GameObject*>& gameObjects) override;
+		EXPORT void initialize(const QVector<GameObject*>& gameObjects, const QVector3D& min, const QVector3D& max);
+		EXPORT OutlierStats outlierStats() const override;
+		EXPORT int nodeCount() const;
 
 	private:
+		void reroot();
+		void split(OctreeNode* node);
+		void merge(QVector<OctreeNode*> nodes);
+		bool canMerge(const OctreeNode* node) const;
+
 		QHash<GameObject*, QVector<OctreeNode*>> _mapping;
 		QSet<GameObject*> _outliers;
+		int _splitThreshold;
+		int _mergeThreshold;
+		int _maxDepth;
+		int _reroots;
 		bool _initialized;
 	};
 }
@@ -1,13 +1,14 @@
 #include "OctreeNode.h"
 #include "GameObject.h"
 #include "Intersect.h"
-#include "Scene/Camera.h"
-
-#define MAX_DEPTH 4
+#include "CullingFrustum.h"
+#include "AabbBlock.h"
+#include "Rendering/MeshRenderer.h"
 
 GameEngine::OctreeNode::OctreeNode(OctreeNode* parent, const QVector3D& center, float size)
 	: _level(parent ? parent->level() + 1 : 0),
-	  _parent(parent)
+	  _parent(parent),
+	  _lastPlane(0)
 {
 	init(center, size);
 }
@@ -22,21 +23,56 @@ const GameEngine::BoundingBox& GameEngine::OctreeNode::boundingBox() const
 	return _bbox;
 }
 
-void GameEngine::OctreeNode::intersectProtected(const CameraFrustum& frustum, QList<GameObject*>& gameObjects) const
+int GameEngine::OctreeNode::countNodes() const
 {
-	const auto& frustumBox = frustum.boundingBox();
-	if (Intersect::aabbAndAABB(frustumBox, _bbox))
-		if (Intersect::frustumAndAABB(frustum, _bbox))
-		{
+	auto count = 1;
+	for (auto child : _children)
+		count += child->countNodes();
+	return count;
+}
+
+void GameEngine::OctreeNode::intersectProtected(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const
+{
+	switch (frustum.classify(_bbox, _lastPlane))
+	{
+		case CullingFrustum::Inside:
+			collectProtected(gameObjects);
+			break;
+		case CullingFrustum::Intersecting:
 			if (!isLeaf())
 				for (auto i = 0; i < _children.count(); i++)
 					_children[i]->intersectProtected(frustum, gameObjects);
 			else
-				for (const auto& gameObject : _gameObjects)
-					//if (Intersect::frustumAndAABB(frustum, gameObject->boundingBox())) <-- too slow
-						if (!gameObject->isStatic())
-							gameObjects.push_back(gameObject);
-		}
+				AabbBlock::intersect(frustum, _gameObjects, gameObjects);
+			break;
+		default:
+			break;
+	}
+}
+
+void GameEngine::OctreeNode::collectProtected(QList<GameObject*>& gameObjects) const
+{
+	// Whole subtree is inside the frustum, nothing below needs testing
+	if (!isLeaf())
+		for (auto i = 0; i < _children.count(); i++)
+			_children[i]->collectProtected(gameObjects);
+	else
+		for (const auto& gameObject : _gameObjects)
+			if (!gameObject->isStatic())
+				gameObjects.push_back(gameObject);
+}
+
+void GameEngine::OctreeNode::intersectProtected(const FrustumSet& frustums, quint32 views, QList<FrustumSet::Visibility>& gameObjects) const
+{
+	views = frustums.intersects(_bbox, views);
+	if (views)
+	{
+		if (!isLeaf())
+			for (auto i = 0; i < _children.count(); i++)
+				_children[i]->intersectProtected(frustums, views, gameObjects);
+		else
+			frustums.intersect(_gameObjects, views, gameObjects);
+	}
 }
 
 int GameEngine::OctreeNode::level() const
@@ -46,7 +82,7 @@ int GameEngine::OctreeNode::level() const
 
 bool GameEngine::OctreeNode::isLeaf() const
 {
-	return _level == MAX_DEPTH - 1;
+	return _children.isEmpty();
 }
 
 GameEngine::OctreeNode* GameEngine::OctreeNode::parent() const
@@ -64,15 +100,22 @@ const QSet<GameEngine::GameObject*>& GameEngine::OctreeNode::gameObjects() const
 	return _gameObjects;
 }
 
-void GameEngine::OctreeNode::getIntersectingLeafNodes(const Ray3D& ray, QMap<float, const OctreeNode*>& nodes) const
+void GameEngine::OctreeNode::raycastProtected(const Ray3D& ray, float maxDistance, QVarLengthArray<QPair<float, GameObject*>, 64>& candidates) const
 {
 	float t;
-	if (Intersect::rayAndAABB(ray, boundingBox(), &t))
-		if (isLeaf())
-			nodes.insert(t, this);
-		else
-			for (auto i = 0; i < _children.count(); i++)
-				_children[i]->getIntersectingLeafNodes(ray, nodes);
+	if (!Intersect::rayAndAABB(ray, boundingBox(), &t) || t >= maxDistance)
+		return;
+
+	if (isLeaf())
+	{
+		for (auto gameObject : _gameObjects)
+			if (auto meshRenderer = gameObject->getComponent<MeshRenderer>())
+				if (Intersect::rayAndAABB(ray, meshRenderer->boundingBox(), &t) && t < maxDistance)
+					candidates.push_back(qMakePair(t, gameObject));
+	}
+	else
+		for (auto i = 0; i < _children.count(); i++)
+			_children[i]->raycastProtected(ray, maxDistance, candidates);
 }
 
 void GameEngine::OctreeNode::addProtected(GameObject* gameObject, QVector<OctreeNode*>& nodes)
@@ -116,13 +159,14 @@ void GameEngine::OctreeNode::addProtected(GameObject* gameObject, QVector<Octree
 		}
 }
 
-void GameEngine::OctreeNode::removeProtected(GameObject* gameObject)
+void GameEngine::OctreeNode::findLeafNodes(const BoundingBox& box, QVector<OctreeNode*>& nodes)
 {
-	if (isLeaf())
-		_gameObjects.remove(gameObject);
-	else
-		for (auto i = 0; i < _children.count(); i++)
-			_children[i]->removeProtected(gameObject);
+	if (Intersect::aabbAndAABB(_bbox, box))
+		if (!isLeaf())
+			for (auto i = 0; i < _children.count(); i++)
+				_children[i]->findLeafNodes(box, nodes);
+		else
+			nodes.push_back(this);
 }
 
 void GameEngine::OctreeNode::init(const QVector3D& center, float size)
@@ -132,23 +176,28 @@ void GameEngine::OctreeNode::init(const QVector3D& center, float size)
 	auto min = QVector3D(center.x() - halfSize, center.y() - halfSize, center.z() - halfSize);
 	auto max = QVector3D(center.x() + halfSize, center.y() + halfSize, center.z() + halfSize);
 	_bbox = BoundingBox(min, max);
+}
 
+void GameEngine::OctreeNode::subdivide()
+{
 	if (!isLeaf())
-	{
-		auto d = halfSize * 0.5;
-		_children =
-			{
-				new OctreeNode(this, QVector3D(center.x() - d, center.y() - d, center.z() - d), halfSize),
-				new OctreeNode(this, QVector3D(center.x() + d, center.y() - d, center.z() - d), halfSize),
-				new OctreeNode(this, QVector3D(center.x() - d, center.y() + d, center.z() - d), halfSize),
-				new OctreeNode(this, QVector3D(center.x() + d, center.y() + d, center.z() - d), halfSize),
-
-				new OctreeNode(this, QVector3D(center.x() - d, center.y() - d, center.z() + d), halfSize),
-				new OctreeNode(this, QVector3D(center.x() + d, center.y() - d, center.z() + d), halfSize),
-				new OctreeNode(this, QVector3D(center.x() - d, center.y() + d, center.z() + d), halfSize),
-				new OctreeNode(this, QVector3D(center.x() + d, center.y() + d, center.z() + d), halfSize)
-			};
-	}
+		return;
+
+	auto center = _bbox.midPoint();
+	auto halfSize = _bbox.extent().x() * 0.5f;
+	auto d = halfSize * 0.5;
+	_children =
+		{
+			new OctreeNode(this, QVector3D(center.x() - d, center.y() - d, center.z() - d), halfSize),
+			new OctreeNode(this, QVector3D(center.x() + d, center.y() - d, center.z() - d), halfSize),
+			new OctreeNode(this, QVector3D(center.x() - d, center.y() + d, center.z() - d), halfSize),
+			new OctreeNode(this, QVector3D(center.x() + d, center.y() + d, center.z() - d), halfSize),
+
+			new OctreeNode(this, QVector3D(center.x() - d, center.y() - d, center.z() + d), halfSize),
+			new OctreeNode(this, QVector3D(center.x() + d, center.y() - d, center.z() + d), halfSize),
+			new OctreeNode(this, QVector3D(center.x() - d, center.y() + d, center.z() + d), halfSize),
+			new OctreeNode(this, QVector3D(center.x() + d, center.y() + d, center.z() + d), halfSize)
+		};
 }
 
 void GameEngine::OctreeNode::clear()
@@ -1,17 +1,21 @@
 #pragma once
+#include <QPair>
 #include <QSet>
+#include <QVarLengthArray>
 #include <QVector>
 #include <QVector3D>
 #include "Includes.h"
 #include "BoundingBox.h"
+#include "FrustumSet.h"
 
 namespace GameEngine {
 	class GameObject;
 	class Ray3D;
-	class CameraFrustum;
+	class CullingFrustum;
 	class OctreeNode
 	{
 		NOCOPY(OctreeNode)
+		friend class Octree;
 
 	public:
 		const BoundingBox& boundingBox() const;
@@ -24,11 +28,18 @@ namespace GameEngine {
 		bool isLeaf() const;
 		OctreeNode* parent() const;
 		const QVector<OctreeNode*>& children() const;
-		void getIntersectingLeafNodes(const Ray3D& ray, QMap<float, const OctreeNode*>& nodes) const;
-		void intersectProtected(const CameraFrustum& frustum, QList<GameObject*>& gameObjects) const;
+		/*
+		Gathers objects of leaves hit by the ray closer than maxDistance.
+		*/
+		void raycastProtected(const Ray3D& ray, float maxDistance, QVarLengthArray<QPair<float, GameObject*>, 64>& candidates) const;
+		int countNodes() const;
+		void intersectProtected(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const;
+		void collectProtected(QList<GameObject*>& gameObjects) const;
+		void intersectProtected(const FrustumSet& frustums, quint32 views, QList<FrustumSet::Visibility>& gameObjects) const;
 		void addProtected(GameObject* gameObject, QVector<OctreeNode*>& nodes);
-		void removeProtected(GameObject* gameObject);
+		void findLeafNodes(const BoundingBox& box, QVector<OctreeNode*>& nodes);
 		void init(const QVector3D& center, float size);
+		void subdivide();
 		void clear();
 
 	private:
@@ -37,5 +48,6 @@ namespace GameEngine {
 		QVector<OctreeNode*> _children;
 		QSet<GameObject*> _gameObjects;
 		BoundingBox _bbox;
+		mutable int _lastPlane; // Frustum plane which rejected the node last time
 	};
 }
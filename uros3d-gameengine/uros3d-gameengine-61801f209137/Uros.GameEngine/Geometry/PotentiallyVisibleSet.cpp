@@ -0,0 +1,268 @@
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include "PotentiallyVisibleSet.h"
+#include "CullingFrustum.h"
+#include "OcclusionBuffer.h"
+#include "GameObject.h"
+#include "TaskPool.h"
+#include "Rendering/MeshRenderer.h"
+
+#define MAX_CELLS_PER_AXIS 64
+#define SAMPLES_PER_AXIS 3
+#define FACE_RESOLUTION 64
+#define NEAR_PLANE 0.1f
+#define MAX_OCCLUDER_TRIANGLES 4096
+#define FILE_MAGIC 0x31535650 // "PVS1"
+#define FILE_VERSION 1
+
+GameEngine::PotentiallyVisibleSet::PotentiallyVisibleSet()
+	: _cellsX(0),
+	  _cellsY(0),
+	  _cellsZ(0),
+	  _words(0) {}
+
+QByteArray GameEngine::PotentiallyVisibleSet::computeKey(const QVector<GameObject*>& gameObjects, float cellSize)
+{
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream << quint32(FILE_VERSION) << cellSize << gameObjects.count();
+	for (const auto& gameObject : gameObjects)
+	{
+		const auto& bbox = gameObject->boundingBox();
+		const auto& meshRenderer = gameObject->getComponent<MeshRenderer>();
+		auto triangles = meshRenderer && meshRenderer->getMesh() ? meshRenderer->getMesh()->triangleCount() : 0;
+		stream << gameObject->getName() << bbox.minPoint() << bbox.maxPoint() << triangles;
+	}
+	return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+const QByteArray& GameEngine::PotentiallyVisibleSet::key() const
+{
+	return _key;
+}
+
+bool GameEngine::PotentiallyVisibleSet::isEmpty() const
+{
+	return _bits.isEmpty();
+}
+
+const GameEngine::BoundingBox& GameEngine::PotentiallyVisibleSet::boundingBox() const
+{
+	return _bbox;
+}
+
+int GameEngine::PotentiallyVisibleSet::cellCount() const
+{
+	return _cellsX * _cellsY * _cellsZ;
+}
+
+int GameEngine::PotentiallyVisibleSet::gameObjectCount() const
+{
+	return _gameObjects.count();
+}
+
+void GameEngine::PotentiallyVisibleSet::build(const QVector<GameObject*>& gameObjects, float cellSize, TaskPool* pool)
+{
+	if (cellSize <= 0)
+		throw std::logic_error("PotentiallyVisibleSet::build: Cell size must be positive.");
+
+	clear();
+	_key = computeKey(gameObjects, cellSize);
+	if (gameObjects.isEmpty())
+		return;
+	_gameObjects = gameObjects;
+
+	// Boxes and matrices are gathered up front, cells are built in parallel and must only read them
+	QVector<BoundingBox> boxes;
+	QVector<Occluder> occluders;
+	boxes.reserve(gameObjects.count());
+	for (const auto& gameObject : gameObjects)
+	{
+		boxes.push_back(gameObject->boundingBox());
+		const auto& meshRenderer = gameObject->getComponent<MeshRenderer>();
+		if (!meshRenderer || !meshRenderer->isEnabled() || !meshRenderer->getMesh() || meshRenderer->getConstMaterial().getShaderType() >= 100)
+			continue;
+		if (meshRenderer->getMesh()->triangleCount() <= MAX_OCCLUDER_TRIANGLES)
+			occluders.push_back({ meshRenderer->getMesh(), gameObject->transform()->getMatrix(), boxes.last() });
+	}
+
+	// Cells are stretched on scenes too big for the grid
+	auto bbox = boxes.first();
+	for (const auto& box : boxes)
+		bbox = BoundingBox::combine(bbox, box);
+	const auto& extent = bbox.extent();
+	auto cells = [&](float size)
+	{
+		return qBound(1, static_cast<int>(ceil(size / cellSize)), MAX_CELLS_PER_AXIS);
+	};
+	_cellsX = cells(extent.x());
+	_cellsY = cells(extent.y());
+	_cellsZ = cells(extent.z());
+	_cellSize = QVector3D(qMax(cellSize, extent.x() / _cellsX), qMax(cellSize, extent.y() / _cellsY), qMax(cellSize, extent.z() / _cellsZ));
+	_bbox = BoundingBox(bbox.minPoint(), bbox.minPoint() + _cellSize * QVector3D(_cellsX, _cellsY, _cellsZ));
+	_words = (gameObjects.count() + 31) / 32;
+	_bits.fill(0, cellCount() * _words);
+
+	// Every cell writes only its own words
+	auto bits = _bits.data();
+	QVector<TaskPool::Task> tasks;
+	tasks.reserve(cellCount());
+	for (auto cell = 0; cell < cellCount(); cell++)
+		tasks.push_back([&, bits, cell]()
+		{
+			buildCell(cell, bits + cell * _words, boxes, occluders);
+		});
+	if (pool)
+		pool->run(tasks);
+	else
+		for (const auto& task : tasks)
+			task();
+}
+
+bool GameEngine::PotentiallyVisibleSet::load(const QString& path, const QVector<GameObject*>& gameObjects, float cellSize)
+{
+	clear();
+	QFile file(path);
+	if (!file.open(QFile::ReadOnly))
+		return false;
+
+	QDataStream stream(&file);
+	quint32 magic, version;
+	QByteArray key;
+	stream >> magic >> version >> key;
+	if (magic != FILE_MAGIC || version != FILE_VERSION || key != computeKey(gameObjects, cellSize))
+		return false;
+
+	QVector3D min, max;
+	stream >> min >> max >> _cellSize >> _cellsX >> _cellsY >> _cellsZ >> _words >> _bits;
+	if (stream.status() != QDataStream::Ok || _words != (gameObjects.count() + 31) / 32 || _bits.count() != cellCount() * _words)
+	{
+		ERROR_LOG("> PotentiallyVisibleSet::load: File '" << path.toStdString() << "' is corrupted.");
+		clear();
+		return false;
+	}
+	_bbox = BoundingBox(min, max);
+	_key = key;
+	_gameObjects = gameObjects;
+	return true;
+}
+
+bool GameEngine::PotentiallyVisibleSet::save(const QString& path) const
+{
+	QFile file(path);
+	if (!file.open(QFile::WriteOnly | QFile::Truncate))
+	{
+		ERROR_LOG("> PotentiallyVisibleSet::save: Cannot write to '" << path.toStdString() << "'.");
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream << quint32(FILE_MAGIC) << quint32(FILE_VERSION) << _key;
+	stream << _bbox.minPoint() << _bbox.maxPoint() << _cellSize << _cellsX << _cellsY << _cellsZ << _words << _bits;
+	return stream.status() == QDataStream::Ok;
+}
+
+void GameEngine::PotentiallyVisibleSet::remove(GameObject* gameObject)
+{
+	auto index = _gameObjects.indexOf(gameObject);
+	if (index >= 0)
+		_gameObjects[index] = nullptr;
+}
+
+int GameEngine::PotentiallyVisibleSet::findCell(const QVector3D& point) const
+{
+	if (isEmpty() || !BoundingBox::isPointInside(_bbox, point))
+		return -1;
+	auto offset = (point - _bbox.minPoint()) / _cellSize;
+	auto x = qMin(static_cast<int>(offset.x()), _cellsX - 1);
+	auto y = qMin(static_cast<int>(offset.y()), _cellsY - 1);
+	auto z = qMin(static_cast<int>(offset.z()), _cellsZ - 1);
+	return (z * _cellsY + y) * _cellsX + x;
+}
+
+bool GameEngine::PotentiallyVisibleSet::isVisible(int cell, int index) const
+{
+	return (_bits[cell * _words + index / 32] & (1u << (index % 32))) != 0;
+}
+
+int GameEngine::PotentiallyVisibleSet::visibleCount(int cell) const
+{
+	auto count = 0;
+	for (auto i = 0; i < _gameObjects.count(); i++)
+		if (_gameObjects[i] && isVisible(cell, i))
+			count++;
+	return count;
+}
+
+void GameEngine::PotentiallyVisibleSet::visibleObjects(int cell, QList<GameObject*>& gameObjects) const
+{
+	for (auto i = 0; i < _gameObjects.count(); i++)
+		if (_gameObjects[i] && isVisible(cell, i))
+			gameObjects.push_back(_gameObjects[i]);
+}
+
+void GameEngine::PotentiallyVisibleSet::clear()
+{
+	_gameObjects.clear();
+	_bits.clear();
+	_key.clear();
+	_bbox = BoundingBox();
+	_cellSize = QVector3D();
+	_cellsX = _cellsY = _cellsZ = 0;
+	_words = 0;
+}
+
+void GameEngine::PotentiallyVisibleSet::buildCell(int cell, quint32* bits, const QVector<BoundingBox>& boxes, const QVector<Occluder>& occluders) const
+{
+	auto x = cell % _cellsX;
+	auto y = cell / _cellsX % _cellsY;
+	auto z = cell / (_cellsX * _cellsY);
+	auto cellMin = _bbox.minPoint() + _cellSize * QVector3D(x, y, z);
+	BoundingBox cellBox(cellMin, cellMin + _cellSize);
+	auto isVisible = [&](int i)
+	{
+		return (bits[i / 32] & (1u << (i % 32))) != 0;
+	};
+
+	// Objects reaching into the cell are seen from it no matter what
+	for (auto i = 0; i < boxes.count(); i++)
+		if (BoundingBox::intersect(cellBox, boxes[i]))
+			bits[i / 32] |= 1u << (i % 32);
+
+	// Six 90 degree views cover everything around a sample point
+	static const QVector3D directions[6][2] =
+	{
+		{ QVector3D(1, 0, 0), QVector3D(0, 1, 0) }, { QVector3D(-1, 0, 0), QVector3D(0, 1, 0) },
+		{ QVector3D(0, 1, 0), QVector3D(0, 0, 1) }, { QVector3D(0, -1, 0), QVector3D(0, 0, 1) },
+		{ QVector3D(0, 0, 1), QVector3D(0, 1, 0) }, { QVector3D(0, 0, -1), QVector3D(0, 1, 0) }
+	};
+	auto farPlane = _bbox.extent().length() * 2;
+	OcclusionBuffer buffer(FACE_RESOLUTION, FACE_RESOLUTION);
+	for (auto i = 0; i < SAMPLES_PER_AXIS * SAMPLES_PER_AXIS * SAMPLES_PER_AXIS; i++)
+	{
+		auto step = QVector3D(i % SAMPLES_PER_AXIS, i / SAMPLES_PER_AXIS % SAMPLES_PER_AXIS, i / (SAMPLES_PER_AXIS * SAMPLES_PER_AXIS)) / (SAMPLES_PER_AXIS - 1);
+		auto eye = cellMin + _cellSize * step;
+		for (auto face = 0; face < 6; face++)
+		{
+			QMatrix4x4 viewProjection;
+			viewProjection.perspective(90, 1, NEAR_PLANE, farPlane);
+			viewProjection.lookAt(eye, eye + directions[face][0], directions[face][1]);
+			CullingFrustum frustum(viewProjection);
+			buffer.clear(viewProjection);
+			for (const auto& occluder : occluders)
+				if (frustum.intersects(occluder.bbox))
+					buffer.rasterize(*occluder.mesh, occluder.matrix);
+
+			for (auto j = 0; j < boxes.count(); j++)
+			{
+				if (isVisible(j) || !frustum.intersects(boxes[j]))
+					continue;
+				// Slightly bigger box keeps occluders from hiding themselves
+				auto margin = boxes[j].extent() * 0.01f + QVector3D(1e-3f, 1e-3f, 1e-3f);
+				if (!buffer.isOccluded(BoundingBox(boxes[j].minPoint() - margin, boxes[j].maxPoint() + margin)))
+					bits[j / 32] |= 1u << (j % 32);
+			}
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QMatrix4x4>
+#include <QString>
+#include <QVector>
+#include <QVector3D>
+#include "Includes.h"
+#include "BoundingBox.h"
+
+namespace GameEngine {
+	class GameObject;
+	class GeometryBase;
+	class TaskPool;
+
+	/*
+	Static objects visible from each cell of a uniform grid laid over the static part of the scene. Visibility is
+	found by rendering meshes of static objects into small depth buffers from sample points spread over each cell
+	and looking in all six directions, an object counts as visible from the cell if any sample sees it. Every cell
+	keeps one bit per object. A set is tied to its objects by a key, so a cached set of a changed scene is rejected.
+	*/
+	class PotentiallyVisibleSet final
+	{
+		NOCOPY(PotentiallyVisibleSet)
+
+	public:
+		EXPORT PotentiallyVisibleSet();
+		/*
+		Key of specified objects and cell size. Any change in their order, names, bounds or meshes changes the key.
+		*/
+		EXPORT static QByteArray computeKey(const QVector<GameObject*>& gameObjects, float cellSize);
+		EXPORT const QByteArray& key() const;
+		EXPORT bool isEmpty() const;
+		EXPORT const BoundingBox& boundingBox() const;
+		EXPORT int cellCount() const;
+		EXPORT int gameObjectCount() const;
+		/*
+		Builds the set from scratch, cells are processed in parallel if a pool is given.
+		*/
+		EXPORT void build(const QVector<GameObject*>& gameObjects, float cellSize, TaskPool* pool = nullptr);
+		/*
+		Loads a set saved for the same objects and cell size. Returns false if the file is missing, broken
+		or was built for a different scene, the set is left empty then.
+		*/
+		EXPORT bool load(const QString& path, const QVector<GameObject*>& gameObjects, float cellSize);
+		EXPORT bool save(const QString& path) const;
+		/*
+		Drops the object from all cells, it's never reported as visible again.
+		*/
+		EXPORT void remove(GameObject* gameObject);
+		/*
+		Returns the cell containing the point or -1 if the point is outside of the grid.
+		*/
+		EXPORT int findCell(const QVector3D& point) const;
+		EXPORT bool isVisible(int cell, int index) const;
+		EXPORT int visibleCount(int cell) const;
+		/*
+		Adds objects visible from the cell.
+		*/
+		EXPORT void visibleObjects(int cell, QList<GameObject*>& gameObjects) const;
+
+	private:
+		struct Occluder
+		{
+			const GeometryBase* mesh;
+			QMatrix4x4 matrix;
+			BoundingBox bbox;
+		};
+
+		void clear();
+		void buildCell(int cell, quint32* bits, const QVector<BoundingBox>& boxes, const QVector<Occluder>& occluders) const;
+
+		QVector<GameObject*> _gameObjects;
+		QVector<quint32> _bits; // Cell after cell, one bit per object
+		QByteArray _key;
+		BoundingBox _bbox;
+		QVector3D _cellSize;
+		int _cellsX;
+		int _cellsY;
+		int _cellsZ;
+		int _words; // Words per cell
+	};
+}
@@ -0,0 +1,253 @@
+#include "SpatialIndex.h"
+#include "TriangleBvh.h"
+#include "Ray3D.h"
+#include "Intersect.h"
+#include "GameObject.h"
+#include "TaskPool.h"
+#include "Morton.h"
+#include "Rendering/MeshRenderer.h"
+
+#define MAX_OUTLIERS 32
+#define MAX_OUTLIER_RATIO 0.1f
+#define RAY_CHUNK_SIZE 64
+
+void GameEngine::SpatialIndex::bounds(const QVector<GameObject*>& gameObjects, QVector3D& min, QVector3D& max)
+{
+	if (gameObjects.isEmpty())
+	{
+		min = max = QVector3D();
+		return;
+	}
+
+	float xMin, yMin, zMin;
+	float xMax, yMax, zMax;
+	xMin = yMin = zMin = std::numeric_limits<float>::max();
+	xMax = yMax = zMax = std::numeric_limits<float>::lowest();
+	for (auto gameObject : gameObjects)
+	{
+		const auto& box = gameObject->boundingBox();
+		xMin = fmin(xMin, box.minPoint().x());
+		yMin = fmin(yMin, box.minPoint().y());
+		zMin = fmin(zMin, box.minPoint().z());
+		xMax = fmax(xMax, box.maxPoint().x());
+		yMax = fmax(yMax, box.maxPoint().y());
+		zMax = fmax(zMax, box.maxPoint().z());
+	}
+	min = QVector3D(xMin, yMin, zMin);
+	max = QVector3D(xMax, yMax, zMax);
+}
+
+void GameEngine::SpatialIndex::grow(const QVector<GameObject*>& gameObjects, const BoundingBox& current, QVector3D& min, QVector3D& max)
+{
+	bounds(gameObjects, min, max);
+	min = QVector3D(fmin(min.x(), current.minPoint().x()), fmin(min.y(), current.minPoint().y()), fmin(min.z(), current.minPoint().z()));
+	max = QVector3D(fmax(max.x(), current.maxPoint().x()), fmax(max.y(), current.maxPoint().y()), fmax(max.z(), current.maxPoint().z()));
+
+	// At least double the size, so growing stays rare when objects keep drifting away
+	auto extent = max - min;
+	auto size = fmax(fmax(extent.x(), extent.y()), fmax(extent.z(), 2 * current.extent().x()));
+	auto center = (min + max) / 2;
+	min = center - QVector3D(size, size, size) / 2;
+	max = center + QVector3D(size, size, size) / 2;
+}
+
+bool GameEngine::SpatialIndex::needsReroot(int outliers, int gameObjects)
+{
+	return outliers > MAX_OUTLIERS || outliers > gameObjects * MAX_OUTLIER_RATIO;
+}
+
+void GameEngine::SpatialIndex::setHierarchical(bool hierarchical)
+{
+	_hierarchical = hierarchical;
+}
+
+GameEngine::GameObject* GameEngine::SpatialIndex::raycastGameObject(const Ray3D& ray, GameObject* gameObject, RaycastMode mode, float maxDistance, float* t) const
+{
+	GameObject* hit = raycastMesh(ray, gameObject, mode, maxDistance, t) ? gameObject : nullptr;
+	if (!_hierarchical || (hit && mode == AnyHit))
+		return hit;
+
+	// Children aren't indexed on their own, those in the other index are reached through it
+	auto tHit = hit ? *t : maxDistance;
+	QVarLengthArray<GameObject*, 32> stack;
+	auto pushChildren = [&stack](const GameObject* parent)
+	{
+		for (const auto& child : parent->transform()->children())
+			if (child->gameObject()->isStatic() == parent->isStatic())
+				stack.push_back(child->gameObject());
+	};
+	pushChildren(gameObject);
+	while (!stack.isEmpty())
+	{
+		auto child = stack.last();
+		stack.pop_back();
+		float tChild;
+		if (!Intersect::rayAndAABB(ray, child->boundingBox(), &tChild) || tChild >= tHit)
+			continue;
+		if (raycastMesh(ray, child, mode, tHit, &tChild))
+		{
+			tHit = tChild;
+			hit = child;
+			if (mode == AnyHit)
+				break;
+		}
+		pushChildren(child);
+	}
+	if (hit)
+		*t = tHit;
+	return hit;
+}
+
+bool GameEngine::SpatialIndex::raycastMesh(const Ray3D& ray, GameObject* gameObject, RaycastMode mode, float maxDistance, float* t)
+{
+	//TODO: Use colliders here when implemented
+	auto meshRenderer = gameObject->getComponent<MeshRenderer>();
+	if (!meshRenderer || !meshRenderer->getMesh())
+		return false;
+
+	// Ray goes into mesh's space instead of every triangle coming out, distances along it stay the same
+	const auto& inverse = gameObject->transform()->getInverseMatrix();
+	Ray3D localRay(inverse * ray.origin(), inverse.mapVector(ray.direction()));
+	const auto& bvh = meshRenderer->getMesh()->triangleBvh();
+	if (mode == AnyHit)
+		return bvh.intersects(localRay, maxDistance, t);
+	return bvh.raycast(localRay, t, nullptr, nullptr, maxDistance);
+}
+
+GameEngine::GameObject* GameEngine::SpatialIndex::raycastCandidates(const Ray3D& ray, RaycastCandidates& candidates, RaycastMode mode, float maxDistance, QVector3D* hitPoint) const
+{
+	if (mode == ClosestHit)
+		std::sort(candidates.begin(), candidates.end(),
+		          [](const QPair<float, GameObject*>& a, const QPair<float, GameObject*>& b)
+		          {
+			          return a.first < b.first;
+		          });
+
+	GameObject* gameObject = nullptr;
+	GameObject* previous = nullptr;
+	auto tHit = maxDistance;
+	for (const auto& candidate : candidates)
+	{
+		if (candidate.first >= tHit)
+		{
+			// Sorted candidates can't get any closer after this one
+			if (mode == ClosestHit)
+				break;
+			continue;
+		}
+		// Objects stored in several nodes come one after another with the same distance
+		if (candidate.second == previous)
+			continue;
+		previous = candidate.second;
+
+		float t;
+		if (auto hit = raycastGameObject(ray, candidate.second, mode, tHit, &t))
+		{
+			tHit = t;
+			gameObject = hit;
+			if (mode == AnyHit)
+				break;
+		}
+	}
+	if (gameObject && hitPoint)
+		*hitPoint = ray.origin() + ray.direction() * tHit;
+	return gameObject;
+}
+
+void GameEngine::SpatialIndex::raycastBatch(const QVector<Ray3D>& rays, QVector<RaycastHit>& hits, RaycastMode mode, float maxDistance, TaskPool* pool, bool keepHits) const
+{
+	if (!keepHits || hits.count() != rays.count())
+	{
+		if (keepHits)
+			ERROR_LOG("> SpatialIndex::raycastBatch: Hits to keep don't match the rays, starting over.");
+		hits.fill({ nullptr, QVector3D(), maxDistance }, rays.count());
+	}
+	if (rays.isEmpty())
+		return;
+
+	// Rays pointing into the same octant and starting close to each other walk the same nodes and
+	// triangles, so they're sorted by octant first and Morton code of their origin second. Nothing is
+	// traversed per group of rays, the order only keeps consecutive single ray queries cache friendly.
+	auto min = rays.first().origin();
+	auto max = min;
+	for (const auto& ray : rays)
+	{
+		const auto& origin = ray.origin();
+		min = QVector3D(fmin(min.x(), origin.x()), fmin(min.y(), origin.y()), fmin(min.z(), origin.z()));
+		max = QVector3D(fmax(max.x(), origin.x()), fmax(max.y(), origin.y()), fmax(max.z(), origin.z()));
+	}
+	auto extent = max - min;
+	auto scale = 1023 / fmax(fmax(extent.x(), extent.y()), fmax(extent.z(), 1e-6f));
+	QVector<QPair<quint64, int>> order(rays.count());
+	for (auto i = 0; i < rays.count(); i++)
+	{
+		const auto& direction = rays[i].direction();
+		auto octant = (direction.x() < 0 ? 1u : 0u) | (direction.y() < 0 ? 2u : 0u) | (direction.z() < 0 ? 4u : 0u);
+		auto cell = (rays[i].origin() - min) * scale;
+		auto code = Morton::encode(static_cast<quint32>(cell.x()), static_cast<quint32>(cell.y()), static_cast<quint32>(cell.z()));
+		order[i] = qMakePair(static_cast<quint64>(octant) << 30 | code, i);
+	}
+	std::sort(order.begin(), order.end());
+
+	// Every chunk writes only hits of its own rays
+	auto output = hits.data();
+	auto sorted = order.constData();
+	auto castChunk = [this, &rays, mode, maxDistance, output, sorted](int first, int last)
+	{
+		for (auto i = first; i < last; i++)
+		{
+			const auto& ray = rays[sorted[i].second];
+			auto& hit = output[sorted[i].second];
+			if (hit.gameObject && mode == AnyHit)
+				continue;
+			GameObject* gameObject;
+			QVector3D hitPoint;
+			auto limit = hit.gameObject ? qMin(hit.distance, maxDistance) : maxDistance;
+			if (raycast(ray, gameObject, &hitPoint, mode, limit))
+				hit = { gameObject, hitPoint, QVector3D::dotProduct(hitPoint - ray.origin(), ray.direction()) / ray.direction().lengthSquared() };
+		}
+	};
+	if (!pool || rays.count() <= RAY_CHUNK_SIZE)
+	{
+		castChunk(0, rays.count());
+		return;
+	}
+	QVector<TaskPool::Task> tasks;
+	tasks.reserve((rays.count() + RAY_CHUNK_SIZE - 1) / RAY_CHUNK_SIZE);
+	for (auto first = 0; first < rays.count(); first += RAY_CHUNK_SIZE)
+	{
+		auto last = qMin(first + RAY_CHUNK_SIZE, rays.count());
+		tasks.push_back([castChunk, first, last]()
+		{
+			castChunk(first, last);
+		});
+	}
+	pool->run(tasks);
+}
+
+void GameEngine::SpatialIndex::intersectParallel(const CullingFrustum& frustum, QList<GameObject*>& gameObjects, TaskPool& pool) const
+{
+	intersect(frustum, gameObjects);
+}
+
+void GameEngine::SpatialIndex::runCullingTasks(const QVector<CullingTask>& tasks, QList<GameObject*>& gameObjects, TaskPool& pool)
+{
+	// Every task writes only into its own list, merging in task order keeps the result deterministic
+	QVector<QList<GameObject*>> results(tasks.count());
+	auto outputs = results.data();
+	QVector<TaskPool::Task> poolTasks;
+	poolTasks.reserve(tasks.count());
+	for (auto i = 0; i < tasks.count(); i++)
+		poolTasks.push_back([&tasks, outputs, i]()
+		{
+			tasks[i](outputs[i]);
+		});
+	pool.run(poolTasks);
+
+	auto count = gameObjects.count();
+	for (const auto& result : results)
+		count += result.count();
+	gameObjects.reserve(count);
+	for (const auto& result : results)
+		gameObjects.append(result);
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <functional>
+#include <limits>
+#include <QList>
+#include <QPair>
+#include <QVarLengthArray>
+#include <QVector>
+#include <QVector3D>
+#include "Includes.h"
+#include "BoundingBox.h"
+#include "FrustumSet.h"
+
+namespace GameEngine {
+	class GameObject;
+	class Ray3D;
+	class CullingFrustum;
+	class TaskPool;
+
+	/*
+	Common interface of spatial structures that the scene uses for frustum culling and raycasting.
+	*/
+	class SpatialIndex
+	{
+	public:
+		enum RaycastMode
+		{
+			ClosestHit,
+			AnyHit
+		};
+		struct RaycastHit
+		{
+			GameObject* gameObject; // Null if nothing was hit
+			QVector3D hitPoint;
+			float distance; // Along the ray, in lengths of its direction
+		};
+		struct OutlierStats
+		{
+			int outliers; // Objects outside of the index bounds, these are tested one by one
+			int gameObjects;
+			int reroots; // How many times the bounds had to grow
+		};
+
+		SpatialIndex() : _hierarchical(false) {}
+		virtual ~SpatialIndex() {}
+
+		/*
+		Tells the index it holds only roots of hierarchies. Raycasts then go on into children whose aggregate
+		bounds the ray hits, as long as they are in the same index, static or dynamic, as their parent.
+		*/
+		void setHierarchical(bool hierarchical);
+
+		/*
+		Returns bounds of all nodes containing specified game object. Returns false if the object is not stored in any node.
+		*/
+		virtual bool findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const = 0;
+		/*
+		Finds an object hit by the ray closer than maxDistance, measured in lengths of the ray's direction. Closest hit
+		skips everything behind the best hit so far, any hit stops at the first one found and suits line of sight checks.
+		*/
+		virtual bool raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode = ClosestHit,
+		                     float maxDistance = std::numeric_limits<float>::max()) const = 0;
+		/*
+		Casts a whole batch of rays, hits[i] belongs to rays[i]. The array is cleared first unless keepHits is set,
+		then hits already in it limit the search, so another index can be queried with the same array and only
+		closer objects replace them. Every ray is still traced on its own, but rays are sorted into a coherent
+		stream first, so neighbours in the stream touch the same nodes and triangles while they're in cache. The
+		stream is cut into chunks, which run on the pool if there is one.
+		*/
+		void raycastBatch(const QVector<Ray3D>& rays, QVector<RaycastHit>& hits, RaycastMode mode = ClosestHit,
+		                  float maxDistance = std::numeric_limits<float>::max(), TaskPool* pool = nullptr, bool keepHits = false) const;
+		virtual void intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const = 0;
+		/*
+		Culls all views of the set in one traversal, every visible object comes with the mask of views it's visible in.
+		*/
+		virtual void intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const = 0;
+		/*
+		Same as intersect, but splits the work between threads of the pool. Returns exactly the same list
+		in the same order. Indices which can't be split run serially on the calling thread.
+		*/
+		virtual void intersectParallel(const CullingFrustum& frustum, QList<GameObject*>& gameObjects, TaskPool& pool) const;
+		virtual void add(GameObject* gameObject) = 0;
+		virtual void remove(GameObject* gameObject) = 0;
+		/*
+		Updates position of specified game object. Returns true if the object had to move to a different node.
+		*/
+		virtual bool update(GameObject* gameObject) = 0;
+		virtual void initialize(const QVector<GameObject*>& gameObjects) = 0;
+		virtual OutlierStats outlierStats() const = 0;
+
+	protected:
+		typedef std::function<void(QList<GameObject*>&)> CullingTask;
+		typedef QVarLengthArray<QPair<float, GameObject*>, 64> RaycastCandidates; // Distance to the box and the object
+
+		static void bounds(const QVector<GameObject*>& gameObjects, QVector3D& min, QVector3D& max);
+		static void grow(const QVector<GameObject*>& gameObjects, const BoundingBox& current, QVector3D& min, QVector3D& max);
+		static bool needsReroot(int outliers, int gameObjects);
+		/*
+		Tests triangles of the object, and of its children when the index is hierarchical. Returns the object that
+		was hit, only hits closer than maxDistance count.
+		*/
+		GameObject* raycastGameObject(const Ray3D& ray, GameObject* gameObject, RaycastMode mode, float maxDistance, float* t) const;
+		/*
+		Tests candidates gathered by an index. Closest hit goes through them sorted by distance to their boxes.
+		*/
+		GameObject* raycastCandidates(const Ray3D& ray, RaycastCandidates& candidates, RaycastMode mode, float maxDistance, QVector3D* hitPoint) const;
+		/*
+		Runs every task on the pool with its own output list, then appends the lists in task order.
+		*/
+		static void runCullingTasks(const QVector<CullingTask>& tasks, QList<GameObject*>& gameObjects, TaskPool& pool);
+
+		bool _hierarchical;
+
+	private:
+		static bool raycastMesh(const Ray3D& ray, GameObject* gameObject, RaycastMode mode, float maxDistance, float* t);
+	};
+}
@@ -0,0 +1,357 @@
+#include <QTime>
+#include <QVarLengthArray>
+#include "StaticBvh.h"
+#include "Ray3D.h"
+#include "CullingFrustum.h"
+#include "Intersect.h"
+#include "GameObject.h"
+#include "AabbBlock.h"
+
+#define BIN_COUNT 12
+#define MAX_LEAF_SIZE 4
+#define MAX_SAH_LEAF_SIZE 16
+#define TRAVERSAL_COST 1.0f
+
+GameEngine::StaticBvh::StaticBvh()
+	: _initialized(false) {}
+
+GameEngine::StaticBvh::~StaticBvh() {}
+
+bool GameEngine::StaticBvh::findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const
+{
+	auto it = _indices.constFind(gameObject);
+	if (it == _indices.constEnd())
+		return false;
+
+	// Only leaves know their objects, so walk down every node overlapping the box the object was built with,
+	// its current one may have drifted if it got moved anyway
+	const auto bbox = _blocks[*it / AabbBlock::Size].get(*it % AabbBlock::Size);
+	nodes.clear();
+	QVarLengthArray<int, 64> stack;
+	stack.push_back(0);
+	while (!stack.isEmpty())
+	{
+		auto index = stack.last();
+		stack.pop_back();
+		const auto& node = _nodes[index];
+		if (!BoundingBox::isInsideOf(bbox, node.bbox))
+			continue;
+		if (node.count)
+		{
+			if (*it >= node.first && *it < node.first + node.count)
+			{
+				nodes.push_back(node.bbox);
+				return true;
+			}
+			continue;
+		}
+		stack.push_back(node.first);
+		stack.push_back(index + 1);
+	}
+	return false;
+}
+
+bool GameEngine::StaticBvh::raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode, float maxDistance) const
+{
+	// Nearer child is visited first and subtrees behind the best hit so far are skipped
+	gameObject = nullptr;
+	auto tHit = maxDistance;
+	QVarLengthArray<QPair<int, float>, 64> stack;
+	float t;
+	if (!_nodes.isEmpty() && Intersect::rayAndAABB(ray, _nodes[0].bbox, &t) && t < tHit)
+		stack.push_back(qMakePair(0, t));
+	while (!stack.isEmpty())
+	{
+		auto entry = stack.last();
+		stack.pop_back();
+		if (entry.second >= tHit)
+			continue;
+
+		const auto& node = _nodes[entry.first];
+		if (node.count)
+		{
+			for (auto i = node.first; i < node.first + node.count; i++)
+			{
+				if (!_gameObjects[i] || !Intersect::rayAndAABB(ray, _blocks[i / AabbBlock::Size].get(i % AabbBlock::Size), &t) || t >= tHit)
+					continue;
+				if (auto hit = raycastGameObject(ray, _gameObjects[i], mode, tHit, &t))
+				{
+					tHit = t;
+					gameObject = hit;
+					if (mode == AnyHit)
+						break;
+				}
+			}
+			if (gameObject && mode == AnyHit)
+				break;
+			continue;
+		}
+
+		float tLeft, tRight;
+		auto left = entry.first + 1;
+		auto right = node.first;
+		auto hitsLeft = Intersect::rayAndAABB(ray, _nodes[left].bbox, &tLeft) && tLeft < tHit;
+		auto hitsRight = Intersect::rayAndAABB(ray, _nodes[right].bbox, &tRight) && tRight < tHit;
+		if (hitsLeft && hitsRight && tLeft < tRight)
+		{
+			stack.push_back(qMakePair(right, tRight));
+			stack.push_back(qMakePair(left, tLeft));
+		}
+		else
+		{
+			if (hitsLeft)
+				stack.push_back(qMakePair(left, tLeft));
+			if (hitsRight)
+				stack.push_back(qMakePair(right, tRight));
+		}
+	}
+	if (gameObject && hitPoint)
+		*hitPoint = ray.origin() + ray.direction() * tHit;
+	return gameObject;
+}
+
+void GameEngine::StaticBvh::intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const
+{
+	QVarLengthArray<int, 64> stack;
+	if (!_nodes.isEmpty())
+		stack.push_back(0);
+	while (!stack.isEmpty())
+	{
+		auto index = stack.last();
+		stack.pop_back();
+		const auto& node = _nodes[index];
+		if (!frustum.intersects(node.bbox))
+			continue;
+		if (node.count)
+		{
+			// Leaves may straddle blocks, so shift each block's mask to the leaf's range
+			for (auto i = node.first; i < node.first + node.count; i = (i / AabbBlock::Size + 1) * AabbBlock::Size)
+			{
+				auto offset = i % AabbBlock::Size;
+				auto count = qMin<int>(AabbBlock::Size, offset + node.first + node.count - i);
+				auto mask = _blocks[i / AabbBlock::Size].intersect(frustum, count) >> offset;
+				for (auto j = i; mask; j++, mask >>= 1)
+					if ((mask & 1) && _gameObjects[j])
+						gameObjects.push_back(_gameObjects[j]);
+			}
+			continue;
+		}
+		stack.push_back(node.first);
+		stack.push_back(index + 1);
+	}
+}
+
+void GameEngine::StaticBvh::intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const
+{
+	// Each node travels with the views which saw its parent
+	QVarLengthArray<QPair<int, quint32>, 64> stack;
+	if (!_nodes.isEmpty() && frustums.views())
+		stack.push_back(qMakePair(0, frustums.views()));
+	while (!stack.isEmpty())
+	{
+		auto index = stack.last().first;
+		auto views = stack.last().second;
+		stack.pop_back();
+		const auto& node = _nodes[index];
+		views = frustums.intersects(node.bbox, views);
+		if (!views)
+			continue;
+		if (node.count)
+		{
+			quint32 masks[AabbBlock::Size];
+			for (auto i = node.first; i < node.first + node.count; i = (i / AabbBlock::Size + 1) * AabbBlock::Size)
+			{
+				auto offset = i % AabbBlock::Size;
+				auto count = qMin<int>(AabbBlock::Size, offset + node.first + node.count - i);
+				frustums.intersect(_blocks[i / AabbBlock::Size], count, views, masks);
+				for (auto j = offset; j < count; j++)
+					if (masks[j] && _gameObjects[i - offset + j])
+						gameObjects.push_back(qMakePair(_gameObjects[i - offset + j], masks[j]));
+			}
+			continue;
+		}
+		stack.push_back(qMakePair(node.first, views));
+		stack.push_back(qMakePair(index + 1, views));
+	}
+}
+
+void GameEngine::StaticBvh::add(GameObject* gameObject)
+{
+	throw std::logic_error("StaticBvh::add: Static hierarchy can't be changed after it's built.");
+}
+
+void GameEngine::StaticBvh::remove(GameObject* gameObject)
+{
+	auto it = _indices.find(gameObject);
+	if (it != _indices.end())
+	{
+		_gameObjects[*it] = nullptr;
+		_indices.erase(it);
+	}
+}
+
+bool GameEngine::StaticBvh::update(GameObject* gameObject)
+{
+	// Static objects never move
+	return false;
+}
+
+void GameEngine::StaticBvh::initialize(const QVector<GameObject*>& gameObjects)
+{
+	if (_initialized)
+	{
+		ERROR_LOG("> StaticBvh::initialize: Hierarchy is already initialized.");
+		return;
+	}
+
+	QTime timer;
+	timer.start();
+
+	QVector<Item> items;
+	items.reserve(gameObjects.count());
+	for (auto gameObject : gameObjects)
+	{
+		Item item = { gameObject, gameObject->boundingBox() };
+		items.push_back(item);
+	}
+	if (!items.isEmpty())
+	{
+		_nodes.reserve(2 * items.count() / MAX_LEAF_SIZE + 1);
+		build(items, 0, items.count());
+	}
+	_nodes.squeeze();
+
+	_gameObjects.reserve(items.count());
+	_blocks.resize((items.count() + AabbBlock::Size - 1) / AabbBlock::Size);
+	_indices.reserve(items.count());
+	for (const auto& item : items)
+	{
+		auto index = _gameObjects.count();
+		_indices.insert(item.gameObject, index);
+		_gameObjects.push_back(item.gameObject);
+		_blocks[index / AabbBlock::Size].set(index % AabbBlock::Size, item.bbox);
+	}
+	_initialized = true;
+
+	DEBUG_LOG("> StaticBvh::initialize: took " << timer.elapsed() / 1000.0f << "s, " << _nodes.count() << " nodes");
+}
+
+GameEngine::SpatialIndex::OutlierStats GameEngine::StaticBvh::outlierStats() const
+{
+	OutlierStats stats = { 0, _indices.count(), 0 };
+	return stats;
+}
+
+int GameEngine::StaticBvh::nodeCount() const
+{
+	return _nodes.count();
+}
+
+void GameEngine::StaticBvh::build(QVector<Item>& items, int first, int count)
+{
+	auto index = _nodes.count();
+	_nodes.push_back(Node());
+
+	auto bbox = items[first].bbox;
+	auto centroids = BoundingBox(bbox.midPoint(), bbox.midPoint());
+	for (auto i = first + 1; i < first + count; i++)
+	{
+		bbox = BoundingBox::combine(bbox, items[i].bbox);
+		centroids = BoundingBox::combine(centroids, BoundingBox(items[i].bbox.midPoint(), items[i].bbox.midPoint()));
+	}
+	_nodes[index].bbox = bbox;
+	_nodes[index].first = first;
+	_nodes[index].count = count;
+	if (count <= MAX_LEAF_SIZE)
+		return;
+
+	int axis;
+	float split;
+	auto middle = first;
+	if (findSplit(items, first, count, bbox, centroids, &axis, &split))
+	{
+		middle = std::partition(items.begin() + first, items.begin() + first + count,
+		                        [axis, split](const Item& item)
+		                        {
+			                        return item.bbox.midPoint()[axis] < split;
+		                        }) - items.begin();
+	}
+	else if (count > MAX_SAH_LEAF_SIZE)
+	{
+		// Splitting doesn't pay off, but the leaf would be too big, fall back to the median
+		const auto& extent = centroids.extent();
+		axis = extent.x() > extent.y() && extent.x() > extent.z() ? 0 : extent.y() > extent.z() ? 1 : 2;
+		middle = first + count / 2;
+		std::nth_element(items.begin() + first, items.begin() + middle, items.begin() + first + count,
+		                 [axis](const Item& a, const Item& b)
+		                 {
+			                 return a.bbox.midPoint()[axis] < b.bbox.midPoint()[axis];
+		                 });
+	}
+	if (middle == first || middle == first + count)
+		return;
+
+	_nodes[index].count = 0;
+	build(items, first, middle - first);
+	_nodes[index].first = _nodes.count();
+	build(items, middle, first + count - middle);
+}
+
+bool GameEngine::StaticBvh::findSplit(const QVector<Item>& items, int first, int count, const BoundingBox& bbox, const BoundingBox& centroids, int* axis, float* split) const
+{
+	// Binned SAH, costs are scaled by the parent's surface area to avoid the division
+	auto bestCost = count * bbox.surfaceArea();
+	auto found = false;
+	for (auto a = 0; a < 3; a++)
+	{
+		auto min = centroids.minPoint()[a];
+		auto extent = centroids.extent()[a];
+		if (extent <= 0)
+			continue;
+
+		int binCounts[BIN_COUNT] = {};
+		BoundingBox binBoxes[BIN_COUNT];
+		for (auto i = first; i < first + count; i++)
+		{
+			auto bin = qMin(BIN_COUNT - 1, static_cast<int>((items[i].bbox.midPoint()[a] - min) / extent * BIN_COUNT));
+			binBoxes[bin] = binCounts[bin] ? BoundingBox::combine(binBoxes[bin], items[i].bbox) : items[i].bbox;
+			binCounts[bin]++;
+		}
+
+		// Sweep from the right to get the cost of everything above each plane
+		float rightCosts[BIN_COUNT];
+		BoundingBox rightBox;
+		auto rightCount = 0;
+		for (auto i = BIN_COUNT - 1; i > 0; i--)
+		{
+			if (binCounts[i])
+			{
+				rightBox = rightCount ? BoundingBox::combine(rightBox, binBoxes[i]) : binBoxes[i];
+				rightCount += binCounts[i];
+			}
+			rightCosts[i] = rightCount ? rightCount * rightBox.surfaceArea() : 0;
+		}
+
+		BoundingBox leftBox;
+		auto leftCount = 0;
+		for (auto i = 0; i < BIN_COUNT - 1; i++)
+		{
+			if (binCounts[i])
+			{
+				leftBox = leftCount ? BoundingBox::combine(leftBox, binBoxes[i]) : binBoxes[i];
+				leftCount += binCounts[i];
+			}
+			if (!leftCount || leftCount == count)
+				continue;
+			auto cost = TRAVERSAL_COST * bbox.surfaceArea() + leftCount * leftBox.surfaceArea() + rightCosts[i + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				*axis = a;
+				*split = min + extent * (i + 1) / BIN_COUNT;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <QHash>
+#include <QVector>
+#include "Includes.h"
+#include "SpatialIndex.h"
+#include "AabbBlock.h"
+
+namespace GameEngine {
+	/*
+	Bounding volume hierarchy over static game objects, built once with the surface area heuristic.
+	Nodes are stored depth first in a flat array, left child always follows its parent. Unlike other
+	indices, frustum intersection returns static objects since that's all the hierarchy contains.
+	The hierarchy can't be changed after it's built, removed objects are only skipped by queries.
+	*/
+	class StaticBvh final : public SpatialIndex
+	{
+		NOCOPY(StaticBvh)
+
+	public:
+		EXPORT StaticBvh();
+		EXPORT ~StaticBvh();
+		EXPORT bool findGameObject(GameObject* gameObject, QVector<BoundingBox>& nodes) const override;
+		EXPORT bool raycast(const Ray3D& ray, GameObject*& gameObject, QVector3D* hitPoint, RaycastMode mode = ClosestHit,
+		                    float maxDistance = std::numeric_limits<float>::max()) const override;
+		EXPORT void intersect(const CullingFrustum& frustum, QList<GameObject*>& gameObjects) const override;
+		EXPORT void intersect(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects) const override;
+		EXPORT void add(GameObject* gameObject) override;
+		EXPORT void remove(GameObject* gameObject) override;
+		EXPORT bool update(GameObject* gameObject) override;
+		EXPORT void initialize(const QVector<GameObject*>& gameObjects) override;
+		EXPORT OutlierStats outlierStats() const override;
+		EXPORT int nodeCount() const;
+
+	private:
+		struct Node
+		{
+			BoundingBox bbox;
+			int first; // First object for leaves, right child otherwise
+			int count; // 0 for inner nodes
+		};
+		struct Item
+		{
+			GameObject* gameObject;
+			BoundingBox bbox;
+		};
+
+		void build(QVector<Item>& items, int first, int count);
+		bool findSplit(const QVector<Item>& items, int first, int count, const BoundingBox& bbox, const BoundingBox& centroids, int* axis, float* split) const;
+
+		QVector<Node> _nodes;
+		QVector<GameObject*> _gameObjects; // Null for removed objects
+		QVector<AabbBlock> _blocks; // Bounding boxes objects had when the hierarchy was built, eight per block
+		QHash<GameObject*, int> _indices;
+		bool _initialized;
+	};
+}
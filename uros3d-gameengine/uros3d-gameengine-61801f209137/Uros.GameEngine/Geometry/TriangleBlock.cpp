@@ -0,0 +1,178 @@
+#include "TriangleBlock.h"
+#include "Ray3D.h"
+
+#if defined(__AVX__)
+#define SIMD_AVX
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_IX86_FP) && _M_IX86_FP >= 1
+#define SIMD_SSE
+#include <xmmintrin.h>
+#endif
+
+#define EPSILON 0.00001f
+
+GameEngine::TriangleBlock::TriangleBlock()
+{
+	for (auto i = 0; i < Size; i++)
+		_v0X[i] = _v0Y[i] = _v0Z[i] = _e1X[i] = _e1Y[i] = _e1Z[i] = _e2X[i] = _e2Y[i] = _e2Z[i] = 0;
+}
+
+void GameEngine::TriangleBlock::get(int index, QVector3D& v0, QVector3D& v1, QVector3D& v2) const
+{
+	v0 = QVector3D(_v0X[index], _v0Y[index], _v0Z[index]);
+	v1 = v0 + QVector3D(_e1X[index], _e1Y[index], _e1Z[index]);
+	v2 = v0 + QVector3D(_e2X[index], _e2Y[index], _e2Z[index]);
+}
+
+void GameEngine::TriangleBlock::set(int index, const QVector3D& v0, const QVector3D& v1, const QVector3D& v2)
+{
+	auto e1 = v1 - v0;
+	auto e2 = v2 - v0;
+	_v0X[index] = v0.x();
+	_v0Y[index] = v0.y();
+	_v0Z[index] = v0.z();
+	_e1X[index] = e1.x();
+	_e1Y[index] = e1.y();
+	_e1Z[index] = e1.z();
+	_e2X[index] = e2.x();
+	_e2Y[index] = e2.y();
+	_e2Z[index] = e2.z();
+}
+
+int GameEngine::TriangleBlock::intersect(const Ray3D& ray, float tMax, float* t, float* u, float* v, int count) const
+{
+	// Fast Minimum Storage Ray/Triangle Intersection, Moller & Trumbore, for a whole block at once
+	const auto& origin = ray.origin();
+	const auto& direction = ray.direction();
+	float ts[Size], us[Size], vs[Size];
+	auto mask = 0;
+
+#if defined(SIMD_AVX)
+	auto dx = _mm256_set1_ps(direction.x());
+	auto dy = _mm256_set1_ps(direction.y());
+	auto dz = _mm256_set1_ps(direction.z());
+	auto e1x = _mm256_loadu_ps(_e1X);
+	auto e1y = _mm256_loadu_ps(_e1Y);
+	auto e1z = _mm256_loadu_ps(_e1Z);
+	auto e2x = _mm256_loadu_ps(_e2X);
+	auto e2y = _mm256_loadu_ps(_e2Y);
+	auto e2z = _mm256_loadu_ps(_e2Z);
+
+	// h = d x e2, a = e1 . h
+	auto hx = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+	auto hy = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+	auto hz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+	auto a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, hx), _mm256_mul_ps(e1y, hy)), _mm256_mul_ps(e1z, hz));
+	auto f = _mm256_div_ps(_mm256_set1_ps(1), a);
+
+	// s = o - v0, u = f (s . h)
+	auto sx = _mm256_sub_ps(_mm256_set1_ps(origin.x()), _mm256_loadu_ps(_v0X));
+	auto sy = _mm256_sub_ps(_mm256_set1_ps(origin.y()), _mm256_loadu_ps(_v0Y));
+	auto sz = _mm256_sub_ps(_mm256_set1_ps(origin.z()), _mm256_loadu_ps(_v0Z));
+	auto uu = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, hx), _mm256_mul_ps(sy, hy)), _mm256_mul_ps(sz, hz)));
+
+	// q = s x e1, v = f (d . q), t = f (e2 . q)
+	auto qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+	auto qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+	auto qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+	auto vv = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)));
+	auto tt = _mm256_mul_ps(f, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)));
+
+	auto epsilon = _mm256_set1_ps(EPSILON);
+	auto zero = _mm256_setzero_ps();
+	auto one = _mm256_set1_ps(1);
+	auto hit = _mm256_or_ps(_mm256_cmp_ps(a, epsilon, _CMP_GE_OQ), _mm256_cmp_ps(a, _mm256_sub_ps(zero, epsilon), _CMP_LE_OQ));
+	hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(uu, zero, _CMP_GE_OQ), _mm256_cmp_ps(uu, one, _CMP_LE_OQ)));
+	hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(vv, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(uu, vv), one, _CMP_LE_OQ)));
+	hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(tt, epsilon, _CMP_GT_OQ), _mm256_cmp_ps(tt, _mm256_set1_ps(tMax), _CMP_LT_OQ)));
+	mask = _mm256_movemask_ps(hit);
+	_mm256_storeu_ps(ts, tt);
+	_mm256_storeu_ps(us, uu);
+	_mm256_storeu_ps(vs, vv);
+#elif defined(SIMD_SSE)
+	auto dx = _mm_set1_ps(direction.x());
+	auto dy = _mm_set1_ps(direction.y());
+	auto dz = _mm_set1_ps(direction.z());
+	auto ox = _mm_set1_ps(origin.x());
+	auto oy = _mm_set1_ps(origin.y());
+	auto oz = _mm_set1_ps(origin.z());
+	auto epsilon = _mm_set1_ps(EPSILON);
+	auto zero = _mm_setzero_ps();
+	auto one = _mm_set1_ps(1);
+	auto limit = _mm_set1_ps(tMax);
+	for (auto offset = 0; offset < Size; offset += 4)
+	{
+		auto e1x = _mm_loadu_ps(_e1X + offset);
+		auto e1y = _mm_loadu_ps(_e1Y + offset);
+		auto e1z = _mm_loadu_ps(_e1Z + offset);
+		auto e2x = _mm_loadu_ps(_e2X + offset);
+		auto e2y = _mm_loadu_ps(_e2Y + offset);
+		auto e2z = _mm_loadu_ps(_e2Z + offset);
+
+		// h = d x e2, a = e1 . h
+		auto hx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+		auto hy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+		auto hz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+		auto a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)), _mm_mul_ps(e1z, hz));
+		auto f = _mm_div_ps(one, a);
+
+		// s = o - v0, u = f (s . h)
+		auto sx = _mm_sub_ps(ox, _mm_loadu_ps(_v0X + offset));
+		auto sy = _mm_sub_ps(oy, _mm_loadu_ps(_v0Y + offset));
+		auto sz = _mm_sub_ps(oz, _mm_loadu_ps(_v0Z + offset));
+		auto uu = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx), _mm_mul_ps(sy, hy)), _mm_mul_ps(sz, hz)));
+
+		// q = s x e1, v = f (d . q), t = f (e2 . q)
+		auto qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+		auto qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+		auto qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+		auto vv = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+		auto tt = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+
+		auto hit = _mm_or_ps(_mm_cmpge_ps(a, epsilon), _mm_cmple_ps(a, _mm_sub_ps(zero, epsilon)));
+		hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(uu, zero), _mm_cmple_ps(uu, one)));
+		hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(vv, zero), _mm_cmple_ps(_mm_add_ps(uu, vv), one)));
+		hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(tt, epsilon), _mm_cmplt_ps(tt, limit)));
+		mask |= _mm_movemask_ps(hit) << offset;
+		_mm_storeu_ps(ts + offset, tt);
+		_mm_storeu_ps(us + offset, uu);
+		_mm_storeu_ps(vs + offset, vv);
+	}
+#else
+	for (auto j = 0; j < count; j++)
+	{
+		QVector3D e1(_e1X[j], _e1Y[j], _e1Z[j]);
+		QVector3D e2(_e2X[j], _e2Y[j], _e2Z[j]);
+		auto h = QVector3D::crossProduct(direction, e2);
+		auto a = QVector3D::dotProduct(e1, h);
+		if (a > -EPSILON && a < EPSILON)
+			continue;
+		auto f = 1 / a;
+		auto s = origin - QVector3D(_v0X[j], _v0Y[j], _v0Z[j]);
+		us[j] = f * QVector3D::dotProduct(s, h);
+		if (us[j] < 0 || us[j] > 1)
+			continue;
+		auto q = QVector3D::crossProduct(s, e1);
+		vs[j] = f * QVector3D::dotProduct(direction, q);
+		if (vs[j] < 0 || us[j] + vs[j] > 1)
+			continue;
+		ts[j] = f * QVector3D::dotProduct(e2, q);
+		if (ts[j] > EPSILON && ts[j] < tMax)
+			mask |= 1 << j;
+	}
+#endif
+
+	// Nearest of the triangles hit
+	mask &= (1 << count) - 1;
+	auto nearest = -1;
+	for (auto j = 0; mask; j++, mask >>= 1)
+		if ((mask & 1) && (nearest < 0 || ts[j] < ts[nearest]))
+			nearest = j;
+	if (nearest >= 0)
+	{
+		*t = ts[nearest];
+		*u = us[nearest];
+		*v = vs[nearest];
+	}
+	return nearest;
+}
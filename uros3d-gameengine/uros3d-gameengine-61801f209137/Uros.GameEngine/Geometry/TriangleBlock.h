@@ -0,0 +1,42 @@
+#pragma once
+#include <QVector3D>
+#include "Includes.h"
+
+namespace GameEngine {
+	class Ray3D;
+
+	/*
+	Block of triangles stored as separate arrays of coordinates, so one ray can be tested against a whole block
+	at once. Triangles are kept as their first vertex and two edges, ready for Moller-Trumbore. Uses AVX or SSE
+	when the compiler targets them, plain loops otherwise.
+	*/
+	class TriangleBlock final
+	{
+	public:
+		enum
+		{
+			Size = 8
+		};
+
+		EXPORT TriangleBlock();
+		EXPORT void get(int index, QVector3D& v0, QVector3D& v1, QVector3D& v2) const;
+		EXPORT void set(int index, const QVector3D& v0, const QVector3D& v1, const QVector3D& v2);
+		/*
+		Tests first count triangles of the block and returns index of the nearest one hit closer than tMax,
+		-1 if none is. Distance and barycentric coordinates of the hit are stored to t, u and v.
+		Same rules as Intersect::rayAndTriangle apply, so both find the same hits.
+		*/
+		EXPORT int intersect(const Ray3D& ray, float tMax, float* t, float* u, float* v, int count = Size) const;
+
+	private:
+		float _v0X[Size];
+		float _v0Y[Size];
+		float _v0Z[Size];
+		float _e1X[Size];
+		float _e1Y[Size];
+		float _e1Z[Size];
+		float _e2X[Size];
+		float _e2Y[Size];
+		float _e2Z[Size];
+	};
+}
@@ -0,0 +1,219 @@
+#include <QPair>
+#include "TriangleBvh.h"
+#include "GeometryBase.h"
+#include "Ray3D.h"
+
+#define MAX_DEPTH 64
+
+QAtomicInt GameEngine::TriangleBvh::_totalMemoryUsage;
+
+GameEngine::TriangleBvh::TriangleBvh(const GeometryBase& geometry)
+{
+	// Triangles are read once, everything after works on plain copies
+	auto count = geometry.triangleCount();
+	QVector<QVector3D> vertices(count * 3);
+	QVector<QVector3D> centers(count);
+	_triangles.resize(count);
+	for (auto i = 0; i < count; i++)
+	{
+		QVector3D n0, n1, n2;
+		geometry.getTriangleData(i, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2], n0, n1, n2);
+		centers[i] = (vertices[i * 3] + vertices[i * 3 + 1] + vertices[i * 3 + 2]) / 3;
+		_triangles[i] = i;
+	}
+	if (count)
+	{
+		_nodes.reserve(2 * count / LeafSize + 1);
+		build(0, count, vertices, centers);
+	}
+	_nodes.squeeze();
+
+	// Leaves get their own blocks, slots past the end of a leaf stay unused
+	QVector<int> triangles;
+	for (auto& node : _nodes)
+		if (node.count)
+		{
+			TriangleBlock block;
+			for (auto i = 0; i < node.count; i++)
+			{
+				auto triangle = _triangles[node.start + i];
+				block.set(i, vertices[triangle * 3], vertices[triangle * 3 + 1], vertices[triangle * 3 + 2]);
+				triangles.push_back(triangle);
+			}
+			for (auto i = node.count; i < TriangleBlock::Size; i++)
+				triangles.push_back(-1);
+			node.start = _blocks.count();
+			_blocks.push_back(block);
+		}
+	_blocks.squeeze();
+	_triangles = triangles;
+	_totalMemoryUsage.fetchAndAddOrdered(memoryUsage());
+	DEBUG_LOG("> TriangleBvh: " << count << " triangles, " << _nodes.count() << " nodes, " << memoryUsage() / 1024 << " KB");
+}
+
+GameEngine::TriangleBvh::~TriangleBvh()
+{
+	_totalMemoryUsage.fetchAndAddOrdered(-memoryUsage());
+}
+
+int GameEngine::TriangleBvh::nodeCount() const
+{
+	return _nodes.count();
+}
+
+int GameEngine::TriangleBvh::triangleCount() const
+{
+	return _triangles.count() - _triangles.count(-1);
+}
+
+int GameEngine::TriangleBvh::memoryUsage() const
+{
+	return _nodes.capacity() * sizeof(Node) + _blocks.capacity() * sizeof(TriangleBlock) + _triangles.capacity() * sizeof(int);
+}
+
+int GameEngine::TriangleBvh::totalMemoryUsage()
+{
+	return _totalMemoryUsage.load();
+}
+
+bool GameEngine::TriangleBvh::raycast(const Ray3D& ray, float* t, int* triangle, QVector2D* barycentrics, float tMax) const
+{
+	float u, v;
+	auto hit = traverse(ray, false, &tMax, &u, &v);
+	if (hit < 0)
+		return false;
+	*t = tMax;
+	if (triangle)
+		*triangle = _triangles[hit];
+	if (barycentrics)
+		*barycentrics = QVector2D(u, v);
+	return true;
+}
+
+bool GameEngine::TriangleBvh::intersects(const Ray3D& ray, float tMax, float* t) const
+{
+	float u, v;
+	if (traverse(ray, true, &tMax, &u, &v) < 0)
+		return false;
+	if (t)
+		*t = tMax;
+	return true;
+}
+
+int GameEngine::TriangleBvh::traverse(const Ray3D& ray, bool anyHit, float* t, float* u, float* v) const
+{
+	if (_nodes.isEmpty())
+		return -1;
+
+	// Hits further than t are ignored, t shrinks to every closer hit found
+	const auto& origin = ray.origin();
+	const auto& direction = ray.direction();
+	auto inverse = QVector3D(1 / direction.x(), 1 / direction.y(), 1 / direction.z());
+	auto hit = -1;
+	auto hitsNode = [&](int index, float* tNear)
+	{
+		const auto& node = _nodes[index];
+		auto t0 = (node.min - origin) * inverse;
+		auto t1 = (node.max - origin) * inverse;
+		auto tMin = qMax(qMax(qMin(t0.x(), t1.x()), qMin(t0.y(), t1.y())), qMin(t0.z(), t1.z()));
+		auto tMax = qMin(qMin(qMax(t0.x(), t1.x()), qMax(t0.y(), t1.y())), qMax(t0.z(), t1.z()));
+		*tNear = tMin;
+		return tMax >= qMax(tMin, 0.0f) && tMin < *t;
+	};
+
+	QPair<int, float> stack[MAX_DEPTH];
+	auto size = 0;
+	float tNear;
+	if (hitsNode(0, &tNear))
+		stack[size++] = qMakePair(0, tNear);
+	while (size)
+	{
+		auto entry = stack[--size];
+		// Something closer was hit since the node was pushed
+		if (entry.second >= *t)
+			continue;
+
+		const auto& node = _nodes[entry.first];
+		if (node.count)
+		{
+			auto lane = _blocks[node.start].intersect(ray, *t, t, u, v, node.count);
+			if (lane >= 0)
+			{
+				hit = node.start * TriangleBlock::Size + lane;
+				if (anyHit)
+					break;
+			}
+			continue;
+		}
+
+		// Nearer child goes on top of the stack
+		float tLeft, tRight;
+		auto left = entry.first + 1;
+		auto right = node.start;
+		auto hitsLeft = hitsNode(left, &tLeft);
+		auto hitsRight = hitsNode(right, &tRight);
+		if (hitsLeft && hitsRight && tLeft < tRight)
+		{
+			stack[size++] = qMakePair(right, tRight);
+			stack[size++] = qMakePair(left, tLeft);
+		}
+		else
+		{
+			if (hitsLeft)
+				stack[size++] = qMakePair(left, tLeft);
+			if (hitsRight)
+				stack[size++] = qMakePair(right, tRight);
+		}
+	}
+	return hit;
+}
+
+int GameEngine::TriangleBvh::build(int start, int count, const QVector<QVector3D>& vertices, const QVector<QVector3D>& centers)
+{
+	auto index = _nodes.count();
+	_nodes.push_back(Node());
+
+	auto min = QVector3D(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+	auto max = -min;
+	auto centerMin = min;
+	auto centerMax = max;
+	for (auto i = start; i < start + count; i++)
+	{
+		auto triangle = _triangles[i];
+		for (auto j = 0; j < 3; j++)
+		{
+			const auto& vertex = vertices[triangle * 3 + j];
+			min = QVector3D(fmin(min.x(), vertex.x()), fmin(min.y(), vertex.y()), fmin(min.z(), vertex.z()));
+			max = QVector3D(fmax(max.x(), vertex.x()), fmax(max.y(), vertex.y()), fmax(max.z(), vertex.z()));
+		}
+		const auto& center = centers[triangle];
+		centerMin = QVector3D(fmin(centerMin.x(), center.x()), fmin(centerMin.y(), center.y()), fmin(centerMin.z(), center.z()));
+		centerMax = QVector3D(fmax(centerMax.x(), center.x()), fmax(centerMax.y(), center.y()), fmax(centerMax.z(), center.z()));
+	}
+	_nodes[index].min = min;
+	_nodes[index].max = max;
+
+	if (count <= LeafSize)
+	{
+		_nodes[index].start = start;
+		_nodes[index].count = count;
+		return index;
+	}
+
+	// Median split along the longest axis of the centers keeps the tree balanced,
+	// triangles sharing one center are just halved since no axis tells them apart
+	auto extent = centerMax - centerMin;
+	auto axis = extent.x() > extent.y() ? (extent.x() > extent.z() ? 0 : 2) : (extent.y() > extent.z() ? 1 : 2);
+	auto middle = start + count / 2;
+	if (extent[axis] > 0)
+		std::nth_element(_triangles.begin() + start, _triangles.begin() + middle, _triangles.begin() + start + count,
+		                 [&](int a, int b)
+		                 {
+			                 return centers[a][axis] < centers[b][axis];
+		                 });
+	build(start, middle - start, vertices, centers);
+	auto right = build(middle, start + count - middle, vertices, centers);
+	_nodes[index].start = right;
+	_nodes[index].count = 0;
+	return index;
+}
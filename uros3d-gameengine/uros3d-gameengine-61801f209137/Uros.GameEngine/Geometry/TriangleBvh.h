@@ -0,0 +1,72 @@
+#pragma once
+#include <limits>
+#include <QAtomicInt>
+#include <QVector>
+#include <QVector2D>
+#include <QVector3D>
+#include "Includes.h"
+#include "TriangleBlock.h"
+
+namespace GameEngine {
+	class GeometryBase;
+	class Ray3D;
+
+	/*
+	Bounding volume hierarchy over triangles of a single geometry, in the geometry's own space. Every leaf holds
+	one block of triangles copied out of the geometry, so traversal never goes through virtual calls and a whole
+	leaf is tested at once. Rays visit the nearer child first and subtrees further than the closest hit so far
+	are skipped.
+	*/
+	class TriangleBvh final
+	{
+		NOCOPY(TriangleBvh)
+
+	public:
+		enum
+		{
+			LeafSize = TriangleBlock::Size
+		};
+
+		EXPORT explicit TriangleBvh(const GeometryBase& geometry);
+		EXPORT ~TriangleBvh();
+		EXPORT int nodeCount() const;
+		EXPORT int triangleCount() const;
+		/*
+		Bytes taken by nodes and triangle copies.
+		*/
+		EXPORT int memoryUsage() const;
+		/*
+		Bytes taken by all hierarchies currently alive.
+		*/
+		EXPORT static int totalMemoryUsage();
+		/*
+		Finds the closest triangle hit by the ray closer than tMax. Direction doesn't have to be normalized, t is
+		measured in its units. Index of the hit triangle in the original geometry and barycentric coordinates of
+		the hit are stored to triangle and barycentrics if they're not null.
+		*/
+		EXPORT bool raycast(const Ray3D& ray, float* t, int* triangle = nullptr, QVector2D* barycentrics = nullptr,
+		                    float tMax = std::numeric_limits<float>::max()) const;
+		/*
+		Checks if the ray hits any triangle closer than tMax and stops at the first one found, which doesn't have
+		to be the closest. Distance of that hit is stored to t if it's not null.
+		*/
+		EXPORT bool intersects(const Ray3D& ray, float tMax, float* t = nullptr) const;
+
+	private:
+		struct Node
+		{
+			QVector3D min;
+			QVector3D max;
+			int start; // Block of a leaf, second child of an inner node
+			int count; // Triangles in a leaf, zero for inner nodes whose first child follows them
+		};
+
+		int traverse(const Ray3D& ray, bool anyHit, float* t, float* u, float* v) const;
+		int build(int start, int count, const QVector<QVector3D>& vertices, const QVector<QVector3D>& centers);
+
+		QVector<Node> _nodes;
+		QVector<TriangleBlock> _blocks;
+		QVector<int> _triangles; // Original index of every triangle, block after block
+		static QAtomicInt _totalMemoryUsage;
+	};
+}
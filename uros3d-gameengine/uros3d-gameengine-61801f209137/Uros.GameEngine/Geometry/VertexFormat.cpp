@@ -0,0 +1,145 @@
+#include <cmath>
+#include <cstring>
+#include "VertexFormat.h"
+#include "BoundingBox.h"
+#include "Mesh.h"
+
+#define QUANTIZE_MAX 65535.0f
+#define SNORM_MAX 32767.0f
+
+quint16 GameEngine::VertexFormat::quantize(float value, float min, float extent)
+{
+	if (extent <= 0)
+		return 0;
+	return quint16(qBound(0.0f, (value - min) / extent, 1.0f) * QUANTIZE_MAX + 0.5f);
+}
+
+float GameEngine::VertexFormat::dequantize(quint16 value, float min, float extent)
+{
+	return min + value / QUANTIZE_MAX * extent;
+}
+
+void GameEngine::VertexFormat::encodeNormal(const QVector3D& normal, qint16* encoded)
+{
+	// Octahedral mapping, lower hemisphere is folded over the diagonals of the upper one
+	float length = fabsf(normal.x()) + fabsf(normal.y()) + fabsf(normal.z());
+	float x = length > 0 ? normal.x() / length : 0;
+	float y = length > 0 ? normal.y() / length : 0;
+	if (normal.z() < 0)
+	{
+		float foldedX = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+		float foldedY = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+		x = foldedX;
+		y = foldedY;
+	}
+	encoded[0] = qint16(qRound(qBound(-1.0f, x, 1.0f) * SNORM_MAX));
+	encoded[1] = qint16(qRound(qBound(-1.0f, y, 1.0f) * SNORM_MAX));
+}
+
+QVector3D GameEngine::VertexFormat::decodeNormal(const qint16* encoded)
+{
+	// Same decoding the vertex shader does
+	auto x = qMax(encoded[0] / SNORM_MAX, -1.0f);
+	auto y = qMax(encoded[1] / SNORM_MAX, -1.0f);
+	float z = 1 - fabsf(x) - fabsf(y);
+	if (z < 0)
+	{
+		float unfoldedX = (1 - fabsf(y)) * (x >= 0 ? 1 : -1);
+		float unfoldedY = (1 - fabsf(x)) * (y >= 0 ? 1 : -1);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+	return QVector3D(x, y, z).normalized();
+}
+
+quint16 GameEngine::VertexFormat::toHalf(float value)
+{
+	quint32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	quint32 sign = (bits >> 16) & 0x8000;
+	int exponent = int((bits >> 23) & 0xff) - 127 + 15;
+	quint32 mantissa = bits & 0x7fffff;
+
+	// NaN and infinity, or too big to fit
+	if ((bits & 0x7fffffff) >= 0x7f800000)
+		return quint16(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	if (exponent >= 31)
+		return quint16(sign | 0x7c00);
+
+	// Denormalized halves keep the implicit bit in the mantissa
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return quint16(sign);
+		mantissa |= 0x800000;
+		auto shift = 14 - exponent;
+		auto half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1)
+			half++;
+		return quint16(sign | half);
+	}
+
+	// Rounding carry may overflow into the exponent, which is still the correctly rounded result
+	auto half = sign | (quint32(exponent) << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000)
+		half++;
+	return quint16(half);
+}
+
+float GameEngine::VertexFormat::fromHalf(quint16 value)
+{
+	quint32 sign = quint32(value & 0x8000) << 16;
+	quint32 exponent = (value >> 10) & 0x1f;
+	quint32 mantissa = value & 0x3ff;
+	if (exponent == 0)
+	{
+		auto result = ldexpf(float(mantissa), -24);
+		return sign ? -result : result;
+	}
+
+	quint32 bits;
+	if (exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+GameEngine::VertexFormat::CompactVertex GameEngine::VertexFormat::pack(const QVector3D& v, const QVector3D& n, const QVector3D& coord, const BoundingBox& bounds)
+{
+	const auto& min = bounds.minPoint();
+	const auto& extent = bounds.extent();
+	CompactVertex vertex;
+	for (auto i = 0; i < 3; i++)
+		vertex.position[i] = quantize(v[i], min[i], extent[i]);
+	vertex.position[3] = 0;
+	encodeNormal(n, vertex.normal);
+	vertex.texcoord[0] = toHalf(coord.x());
+	vertex.texcoord[1] = toHalf(coord.y());
+	return vertex;
+}
+
+void GameEngine::VertexFormat::unpack(const CompactVertex& vertex, const BoundingBox& bounds, QVector3D& v, QVector3D& n, QVector3D& coord)
+{
+	const auto& min = bounds.minPoint();
+	const auto& extent = bounds.extent();
+	for (auto i = 0; i < 3; i++)
+		v[i] = dequantize(vertex.position[i], min[i], extent[i]);
+	n = decodeNormal(vertex.normal);
+	coord = QVector3D(fromHalf(vertex.texcoord[0]), fromHalf(vertex.texcoord[1]), 0);
+}
+
+QVector<GameEngine::VertexFormat::CompactVertex> GameEngine::VertexFormat::pack(const Mesh& mesh)
+{
+	QVector<CompactVertex> vertices(mesh.uniqueVertexCount());
+	const auto& bounds = mesh.boundingBox();
+	for (auto i = 0; i < vertices.count(); i++)
+	{
+		QVector3D v, n, coord;
+		mesh.getUniqueVertexData(i, v, n, coord);
+		vertices[i] = pack(v, n, coord, bounds);
+	}
+	return vertices;
+}
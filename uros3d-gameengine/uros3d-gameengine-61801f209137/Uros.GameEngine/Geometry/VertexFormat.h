@@ -0,0 +1,60 @@
+#pragma once
+#include <QVector>
+#include <QVector3D>
+#include "Includes.h"
+
+namespace GameEngine {
+	class BoundingBox;
+	class Mesh;
+
+	/*
+	Compact vertex layout used for GPU buffers. Positions are quantized to 16 bits per axis within the mesh's
+	bounding box, normals are octahedral-encoded into two signed 16 bit values and texture coordinates are
+	stored as two half floats, all interleaved into 16 bytes instead of 36 bytes of separate float arrays.
+	*/
+	class VertexFormat final
+	{
+		NOCOPY(VertexFormat)
+		VertexFormat();
+		~VertexFormat();
+
+	public:
+		struct CompactVertex
+		{
+			quint16 position[4]; // Fourth one only pads the normal to a 4 byte boundary
+			qint16 normal[2];
+			quint16 texcoord[2];
+		};
+
+		enum
+		{
+			CompactStride = sizeof(CompactVertex),
+			PositionOffset = 0,
+			NormalOffset = 4 * sizeof(quint16),
+			TexcoordOffset = 6 * sizeof(quint16)
+		};
+
+		/*
+		Maps value from [min, min + extent] to [0, 65535], values outside are clamped.
+		*/
+		EXPORT static quint16 quantize(float value, float min, float extent);
+		EXPORT static float dequantize(quint16 value, float min, float extent);
+		/*
+		Folds unit normal onto an octahedron and stores its two coordinates as normalized signed shorts.
+		*/
+		EXPORT static void encodeNormal(const QVector3D& normal, qint16* encoded);
+		EXPORT static QVector3D decodeNormal(const qint16* encoded);
+		/*
+		IEEE 754 half precision conversion, rounds to nearest.
+		*/
+		EXPORT static quint16 toHalf(float value);
+		EXPORT static float fromHalf(quint16 value);
+
+		EXPORT static CompactVertex pack(const QVector3D& v, const QVector3D& n, const QVector3D& coord, const BoundingBox& bounds);
+		EXPORT static void unpack(const CompactVertex& vertex, const BoundingBox& bounds, QVector3D& v, QVector3D& n, QVector3D& coord);
+		/*
+		Packs all unique vertices of the mesh, in the order its indices refer to them.
+		*/
+		EXPORT static QVector<CompactVertex> pack(const Mesh& mesh);
+	};
+}
@@ -2,9 +2,12 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QVector>
+#include <vector>
+#include "Application.h"
 #include "GameObject.h"
 #include "GameObjectReaderOBJ.h"
 #include "Geometry/Mesh.h"
+#include "Geometry/MeshOptimizer.h"
 #include "Rendering/MeshRenderer.h"
 
 #define MAX_BUFFER 32
@@ -38,8 +41,8 @@ GameEngine::GameObject* GameEngine::GameObjectReaderOBJ::read() const
 		QVector<QVector3D> normals;
 
 		QString objectName;
-		QVector<float> objectVertices;
-		QVector<float> objectNormals;
+		std::vector<float> objectVertices;
+		std::vector<float> objectNormals;
 
 		for (int i = 0; i < data.count(); i++)
 		{
@@ -47,19 +50,19 @@ GameEngine::GameObject* GameEngine::GameObjectReaderOBJ::read() const
 
 			if (i == data.count() - 1 || c == 'v' && (i == 0 || data[i - 1] == '\n'))
 			{
-				if (objectVertices.count() > 0)
+				if (!objectVertices.empty())
 				{
-					//Mesh from the previous object is pending
-
-					int count = objectVertices.count();
-					auto verts = new float[count];
-					auto norms = new float[count];
-					std::copy(objectVertices.begin(), objectVertices.end(), verts);
-					std::copy(objectNormals.begin(), objectNormals.end(), norms);
-					auto bbox = BoundingBox::create(verts, count);
-					auto mesh = new Mesh(verts, norms, count);
-					delete[] verts;
-					delete[] norms;
+					//Mesh from the previous object is pending, it's welded straight from the parsed arrays
+
+					int count = static_cast<int>(objectVertices.size());
+					auto bbox = BoundingBox::create(objectVertices.data(), count);
+					auto mesh = new Mesh(objectVertices.data(), objectNormals.data(), count);
+					if (Application::settings().isMeshOptimizationEnabled())
+					{
+						auto optimized = MeshOptimizer::optimize(*mesh);
+						delete mesh;
+						mesh = optimized;
+					}
 
 					auto subObject = new GameObject(objectName);
 					subObject->addComponent<MeshRenderer>()->setMesh(mesh);
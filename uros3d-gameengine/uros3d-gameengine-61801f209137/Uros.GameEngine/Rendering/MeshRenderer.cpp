@@ -3,11 +3,15 @@
 #include "GameObject.h"
 #include "RenderingManager.h"
 
+#define LOD_DETAIL_SIZE 256.0f
+#define LOD_HYSTERESIS 0.15f
+
 GameEngine::MeshRenderer::MeshRenderer(GameObject* gameObject)
 	: Renderer(gameObject),
 	  _mesh(nullptr),
 	  _bbox(nullptr),
-	  _frameID(-1) {}
+	  _frameID(-1),
+	  _lod(0) {}
 
 GameEngine::MeshRenderer::~MeshRenderer()
 {
@@ -60,10 +64,45 @@ GameEngine::Mesh* GameEngine::MeshRenderer::getMesh() const
 void GameEngine::MeshRenderer::setMesh(Mesh* mesh)
 {
 	_mesh = mesh;
+	_lod = 0;
 	delete _bbox;
 	_bbox = nullptr;
 }
 
+int GameEngine::MeshRenderer::selectLod(float screenSize, float cullSize)
+{
+	if (!_mesh)
+		return -1;
+
+	// Level l covers sizes from LOD_DETAIL_SIZE / 2^(l + 1) up to LOD_DETAIL_SIZE / 2^l, except the first one
+	// going all the way up and the last one all the way down to the cull size
+	auto count = _mesh->lodCount();
+	auto lower = [&](int level)
+	{
+		if (level < 0)
+			return 0.0f;
+		return level == count - 1 ? cullSize : LOD_DETAIL_SIZE / (1 << (level + 1));
+	};
+	auto upper = [&](int level)
+	{
+		if (level < 0)
+			return cullSize;
+		return level == 0 ? std::numeric_limits<float>::max() : LOD_DETAIL_SIZE / (1 << level);
+	};
+	if (_lod >= count || screenSize < lower(_lod) * (1 - LOD_HYSTERESIS) || screenSize >= upper(_lod) * (1 + LOD_HYSTERESIS))
+	{
+		_lod = screenSize < cullSize ? -1 : 0;
+		while (_lod >= 0 && _lod < count - 1 && screenSize < lower(_lod))
+			_lod++;
+	}
+	return _lod;
+}
+
+int GameEngine::MeshRenderer::getLod() const
+{
+	return _lod;
+}
+
 void GameEngine::MeshRenderer::render()
 {
 	if (!_mesh)
@@ -72,10 +111,19 @@ void GameEngine::MeshRenderer::render()
 	int curFrameID = renderManager->stats().currentFrame().id();
 	if (_frameID == curFrameID)
 		return; // Already rendered, skip redundant draw calls
+	const Mesh* mesh = _mesh;
+	auto screenSize = renderManager->lodScreenSize(boundingBox());
+	if (screenSize >= 0)
+	{
+		auto level = selectLod(screenSize, renderManager->lodCullSize());
+		if (level < 0)
+			return;
+		mesh = &_mesh->lod(level);
+	}
 	auto transform = gameObject()->transform()->getMatrix();
 	renderManager->pushTransform(transform);
 	renderManager->bindMaterial(getConstMaterial());
-	renderManager->draw(_mesh);
+	renderManager->draw(mesh);
 	renderManager->popTransform();
 	_frameID = curFrameID;
 }
@@ -17,6 +17,13 @@ namespace GameEngine {
 		EXPORT const BoundingBox& boundingBox() override;
 		EXPORT Mesh* getMesh() const;
 		EXPORT void setMesh(Mesh* mesh);
+		/*
+		Picks the mesh's level of detail for a screen size in pixels, -1 when it's smaller than cullSize and
+		shouldn't be drawn at all. The current level is kept until the size leaves its range by a margin, so
+		objects right at a boundary don't switch levels every frame.
+		*/
+		EXPORT int selectLod(float screenSize, float cullSize);
+		EXPORT int getLod() const;
 		void render() override;
 
 	protected slots:
@@ -26,5 +33,6 @@ namespace GameEngine {
 		Mesh* _mesh;
 		BoundingBox* _bbox;
 		int _frameID;
+		int _lod;
 	};
 }
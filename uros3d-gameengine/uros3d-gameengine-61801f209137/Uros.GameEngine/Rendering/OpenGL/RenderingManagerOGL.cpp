@@ -6,9 +6,11 @@
 #include "RenderBufferGL.h"
 #include "Rendering/Material.h"
 #include "Geometry/Mesh.h"
+#include "Geometry/VertexFormat.h"
 #include "Scene/Light.h"
 #include "Scene/Camera.h"
 #include "GameObject.h"
+#include "Application.h"
 
 /* Shaders */
 #include "VertexShader.glsl"
@@ -16,13 +18,21 @@
 #include "FragmentShader.glsl"
 #include "FragmentShader.Skybox.glsl"
 
-GameEngine::RenderingManagerOGL::RenderingManagerOGL() {}
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#endif
+
+GameEngine::RenderingManagerOGL::RenderingManagerOGL()
+	: _compactVertices(false) {}
 
 GameEngine::RenderingManagerOGL::~RenderingManagerOGL()
 {
 	for (auto vboID : _vboMap.values())
 		glDeleteBuffers(1, &vboID);
 
+	for (auto iboID : _iboMap.values())
+		glDeleteBuffers(1, &iboID);
+
 	for (auto texID : _textureMap.values())
 		glDeleteTextures(1, &texID);
 }
@@ -40,6 +50,9 @@ void GameEngine::RenderingManagerOGL::initialize()
 	glDisable(GL_CULL_FACE);
 	glClearColor(0.0, 0.0, 0.0, 1.0);
 
+	// Buffers are built once per mesh, so the format can't change while they live
+	_compactVertices = Application::settings().getVertexFormatType() == Settings::CompactVertices;
+
 	if (!_shader.addShaderFromSourceCode(QOpenGLShader::Vertex, vertex_shader))
 		ERROR_LOG(_shader.log().toStdString());
 
@@ -191,24 +204,23 @@ void GameEngine::RenderingManagerOGL::bindMaterial(const Material& material)
 void GameEngine::RenderingManagerOGL::draw(const GeometryBase* geometry)
 {
 	GLuint vboID = getVBO(geometry);
-	if (vboID > 0)
+	GLuint iboID = getIBO(geometry);
+	if (vboID > 0 && iboID > 0)
 	{
+		auto mesh = static_cast<const Mesh*>(geometry);
 		_shader.bind();
 		{
 			glBindBuffer(GL_ARRAY_BUFFER, vboID);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
 			{
-				int vertexCount = geometry->vertexCount();
-				_shader.setAttributeBuffer("vertex", GL_FLOAT, 0, 3);
-				_shader.setAttributeBuffer("normal", GL_FLOAT, vertexCount * 3 * sizeof(float), 3);
-				_shader.setAttributeBuffer("texcoord", GL_FLOAT, 2 * vertexCount * 3 * sizeof(float), 3);
-				_shader.enableAttributeArray("vertex");
-				_shader.enableAttributeArray("normal");
-				_shader.enableAttributeArray("texcoord");
-				glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+				setVertexAttributes(_shader, mesh, "vertex", "normal", "texcoord");
+				_shader.setUniformValue("compactVertices", _compactVertices);
+				glDrawElements(GL_TRIANGLES, mesh->indexCount(), mesh->indexSize() == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, nullptr);
 				_shader.disableAttributeArray("vertex");
 				_shader.disableAttributeArray("normal");
 				_shader.disableAttributeArray("texcoord");
 			}
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 		}
 		_shader.release();
@@ -235,6 +247,7 @@ void GameEngine::RenderingManagerOGL::draw(const GeometryBase* geometry)
 		//glEnd();
 
 		stats().currentFrame().incrementDrawCalls();
+		stats().currentFrame().addTriangles(mesh->triangleCount());
 	}
 
 	DBG_CHECK_GL_ERRORS
@@ -308,22 +321,25 @@ void GameEngine::RenderingManagerOGL::draw(const SkyBox* skyBox)
 			if (auto mesh = Mesh::cube())
 			{
 				GLuint vboID = getVBO(mesh);
-				if (vboID > 0)
+				GLuint iboID = getIBO(mesh);
+				if (vboID > 0 && iboID > 0)
 				{
 					_skyBoxShader.bind();
 					{
 						glBindBuffer(GL_ARRAY_BUFFER, vboID);
+						glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
 						{
-							_skyBoxShader.setAttributeBuffer("Position", GL_FLOAT, 0, 3);
-							_skyBoxShader.enableAttributeArray("Position");
-							glDrawArrays(GL_TRIANGLES, 0, mesh->vertexCount());
+							setVertexAttributes(_skyBoxShader, mesh, "Position", nullptr, nullptr);
+							glDrawElements(GL_TRIANGLES, mesh->indexCount(), mesh->indexSize() == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, nullptr);
 							_skyBoxShader.disableAttributeArray("Position");
 						}
+						glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 						glBindBuffer(GL_ARRAY_BUFFER, 0);
 					}
 					_skyBoxShader.release();
 
 					stats().currentFrame().incrementDrawCalls();
+					stats().currentFrame().addTriangles(mesh->triangleCount());
 				}
 			}
 		}
@@ -370,13 +386,19 @@ GLuint GameEngine::RenderingManagerOGL::getVBO(const GeometryBase* geometry)
 			// Generate VBO
 			glGenBuffers(1, &vboID);
 			glBindBuffer(GL_ARRAY_BUFFER, vboID);
+			if (_compactVertices)
+			{
+				auto bufferData = VertexFormat::pack(*mesh);
+				glBufferData(GL_ARRAY_BUFFER, bufferData.count() * VertexFormat::CompactStride, bufferData.constData(), GL_STATIC_DRAW);
+			}
+			else
 			{
-				float* bufferData = new float[3 * mesh->_verticesCount];
-				std::copy(mesh->_vertices, mesh->_vertices + mesh->_verticesCount, bufferData);
-				std::copy(mesh->_normals, mesh->_normals + mesh->_verticesCount, bufferData + mesh->_verticesCount);
-				std::copy(mesh->_texcoords, mesh->_texcoords + mesh->_verticesCount, bufferData + 2 * mesh->_verticesCount);
-				glBufferData(GL_ARRAY_BUFFER, 3 * mesh->_verticesCount * sizeof(float), bufferData, GL_STATIC_DRAW);
-				delete[] bufferData;
+				// Planar arrays go up straight from the mesh's own storage, there's no staging copy
+				auto size = static_cast<GLsizeiptr>(mesh->_vertices.size() * sizeof(float));
+				glBufferData(GL_ARRAY_BUFFER, 3 * size, nullptr, GL_STATIC_DRAW);
+				glBufferSubData(GL_ARRAY_BUFFER, 0, size, mesh->_vertices.data());
+				glBufferSubData(GL_ARRAY_BUFFER, size, size, mesh->_normals.data());
+				glBufferSubData(GL_ARRAY_BUFFER, 2 * size, size, mesh->_texcoords.data());
 			}
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 			_vboMap.insert(mesh, vboID);
@@ -386,3 +408,66 @@ GLuint GameEngine::RenderingManagerOGL::getVBO(const GeometryBase* geometry)
 	DBG_CHECK_GL_ERRORS
 	return vboID;
 }
+
+GLuint GameEngine::RenderingManagerOGL::getIBO(const GeometryBase* geometry)
+{
+	GLuint iboID = 0;
+	if (auto mesh = dynamic_cast<const Mesh*>(geometry))
+	{
+		if (_iboMap.contains(mesh))
+			iboID = _iboMap[mesh];
+		else
+		{
+			// Generate IBO, indices go up exactly as the mesh keeps them
+			glGenBuffers(1, &iboID);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->indexCount() * mesh->indexSize(), mesh->indexData(), GL_STATIC_DRAW);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			_iboMap.insert(mesh, iboID);
+		}
+	}
+
+	DBG_CHECK_GL_ERRORS
+	return iboID;
+}
+
+void GameEngine::RenderingManagerOGL::setVertexAttributes(QOpenGLShaderProgram& shader, const Mesh* mesh, const char* position, const char* normal, const char* texcoord)
+{
+	// Compact buffers are interleaved and decoded in the shader, full ones keep separate float arrays
+	if (_compactVertices)
+	{
+		const auto& bounds = mesh->boundingBox();
+		shader.setUniformValue("boundsMin", bounds.minPoint());
+		shader.setUniformValue("boundsExtent", bounds.extent());
+		// Attributes the shader compiler optimized away have no location, pointing one at -1 is a GL error
+		auto setAttribute = [&shader](const char* name, int size, GLenum type, GLboolean normalized, size_t offset)
+		{
+			auto location = name ? shader.attributeLocation(name) : -1;
+			if (location < 0)
+				return;
+			glVertexAttribPointer(location, size, type, normalized, VertexFormat::CompactStride, reinterpret_cast<const void*>(offset));
+			shader.enableAttributeArray(location);
+		};
+		setAttribute(position, 3, GL_UNSIGNED_SHORT, GL_TRUE, VertexFormat::PositionOffset);
+		setAttribute(normal, 2, GL_SHORT, GL_TRUE, VertexFormat::NormalOffset);
+		setAttribute(texcoord, 2, GL_HALF_FLOAT, GL_FALSE, VertexFormat::TexcoordOffset);
+	}
+	else
+	{
+		auto vertexCount = mesh->uniqueVertexCount();
+		shader.setUniformValue("boundsMin", QVector3D(0, 0, 0));
+		shader.setUniformValue("boundsExtent", QVector3D(1, 1, 1));
+		shader.setAttributeBuffer(position, GL_FLOAT, 0, 3);
+		shader.enableAttributeArray(position);
+		if (normal)
+		{
+			shader.setAttributeBuffer(normal, GL_FLOAT, vertexCount * 3 * sizeof(float), 3);
+			shader.enableAttributeArray(normal);
+		}
+		if (texcoord)
+		{
+			shader.setAttributeBuffer(texcoord, GL_FLOAT, 2 * vertexCount * 3 * sizeof(float), 3);
+			shader.enableAttributeArray(texcoord);
+		}
+	}
+}
@@ -5,6 +5,7 @@
 #include "Rendering/RenderingManager.h"
 
 namespace GameEngine {
+	class Mesh;
 
 	class RenderingManagerOGL : public RenderingManagerInstance, protected OpenGLFuncs
 	{
@@ -13,7 +14,9 @@ namespace GameEngine {
 		QOpenGLShaderProgram _skyBoxShader;
 		QHash<QString, GLuint> _textureMap;
 		QHash<const GeometryBase*, GLuint> _vboMap;
+		QHash<const GeometryBase*, GLuint> _iboMap;
 		QHash<const SkyBox*, GLuint> _skyBoxMap;
+		bool _compactVertices;
 	public:
 		RenderingManagerOGL();
 		~RenderingManagerOGL() override;
@@ -29,5 +32,7 @@ namespace GameEngine {
 		void dbgDrawLines(const Segment3D* segments, int count, const QColor& color, float thickness = 1.0f) override;
 	private:
 		GLuint getVBO(const GeometryBase* geometry);
+		GLuint getIBO(const GeometryBase* geometry);
+		void setVertexAttributes(QOpenGLShaderProgram& shader, const Mesh* mesh, const char* position, const char* normal, const char* texcoord);
 	};
 }
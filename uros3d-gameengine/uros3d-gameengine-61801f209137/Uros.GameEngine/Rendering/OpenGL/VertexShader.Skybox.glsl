@@ -1,9 +1,12 @@
 const char* skybox_vsh =
 	"varying vec3 TexCoord0;"
 	"attribute vec3 Position;"
+	"uniform vec3 boundsMin;"
+	"uniform vec3 boundsExtent;"
 	"void main()"
 	"{"
-		"vec4 WVP_Pos = gl_ModelViewProjectionMatrix * vec4(Position, 1.0);"
+		"vec3 position = boundsMin + Position * boundsExtent;"
+		"vec4 WVP_Pos = gl_ModelViewProjectionMatrix * vec4(position, 1.0);"
 		"gl_Position = WVP_Pos.xyww;"
-		"TexCoord0 = Position;"
+		"TexCoord0 = position;"
 	"}";
\ No newline at end of file
@@ -8,11 +8,24 @@
 		"attribute vec3 normal;"
 		"attribute vec3 texcoord;"
 
+		// Compact vertices come normalized to the mesh bounds, full ones use zero and one
+		"uniform vec3 boundsMin;"
+		"uniform vec3 boundsExtent;"
+		"uniform bool compactVertices;"
+
+		"vec3 decodeNormal(vec2 encoded)"
+		"{"
+			"vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));"
+			"if (n.z < 0.0)"
+				"n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);"
+			"return normalize(n);"
+		"}"
+
 		"void main()"
 		"{"
-			"vec4 vert = vec4(vertex, 1.0);"
+			"vec4 vert = vec4(boundsMin + vertex * boundsExtent, 1.0);"
 			"gl_Position = gl_ModelViewProjectionMatrix * vert;"
 			"Vert = gl_ModelViewMatrix * vert;"
-			"Norm = gl_NormalMatrix * normal;"
+			"Norm = gl_NormalMatrix * (compactVertices ? decodeNormal(normal.xy) : normal);"
 			"Tex = texcoord;"
 		"}";
\ No newline at end of file
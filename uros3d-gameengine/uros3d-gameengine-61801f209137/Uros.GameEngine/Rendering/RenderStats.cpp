@@ -9,7 +9,11 @@ GameEngine::FrameStats::FrameStats()
 	: _id(-1),
 	  _start(0),
 	  _time(0),
-	  _drawCalls(0) {}
+	  _drawCalls(0),
+	  _triangles(0),
+	  _movedObjects(0),
+	  _occludedObjects(0),
+	  _occlusionTime(0) {}
 
 GameEngine::FrameStats::FrameStats(int time)
 	: FrameStats(time, 0) {}
@@ -18,7 +22,11 @@ GameEngine::FrameStats::FrameStats(int time, int drawCalls)
 	: _id(_frameCounter++),
 	  _start(QDateTime::currentMSecsSinceEpoch()),
 	  _time(time),
-	  _drawCalls(drawCalls) {}
+	  _drawCalls(drawCalls),
+	  _triangles(0),
+	  _movedObjects(0),
+	  _occludedObjects(0),
+	  _occlusionTime(0) {}
 
 long GameEngine::FrameStats::id() const
 {
@@ -40,6 +48,26 @@ int GameEngine::FrameStats::drawCalls() const
 	return _drawCalls;
 }
 
+int GameEngine::FrameStats::triangles() const
+{
+	return _triangles;
+}
+
+int GameEngine::FrameStats::movedObjects() const
+{
+	return _movedObjects;
+}
+
+int GameEngine::FrameStats::occludedObjects() const
+{
+	return _occludedObjects;
+}
+
+double GameEngine::FrameStats::occlusionTime() const
+{
+	return _occlusionTime;
+}
+
 void GameEngine::FrameStats::setTime(double time)
 {
 	_time = time;
@@ -50,10 +78,33 @@ void GameEngine::FrameStats::incrementDrawCalls()
 	_drawCalls++;
 }
 
+void GameEngine::FrameStats::addTriangles(int count)
+{
+	_triangles += count;
+}
+
+void GameEngine::FrameStats::addMovedObjects(int count)
+{
+	_movedObjects += count;
+}
+
+void GameEngine::FrameStats::addOccludedObjects(int count)
+{
+	_occludedObjects += count;
+}
+
+void GameEngine::FrameStats::addOcclusionTime(double time)
+{
+	_occlusionTime += time;
+}
+
 GameEngine::RenderStats::RenderStats()
 	: _currFrame(0),
 	  _batchCount(0),
 	  _batchSize(0),
+	  _outlierCount(0),
+	  _rerootCount(0),
+	  _triangleBvhMemory(0),
 	  _avgFPS(0),
 	  _frameStats(MAX_FRAMES),
 	  _fCullStatus(false)
@@ -82,6 +133,38 @@ float GameEngine::RenderStats::averageDrawCalls() const
 	return total * 1.0f / MAX_FRAMES;
 }
 
+float GameEngine::RenderStats::averageTriangles() const
+{
+	int total = 0;
+	for (auto frameStats : _frameStats)
+		total += frameStats.triangles();
+	return total * 1.0f / MAX_FRAMES;
+}
+
+float GameEngine::RenderStats::averageMovedObjects() const
+{
+	int total = 0;
+	for (auto frameStats : _frameStats)
+		total += frameStats.movedObjects();
+	return total * 1.0f / MAX_FRAMES;
+}
+
+float GameEngine::RenderStats::averageOccludedObjects() const
+{
+	int total = 0;
+	for (auto frameStats : _frameStats)
+		total += frameStats.occludedObjects();
+	return total * 1.0f / MAX_FRAMES;
+}
+
+float GameEngine::RenderStats::averageOcclusionTime() const
+{
+	double total = 0;
+	for (auto frameStats : _frameStats)
+		total += frameStats.occlusionTime();
+	return total * 1.0f / MAX_FRAMES;
+}
+
 int GameEngine::RenderStats::batchCount() const
 {
 	return _batchCount;
@@ -110,6 +193,21 @@ int GameEngine::RenderStats::batchSize() const
 	return _batchSize;
 }
 
+int GameEngine::RenderStats::outlierCount() const
+{
+	return _outlierCount;
+}
+
+int GameEngine::RenderStats::rerootCount() const
+{
+	return _rerootCount;
+}
+
+int GameEngine::RenderStats::triangleBvhMemory() const
+{
+	return _triangleBvhMemory;
+}
+
 bool GameEngine::RenderStats::getFrustumCullStatus() const
 {
 	return _fCullStatus;
@@ -125,6 +223,21 @@ void GameEngine::RenderStats::setBatchSize(int size)
 	_batchSize = size;
 }
 
+void GameEngine::RenderStats::setOutlierCount(int count)
+{
+	_outlierCount = count;
+}
+
+void GameEngine::RenderStats::setRerootCount(int count)
+{
+	_rerootCount = count;
+}
+
+void GameEngine::RenderStats::setTriangleBvhMemory(int bytes)
+{
+	_triangleBvhMemory = bytes;
+}
+
 void GameEngine::RenderStats::setFrustumCullStatus(bool status)
 {
 	_fCullStatus = status;
@@ -146,6 +259,6 @@ QString GameEngine::RenderStats::toQString() const
 	}
 	bSize = bSize > 1024 ? bSize / 1024 : bSize;
 	bSize = bSize > 1024 ? bSize / 1024 : bSize;
-	return QString::asprintf("Frustum Culling: %s; %.0f draw calls @ %.0f FPS (%.2fms); %i batches (%.2f %s)",
-	                         _fCullStatus ? "ON" : "OFF", averageDrawCalls(), averageFrameRate(), averageFrameTime(), batchCount(), bSize, unit);
+	return QString::asprintf("Frustum Culling: %s; %.0f draw calls (%.0fK triangles) @ %.0f FPS (%.2fms); %i batches (%.2f %s); %.0f moved; %i outliers (%i reroots); %.0f occluded (%.2fms); %.2f MB triangle BVHs",
+	                         _fCullStatus ? "ON" : "OFF", averageDrawCalls(), averageTriangles() / 1000, averageFrameRate(), averageFrameTime(), batchCount(), bSize, unit, averageMovedObjects(), outlierCount(), rerootCount(), averageOccludedObjects(), averageOcclusionTime(), triangleBvhMemory() / (1024.0f * 1024.0f));
 }
@@ -12,8 +12,16 @@ namespace GameEngine {
 		long start() const;
 		double time() const;
 		int drawCalls() const;
+		int triangles() const;
+		int movedObjects() const;
+		int occludedObjects() const;
+		double occlusionTime() const;
 		void setTime(double time);
 		void incrementDrawCalls();
+		void addTriangles(int count);
+		void addMovedObjects(int count);
+		void addOccludedObjects(int count);
+		void addOcclusionTime(double time);
 
 	private:
 		static long _frameCounter;
@@ -21,6 +29,10 @@ namespace GameEngine {
 		long _start;
 		double _time;
 		int _drawCalls;
+		int _triangles;
+		int _movedObjects;
+		int _occludedObjects;
+		double _occlusionTime;
 	};
 
 	class RenderStats final
@@ -30,13 +42,23 @@ namespace GameEngine {
 		float averageFrameTime() const;
 		float averageFrameRate() const;
 		float averageDrawCalls() const;
+		float averageTriangles() const;
+		float averageMovedObjects() const;
+		float averageOccludedObjects() const;
+		float averageOcclusionTime() const;
 		int batchCount() const;
 		int batchSize() const;
+		int outlierCount() const;
+		int rerootCount() const;
+		int triangleBvhMemory() const;
 		bool getFrustumCullStatus() const;
 		FrameStats& currentFrame();
 		void pushCurrentFrame();
 		void setBatchCount(int count);
 		void setBatchSize(int size);
+		void setOutlierCount(int count);
+		void setRerootCount(int count);
+		void setTriangleBvhMemory(int bytes);
 		void setFrustumCullStatus(bool status);
 		QString toQString() const;
 
@@ -44,6 +66,9 @@ namespace GameEngine {
 		int _currFrame;
 		int _batchCount;
 		int _batchSize;
+		int _outlierCount;
+		int _rerootCount;
+		int _triangleBvhMemory;
 		float _avgFPS;
 		bool _fCullStatus;
 		FrameStats _lastSync;
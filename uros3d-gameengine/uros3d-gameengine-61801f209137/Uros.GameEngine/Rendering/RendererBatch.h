@@ -2,6 +2,7 @@
 #include "Renderer.h"
 #include "MeshRenderer.h"
 #include "Geometry/GeometryBase.h"
+#include "Geometry/MeshOptimizer.h"
 
 namespace GameEngine {
 	template <typename RendererType>
@@ -101,7 +102,9 @@ namespace GameEngine {
 	template <typename RendererType>
 	int RendererBatch<RendererType>::geometrySize() const
 	{
-		return _geometry ? _geometry->vertexCount() * 3 * sizeof(float) * 3 : 0;
+		if (auto mesh = dynamic_cast<const Mesh*>(_geometry))
+			return mesh->uniqueVertexCount() * 3 * sizeof(float) * 3 + mesh->indexCount() * mesh->indexSize();
+		return 0;
 	}
 
 	template <typename RendererType>
@@ -170,27 +173,36 @@ namespace GameEngine {
 			if (_geometry)
 				delete _geometry;
 
+			// Only welded vertices get transformed, indices are shifted to where each mesh's vertices land
 			int count = 0;
+			int indexCount = 0;
 			for (auto renderer : _renderers)
 				if (auto geometry = renderer->getMesh())
-					count += geometry->vertexCount() * 3;
+				{
+					count += geometry->uniqueVertexCount() * 3;
+					indexCount += geometry->indexCount();
+				}
 
 			std::vector<float> vertices(count);
 			std::vector<float> normals(count);
 			std::vector<float> texcoords(count);
+			std::vector<quint32> indices(indexCount);
 			int vPos = 0;
 			int nPos = 0;
 			int cPos = 0;
+			int iPos = 0;
 			for (auto renderer : _renderers)
 			{
 				if (Mesh* geometry = renderer->getMesh())
 				{
 					QVector3D v, n, c;
 					const QMatrix4x4& transform = renderer->gameObject()->transform()->getMatrix();
-					for (int i = 0; i < geometry->vertexCount(); i++)
+					quint32 first = vPos / 3;
+					for (int i = 0; i < geometry->indexCount(); i++)
+						indices[iPos++] = first + geometry->getIndex(i);
+					for (int i = 0; i < geometry->uniqueVertexCount(); i++)
 					{
-						geometry->getVertexData(i, v, n);
-						geometry->getTextureCoord(i, c);
+						geometry->getUniqueVertexData(i, v, n, c);
 						v = transform * v;
 						vertices[vPos++] = v[0];
 						vertices[vPos++] = v[1];
@@ -204,7 +216,9 @@ namespace GameEngine {
 					}
 				}
 			}
-			_geometry = new Mesh(vertices.data(), normals.data(), texcoords.data(), count);
+			// Batches are static, so the reordering is paid once for every frame they get drawn in
+			MeshOptimizer::optimize(indices, vertices, normals, texcoords);
+			_geometry = new Mesh(std::move(vertices), std::move(normals), std::move(texcoords), std::move(indices));
 		}
 		else
 		ERROR_LOG("> RendererBatch::build() Unsupported renderer type.");
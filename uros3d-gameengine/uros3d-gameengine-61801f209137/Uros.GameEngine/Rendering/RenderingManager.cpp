@@ -1,10 +1,12 @@
 #include "RenderingManager.h"
-#include "Geometry/Intersect.h"
 #include "Scene/Camera.h"
 
 GameEngine::RenderingManagerInstance* GameEngine::RenderingManager::_instance = nullptr;
 
-GameEngine::RenderingManagerInstance::RenderingManagerInstance() {}
+GameEngine::RenderingManagerInstance::RenderingManagerInstance()
+	: _lodCamera(nullptr),
+	  _lodViewportHeight(0),
+	  _lodCullSize(0) {}
 
 GameEngine::RenderingManagerInstance::~RenderingManagerInstance()
 {
@@ -12,7 +14,7 @@ GameEngine::RenderingManagerInstance::~RenderingManagerInstance()
 		delete batch;
 }
 
-void GameEngine::RenderingManagerInstance::drawOpaqueBatches(const Camera* activeCamera)
+void GameEngine::RenderingManagerInstance::drawOpaqueBatches(const QSet<Material>* visibleBatches)
 {
 	pushTransform(QMatrix4x4());
 	{
@@ -23,9 +25,7 @@ void GameEngine::RenderingManagerInstance::drawOpaqueBatches(const Camera* activ
 
 			if (auto geometry = batch->geometry())
 			{
-				if (!activeCamera || activeCamera &&
-					Intersect::aabbAndAABB(activeCamera->frustum().boundingBox(), geometry->boundingBox()) &&
-					Intersect::frustumAndAABB(activeCamera->frustum(), geometry->boundingBox()))
+				if (!visibleBatches || visibleBatches->contains(batch->material()))
 				{
 					bindMaterial(batch->material());
 					draw(geometry);
@@ -36,7 +36,7 @@ void GameEngine::RenderingManagerInstance::drawOpaqueBatches(const Camera* activ
 	popTransform();
 }
 
-void GameEngine::RenderingManagerInstance::drawTransparentBatches(const Camera* activeCamera)
+void GameEngine::RenderingManagerInstance::drawTransparentBatches(const QSet<Material>* visibleBatches)
 {
 	pushTransform(QMatrix4x4());
 	{
@@ -48,9 +48,7 @@ void GameEngine::RenderingManagerInstance::drawTransparentBatches(const Camera*
 
 			if (auto geometry = batch->geometry())
 			{
-				if (!activeCamera || activeCamera &&
-					Intersect::aabbAndAABB(activeCamera->frustum().boundingBox(), geometry->boundingBox()) &&
-					Intersect::frustumAndAABB(activeCamera->frustum(), geometry->boundingBox()))
+				if (!visibleBatches || visibleBatches->contains(batch->material()))
 				{
 					bindMaterial(batch->material());
 					draw(geometry);
@@ -66,6 +64,25 @@ GameEngine::RenderStats& GameEngine::RenderingManagerInstance::stats()
 	return _stats;
 }
 
+void GameEngine::RenderingManagerInstance::setLodView(const Camera* camera, float viewportHeight, float cullSize)
+{
+	_lodCamera = camera;
+	_lodViewportHeight = viewportHeight;
+	_lodCullSize = cullSize;
+}
+
+float GameEngine::RenderingManagerInstance::lodScreenSize(const BoundingBox& box) const
+{
+	if (!_lodCamera)
+		return -1;
+	return _lodCamera->projectedSize(box) * _lodViewportHeight;
+}
+
+float GameEngine::RenderingManagerInstance::lodCullSize() const
+{
+	return _lodCullSize;
+}
+
 GameEngine::RenderingManagerInstance* GameEngine::RenderingManager::instance()
 {
 	if (!_instance)
@@ -1,4 +1,5 @@
 #pragma once
+#include <QSet>
 #include <QMatrix4x4>
 #include <QElapsedTimer>
 #include "MeshRenderer.h"
@@ -60,12 +61,30 @@ namespace GameEngine {
 			_stats.setBatchSize(size);
 			DEBUG_LOG("> RenderingManager::buildStaticBatches: took " << timer.elapsed() / 1000.0 << "s");
 		}
-		void drawOpaqueBatches(const Camera* activeCamera = nullptr);
-		void drawTransparentBatches(const Camera* activeCamera = nullptr);
+		/*
+		Draws static batches. If visible batches are specified, other batches are skipped.
+		*/
+		void drawOpaqueBatches(const QSet<Material>* visibleBatches = nullptr);
+		void drawTransparentBatches(const QSet<Material>* visibleBatches = nullptr);
 		RenderStats& stats();
+		/*
+		View mesh renderers pick their level of detail for. Without a camera every mesh is drawn at full detail.
+		*/
+		void setLodView(const Camera* camera, float viewportHeight, float cullSize);
+		/*
+		Height of the box on screen in pixels, negative when there's no view to measure it in.
+		*/
+		float lodScreenSize(const BoundingBox& box) const;
+		/*
+		Objects smaller than this many pixels aren't drawn at all.
+		*/
+		float lodCullSize() const;
 
 	private:
 		RenderStats _stats;
+		const Camera* _lodCamera;
+		float _lodViewportHeight;
+		float _lodCullSize;
 		QHash<Material, RendererBatch<MeshRenderer>*> _staticBatches;
 	};
 
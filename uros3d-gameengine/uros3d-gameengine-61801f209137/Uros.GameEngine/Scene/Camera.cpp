@@ -211,6 +211,18 @@ QVector3D GameEngine::Camera::worldToScreen(const QVector3D& world) const
 	return QVector3D();
 }
 
+float GameEngine::Camera::projectedSize(const BoundingBox& box) const
+{
+	const float PI = 3.1415926;
+	auto radius = box.extent().length() / 2;
+	if (_ortho)
+		return 2 * radius / _size;
+	auto distance = (box.midPoint() - gameObject()->transform()->getPosition()).length();
+	if (distance <= radius)
+		return std::numeric_limits<float>::max();
+	return radius / (distance * tanf(_fov / 2 * PI / 180));
+}
+
 GameEngine::CameraFrustum::CameraFrustum(Camera* camera)
 {
 	_camera = camera;
@@ -303,6 +315,11 @@ void GameEngine::CameraFrustum::getSegments(QVector<Segment3D>& segments) const
 	segments[11] = Segment3D(corners[3], corners[7]);
 }
 
+GameEngine::CullingFrustum GameEngine::CameraFrustum::snapshot() const
+{
+	return CullingFrustum(_camera->projectionMatrix());
+}
+
 void GameEngine::CameraFrustum::getPlanes(QVector<Plane3D>& planes) const
 {
 	static QVector<QVector3D> corners(8);
@@ -4,6 +4,7 @@
 #include "Geometry/Segment3D.h"
 #include "Geometry/Plane3D.h"
 #include "Geometry/BoundingBox.h"
+#include "Geometry/CullingFrustum.h"
 
 namespace GameEngine {
 	class Camera;
@@ -19,6 +20,10 @@ namespace GameEngine {
 		EXPORT void getCorners(QVector<QVector3D>& corners) const;
 		EXPORT void getSegments(QVector<Segment3D>& segments) const;
 		EXPORT void getPlanes(QVector<Plane3D>& planes) const;
+		/*
+		Takes a snapshot of the frustum for culling, take it once per frame and reuse it for all tests.
+		*/
+		EXPORT CullingFrustum snapshot() const;
 	};
 
 	class Camera final : public Component
@@ -73,5 +78,9 @@ namespace GameEngine {
 
 		EXPORT QVector3D screenToWorld(const QVector3D& screen) const;
 		EXPORT QVector3D worldToScreen(const QVector3D& world) const;
+		/*
+		Height of the box's bounding sphere on screen, as a fraction of the view's height.
+		*/
+		EXPORT float projectedSize(const BoundingBox& box) const;
 	};
 }
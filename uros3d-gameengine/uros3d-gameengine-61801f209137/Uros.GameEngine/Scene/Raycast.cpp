@@ -1,9 +1,11 @@
 #include "Raycast.h"
 #include "ProjectManager.h"
 
-GameEngine::Raycast::Raycast(const Ray3D& ray)
+GameEngine::Raycast::Raycast(const Ray3D& ray, SpatialIndex::RaycastMode mode, float maxDistance)
 {
 	_ray = ray;
+	_mode = mode;
+	_maxDistance = maxDistance;
 	_gameObject = nullptr;
 	_gameObject = doRaycast();
 }
@@ -31,7 +33,24 @@ GameEngine::GameObject* GameEngine::Raycast::doRaycast()
 	{
 		if (auto scene = project->getActiveScene())
 		{
-			scene->octree().raycast(_ray, _gameObject, &_hitPoint);
+			scene->updateSpatialIndex();
+			auto maxDistance = _maxDistance;
+			if (auto spatialIndex = scene->spatialIndex())
+				if (spatialIndex->raycast(_ray, _gameObject, &_hitPoint, _mode, maxDistance))
+				{
+					if (_mode == SpatialIndex::AnyHit)
+						return _gameObject;
+					maxDistance = QVector3D::dotProduct(_hitPoint - _ray.origin(), _ray.direction()) / _ray.direction().lengthSquared();
+				}
+			// Static objects are stored separately, only hits closer than the dynamic one are looked for
+			GameObject* staticObject;
+			QVector3D staticHitPoint;
+			if (auto staticIndex = scene->staticIndex())
+				if (staticIndex->raycast(_ray, staticObject, &staticHitPoint, _mode, maxDistance))
+				{
+					_gameObject = staticObject;
+					_hitPoint = staticHitPoint;
+				}
 			return _gameObject;
 		}
 		else
@@ -1,16 +1,24 @@
 #pragma once
 #include "Geometry/Ray3D.h"
+#include "Geometry/SpatialIndex.h"
 
 namespace GameEngine {
 	class GameObject;
 	class Raycast final
 	{
 		Ray3D _ray;
+		SpatialIndex::RaycastMode _mode;
+		float _maxDistance;
 		GameObject* _gameObject;
 		QVector3D _hitPoint;
 
 	public:
-		EXPORT Raycast(const Ray3D& ray);
+		/*
+		Casts the ray into the active scene. Max distance is measured in lengths of the ray's direction, any hit
+		mode returns whatever is found first and is meant for line of sight checks.
+		*/
+		EXPORT Raycast(const Ray3D& ray, SpatialIndex::RaycastMode mode = SpatialIndex::ClosestHit,
+		               float maxDistance = std::numeric_limits<float>::max());
 		EXPORT ~Raycast();
 		EXPORT bool hit() const;
 		EXPORT GameObject* gameObject() const;
@@ -0,0 +1,60 @@
+#include "RaycastBatch.h"
+#include "ProjectManager.h"
+
+GameEngine::RaycastBatch::RaycastBatch(const QVector<Ray3D>& rays, SpatialIndex::RaycastMode mode, float maxDistance)
+{
+	doRaycast(rays, mode, maxDistance);
+}
+
+GameEngine::RaycastBatch::~RaycastBatch() {}
+
+int GameEngine::RaycastBatch::count() const
+{
+	return _hits.count();
+}
+
+bool GameEngine::RaycastBatch::hit(int index) const
+{
+	return _hits[index].gameObject;
+}
+
+GameEngine::GameObject* GameEngine::RaycastBatch::gameObject(int index) const
+{
+	return _hits[index].gameObject;
+}
+
+const QVector3D& GameEngine::RaycastBatch::hitPoint(int index) const
+{
+	return _hits[index].hitPoint;
+}
+
+const QVector<GameEngine::SpatialIndex::RaycastHit>& GameEngine::RaycastBatch::hits() const
+{
+	return _hits;
+}
+
+void GameEngine::RaycastBatch::doRaycast(const QVector<Ray3D>& rays, SpatialIndex::RaycastMode mode, float maxDistance)
+{
+	if (auto project = ProjectManager::instance()->activeProject())
+	{
+		if (auto scene = project->getActiveScene())
+		{
+			scene->updateSpatialIndex();
+			// Static index only looks for hits closer than the dynamic ones, same as Raycast does
+			auto keepHits = false;
+			if (auto spatialIndex = scene->spatialIndex())
+			{
+				spatialIndex->raycastBatch(rays, _hits, mode, maxDistance, scene->taskPool());
+				keepHits = true;
+			}
+			if (auto staticIndex = scene->staticIndex())
+				staticIndex->raycastBatch(rays, _hits, mode, maxDistance, scene->taskPool(), keepHits);
+			if (_hits.count() != rays.count())
+				_hits.fill({ nullptr, QVector3D(), maxDistance }, rays.count());
+		}
+		else
+			throw std::logic_error("RaycastBatch::doRaycast: No active scene loaded.");
+	}
+	else
+		throw std::logic_error("RaycastBatch::doRaycast: No active project loaded.");
+}
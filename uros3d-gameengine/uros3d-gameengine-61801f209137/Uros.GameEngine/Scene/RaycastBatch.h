@@ -0,0 +1,30 @@
+#pragma once
+#include <QVector>
+#include "Geometry/Ray3D.h"
+#include "Geometry/SpatialIndex.h"
+
+namespace GameEngine {
+	class GameObject;
+
+	/*
+	Casts many rays into the active scene at once. The scene is looked up and its index updated only once
+	for the whole batch, which is split between threads of the scene's pool when there is one.
+	*/
+	class RaycastBatch final
+	{
+		QVector<SpatialIndex::RaycastHit> _hits;
+
+	public:
+		EXPORT explicit RaycastBatch(const QVector<Ray3D>& rays, SpatialIndex::RaycastMode mode = SpatialIndex::ClosestHit,
+		                             float maxDistance = std::numeric_limits<float>::max());
+		EXPORT ~RaycastBatch();
+		EXPORT int count() const;
+		EXPORT bool hit(int index) const;
+		EXPORT GameObject* gameObject(int index) const;
+		EXPORT const QVector3D& hitPoint(int index) const;
+		EXPORT const QVector<SpatialIndex::RaycastHit>& hits() const;
+
+	private:
+		void doRaycast(const QVector<Ray3D>& rays, SpatialIndex::RaycastMode mode, float maxDistance);
+	};
+}
@@ -6,11 +6,37 @@
 #include "Camera.h"
 #include "Behaviour.h"
 #include "Debugger.h"
+#include "Application.h"
+#include "TaskPool.h"
+#include "Geometry/Octree.h"
+#include "Geometry/LinearOctree.h"
+#include "Geometry/LooseOctree.h"
+#include "Geometry/DynamicAabbTree.h"
+#include "Geometry/StaticBvh.h"
+#include "Geometry/OcclusionBuffer.h"
+#include "Geometry/PotentiallyVisibleSet.h"
+#include "Geometry/TriangleBvh.h"
 #include "Rendering/Renderer.h"
+#include "Rendering/MeshRenderer.h"
 #include "Rendering/RenderingManager.h"
+#include "Rendering/Viewport.h"
 
 #define FRUSTUM_CULLING
-GameEngine::Scene::Scene() {}
+#define DEFERRED_INDEX_UPDATES
+#define MAX_OCCLUDERS 32
+#define MAX_OCCLUDER_TRIANGLES 2048
+#define MIN_OCCLUDER_SIZE 0.1f
+GameEngine::Scene::Scene()
+	: _movedObjects(0),
+	  _visibilityDirty(true),
+	  _hierarchicalCulling(false),
+	  _lod(false),
+	  _lodCullSize(0),
+	  _spatialIndex(nullptr),
+	  _staticIndex(nullptr),
+	  _cullingPool(nullptr),
+	  _occlusionBuffer(nullptr),
+	  _pvs(nullptr) {}
 
 GameEngine::Scene::Scene(const QString& name)
 	: Scene()
@@ -24,6 +50,11 @@ GameEngine::Scene::~Scene()
 	_gameObjects.clear();
 	for (const auto& gameObject : gameObjects)
 		GameObject::destroy(gameObject);
+	delete _spatialIndex;
+	delete _staticIndex;
+	delete _cullingPool;
+	delete _occlusionBuffer;
+	delete _pvs;
 }
 
 const QString& GameEngine::Scene::getName() const
@@ -68,29 +99,132 @@ void GameEngine::Scene::setName(const QString& name)
 	_name = name;
 }
 
+void GameEngine::Scene::cull(const QList<Camera*>& cameras, QList<FrustumSet::Visibility>& gameObjects)
+{
+	if (!_spatialIndex)
+	{
+		ERROR_LOG("> Scene::cull: Scene is not initialized.");
+		return;
+	}
+	updateSpatialIndex();
+
+	FrustumSet frustums;
+	for (const auto& camera : cameras)
+		frustums.add(camera->frustum().snapshot());
+	auto first = gameObjects.count();
+	_spatialIndex->intersect(frustums, gameObjects);
+	_staticIndex->intersect(frustums, gameObjects);
+	if (_hierarchicalCulling)
+		cullHierarchy(frustums, gameObjects, first);
+}
+
 void GameEngine::Scene::initialize()
 {
-	_octree.initialize(_gameObjects.toVector());
+	if (_spatialIndex)
+	{
+		ERROR_LOG("> Scene::initialize: Scene is already initialized.");
+		return;
+	}
+
+	const auto& settings = Application::settings();
+	_hierarchicalCulling = settings.isHierarchicalCullingEnabled();
+	_lod = settings.isLodEnabled();
+	_lodCullSize = settings.getLodCullSize();
+	switch (settings.getSpatialIndexType())
+	{
+		case Settings::LinearOctree:
+			_spatialIndex = new LinearOctree();
+			break;
+		case Settings::LooseOctree:
+			_spatialIndex = new LooseOctree();
+			break;
+		case Settings::DynamicAabbTree:
+			_spatialIndex = new DynamicAabbTree();
+			break;
+		default:
+			_spatialIndex = new Octree(settings.getOctreeSplitThreshold(), settings.getOctreeMergeThreshold(), settings.getOctreeMaxDepth());
+			break;
+	}
 	QVector<const MeshRenderer*> statics;
+	QVector<GameObject*> staticObjects;
+	QVector<GameObject*> dynamicObjects;
 	for (const auto& gameObject : _gameObjects)
 	{
+		auto indexed = !_hierarchicalCulling || isCullingRoot(gameObject);
 		if (gameObject->isStatic())
 		{
+			if (indexed)
+				staticObjects.push_back(gameObject);
 			if (const auto& meshRenderer = gameObject->getComponent<MeshRenderer>())
 				statics.push_back(meshRenderer);
 		}
 		else
+		{
+			if (indexed)
+				dynamicObjects.push_back(gameObject);
 			if (const auto& renderer = gameObject->getComponent<Renderer>())
-				renderer->render();		
+				renderer->render();
+		}
+	}
+	if (_hierarchicalCulling)
+		_cullingRoots = dynamicObjects.toList().toSet();
+	// Static objects can't move, so they get their own hierarchy which is never updated
+	_staticIndex = new StaticBvh();
+	_staticIndex->setHierarchical(_hierarchicalCulling);
+	_staticIndex->initialize(staticObjects);
+	_spatialIndex->setHierarchical(_hierarchicalCulling);
+	_spatialIndex->initialize(dynamicObjects);
+	if (settings.getCullingThreadCount() > 1)
+		_cullingPool = new TaskPool(settings.getCullingThreadCount());
+	if (_lod)
+		buildLods();
+	if (settings.isOcclusionCullingEnabled())
+		_occlusionBuffer = new OcclusionBuffer();
+	if (settings.isPvsEnabled())
+	{
+		// Cached set is reused only if it was built for exactly these static objects
+		_pvs = new PotentiallyVisibleSet();
+		const auto& path = settings.getPvsCachePath();
+		if (path.isEmpty() || !_pvs->load(path, staticObjects, settings.getPvsCellSize()))
+		{
+			_pvs->build(staticObjects, settings.getPvsCellSize(), _cullingPool);
+			if (!path.isEmpty())
+				_pvs->save(path);
+		}
 	}
 	RenderingManager::instance()->buildStaticBatches(statics.constBegin(), statics.constEnd());
 	RenderingManager::instance()->drawOpaqueBatches();
 	RenderingManager::instance()->drawTransparentBatches();
 }
 
-const GameEngine::Octree& GameEngine::Scene::octree() const
+const GameEngine::SpatialIndex* GameEngine::Scene::spatialIndex() const
+{
+	return _spatialIndex;
+}
+
+const GameEngine::SpatialIndex* GameEngine::Scene::staticIndex() const
+{
+	return _staticIndex;
+}
+
+GameEngine::TaskPool* GameEngine::Scene::taskPool() const
+{
+	return _cullingPool;
+}
+
+int GameEngine::Scene::movedObjects() const
 {
-	return _octree;
+	return _movedObjects;
+}
+
+void GameEngine::Scene::updateSpatialIndex()
+{
+	if (!_spatialIndex)
+		return;
+	for (const auto& gameObject : _dirtyObjects)
+		if (_spatialIndex->update(gameObject))
+			_movedObjects++;
+	_dirtyObjects.clear();
 }
 
 void GameEngine::Scene::addGameObject(GameObject* gameObject)
@@ -102,7 +236,14 @@ void GameEngine::Scene::addGameObject(GameObject* gameObject)
 	connect(gameObject->transform(), SIGNAL(changed(Transform*)),
 		this, SLOT(onTransformChanged(Transform*)));
 	_gameObjects.push_back(gameObject);
-	_octree.add(gameObject);
+	_visibilityDirty = true;
+	if (_spatialIndex)
+	{
+		// New objects have no parent yet, reparenting takes them out of the index later
+		if (_hierarchicalCulling)
+			_cullingRoots.insert(gameObject);
+		_spatialIndex->add(gameObject);
+	}
 }
 
 void GameEngine::Scene::removeGameObject(GameObject* gameObject)
@@ -114,7 +255,15 @@ void GameEngine::Scene::removeGameObject(GameObject* gameObject)
 	disconnect(gameObject->transform(), SIGNAL(changed(Transform*)),
 		this, SLOT(onTransformChanged(Transform*)));
 	_gameObjects.removeAll(gameObject);
-	_octree.remove(gameObject);
+	_dirtyObjects.remove(gameObject);
+	_cullingRoots.remove(gameObject);
+	_visibilityDirty = true;
+	if (_pvs)
+		_pvs->remove(gameObject);
+	if (gameObject->isStatic() && _staticIndex)
+		_staticIndex->remove(gameObject);
+	else if (_spatialIndex)
+		_spatialIndex->remove(gameObject);
 }
 
 void GameEngine::Scene::update(double deltaTime) const
@@ -145,6 +294,9 @@ void GameEngine::Scene::render()
 	// Camera with the highest Z layer is definitive 'active' camera
 	const auto& activeCamera = activeCameras.first();
 	renderingManager->setActiveCamera(activeCamera);
+	// Mesh renderers pick their level of detail by their size on the active camera's screen
+	auto viewport = Application::viewport();
+	renderingManager->setLodView(_lod && viewport ? activeCamera : nullptr, viewport ? viewport->height() : 0, _lodCullSize);
 
 	QList<Light*> activeLights;
 	for (const auto& light : _lights)
@@ -152,15 +304,64 @@ void GameEngine::Scene::render()
 			activeLights.push_back(light);
 	renderingManager->setActiveLights(activeLights);
 
+	// Moved objects are only marked during update, sync them all at once
+	updateSpatialIndex();
+	renderingManager->stats().currentFrame().addMovedObjects(_movedObjects);
+	_movedObjects = 0;
+	if (_spatialIndex)
+	{
+		auto outlierStats = _spatialIndex->outlierStats();
+		renderingManager->stats().setOutlierCount(outlierStats.outliers);
+		renderingManager->stats().setRerootCount(outlierStats.reroots);
+	}
+	renderingManager->stats().setTriangleBvhMemory(TriangleBvh::totalMemoryUsage());
+
 	/* ------------------------ Opaque Objects ------------------------ */
 
 	_transparentObjects.clear();
 #ifdef FRUSTUM_CULLING
 	renderingManager->stats().setFrustumCullStatus(true);
-	int prevCount = _visibleObjects.count();
-	_visibleObjects.clear();
-	_visibleObjects.reserve(prevCount);
-	_octree.intersect(activeCamera->frustum(), _visibleObjects);
+	// Nothing moved and the camera stands still, so last frame's lists are still valid
+	auto viewProjection = activeCamera->projectionMatrix();
+	if (_visibilityDirty || viewProjection != _lastViewProjection)
+	{
+		int prevCount = _visibleObjects.count();
+		_visibleObjects.clear();
+		_visibleObjects.reserve(prevCount);
+		// Planes are extracted once, every test below reuses them
+		CullingFrustum frustum(viewProjection);
+		if (_cullingPool)
+			_spatialIndex->intersectParallel(frustum, _visibleObjects, *_cullingPool);
+		else
+			_spatialIndex->intersect(frustum, _visibleObjects);
+		_visibleStatics.clear();
+		auto cell = _pvs ? _pvs->findCell(activeCamera->gameObject()->transform()->getPosition()) : -1;
+		if (cell >= 0)
+		{
+			// Only statics seen from the camera's cell are left for the frustum test
+			QList<GameObject*> candidates;
+			_pvs->visibleObjects(cell, candidates);
+			for (const auto& gameObject : candidates)
+				if (frustum.intersects(gameObject->boundingBox()))
+					_visibleStatics.push_back(gameObject);
+		}
+		else
+			_staticIndex->intersect(frustum, _visibleStatics);
+		if (_hierarchicalCulling)
+		{
+			cullHierarchy(frustum, _visibleObjects, 0);
+			cullHierarchy(frustum, _visibleStatics, 0);
+		}
+		if (_occlusionBuffer)
+			cullOccluded(activeCamera);
+		_lastViewProjection = viewProjection;
+		_visibilityDirty = false;
+	}
+	// Static batches are drawn only if some of their objects are visible
+	QSet<Material> visibleBatches;
+	for (const auto& gameObject : _visibleStatics)
+		if (const auto& meshRenderer = gameObject->getComponent<MeshRenderer>())
+			visibleBatches.insert(meshRenderer->getConstMaterial());
 	for (const auto& gameObject : _visibleObjects)
 #else
 	renderingManager->stats().setFrustumCullStatus(false);
@@ -186,7 +387,7 @@ void GameEngine::Scene::render()
 	}
 
 #ifdef FRUSTUM_CULLING
-	renderingManager->drawOpaqueBatches(activeCamera);
+	renderingManager->drawOpaqueBatches(&visibleBatches);
 #else
 	renderingManager->drawOpaqueBatches();
 #endif
@@ -205,7 +406,7 @@ void GameEngine::Scene::render()
 		transparentObject->render();
 
 #ifdef FRUSTUM_CULLING
-	renderingManager->drawTransparentBatches(activeCamera);
+	renderingManager->drawTransparentBatches(&visibleBatches);
 #else
 	renderingManager->drawTransparentBatches();
 #endif
@@ -219,8 +420,156 @@ void GameEngine::Scene::render()
 	renderingManager->stats().pushCurrentFrame();
 }
 
+bool GameEngine::Scene::isCullingRoot(const GameObject* gameObject)
+{
+	auto parent = gameObject->transform()->getParent();
+	return !parent || parent->gameObject()->isStatic() != gameObject->isStatic();
+}
+
+void GameEngine::Scene::buildLods() const
+{
+	// Meshes are often shared, each one is simplified once and on the pool when there is one
+	QSet<const Mesh*> meshes;
+	for (const auto& gameObject : _gameObjects)
+		if (auto meshRenderer = gameObject->getComponent<MeshRenderer>())
+			if (auto mesh = meshRenderer->getMesh())
+				meshes.insert(mesh);
+	QVector<TaskPool::Task> tasks;
+	tasks.reserve(meshes.count());
+	for (auto mesh : meshes)
+		tasks.push_back([mesh]()
+		{
+			mesh->buildLods();
+		});
+	if (_cullingPool)
+		_cullingPool->run(tasks);
+	else
+		for (const auto& task : tasks)
+			task();
+}
+
+void GameEngine::Scene::cullHierarchy(const CullingFrustum& frustum, QList<GameObject*>& gameObjects, int first) const
+{
+	// Children in the other index are culled there, along with their own subtrees
+	QVector<QPair<GameObject*, bool>> stack;
+	auto pushChildren = [&](const GameObject* parent, bool inside)
+	{
+		for (const auto& child : parent->transform()->children())
+			if (child->gameObject()->isStatic() == parent->isStatic())
+				stack.push_back(qMakePair(child->gameObject(), inside));
+	};
+	for (auto i = first, count = gameObjects.count(); i < count; i++)
+	{
+		auto lastPlane = 0;
+		pushChildren(gameObjects[i], frustum.classify(gameObjects[i]->boundingBox(), lastPlane) == CullingFrustum::Inside);
+	}
+
+	while (!stack.isEmpty())
+	{
+		auto gameObject = stack.last().first;
+		auto inside = stack.last().second;
+		stack.pop_back();
+		if (!inside)
+		{
+			auto lastPlane = 0;
+			auto containment = frustum.classify(gameObject->boundingBox(), lastPlane);
+			if (containment == CullingFrustum::Outside)
+				continue;
+			inside = containment == CullingFrustum::Inside;
+		}
+		gameObjects.push_back(gameObject);
+		pushChildren(gameObject, inside);
+	}
+}
+
+void GameEngine::Scene::cullHierarchy(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects, int first) const
+{
+	// Children are tested only against the views which saw their parent
+	QVector<FrustumSet::Visibility> stack;
+	auto pushChildren = [&](const GameObject* parent, quint32 views)
+	{
+		for (const auto& child : parent->transform()->children())
+			if (child->gameObject()->isStatic() == parent->isStatic())
+				stack.push_back(qMakePair(child->gameObject(), views));
+	};
+	for (auto i = first, count = gameObjects.count(); i < count; i++)
+		pushChildren(gameObjects[i].first, gameObjects[i].second);
+
+	while (!stack.isEmpty())
+	{
+		auto gameObject = stack.last().first;
+		auto views = frustums.intersects(gameObject->boundingBox(), stack.last().second);
+		stack.pop_back();
+		if (!views)
+			continue;
+		gameObjects.push_back(qMakePair(gameObject, views));
+		pushChildren(gameObject, views);
+	}
+}
+
+void GameEngine::Scene::cullOccluded(const Camera* camera)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	// Big objects close to the camera hide the most, pick those as occluders
+	const auto& position = camera->gameObject()->transform()->getPosition();
+	QVector<QPair<float, GameObject*>> candidates;
+	auto addCandidates = [&](const QList<GameObject*>& gameObjects)
+	{
+		for (const auto& gameObject : gameObjects)
+		{
+			const auto& meshRenderer = gameObject->getComponent<MeshRenderer>();
+			if (!meshRenderer || !meshRenderer->isEnabled() || !meshRenderer->getMesh() || meshRenderer->getConstMaterial().getShaderType() >= 100)
+				continue;
+			if (meshRenderer->getMesh()->triangleCount() > MAX_OCCLUDER_TRIANGLES)
+				continue;
+			const auto& bbox = meshRenderer->boundingBox();
+			auto size = bbox.extent().length() / qMax((bbox.midPoint() - position).length(), 1e-3f);
+			if (size >= MIN_OCCLUDER_SIZE)
+				candidates.push_back(qMakePair(size, gameObject));
+		}
+	};
+	addCandidates(_visibleStatics);
+	addCandidates(_visibleObjects);
+	std::sort(candidates.begin(), candidates.end(),
+	          [](const QPair<float, GameObject*>& a, const QPair<float, GameObject*>& b)
+	          {
+		          return a.first > b.first;
+	          });
+
+	QSet<GameObject*> occluders;
+	_occlusionBuffer->clear(camera->projectionMatrix());
+	for (auto i = 0; i < qMin(candidates.count(), MAX_OCCLUDERS); i++)
+	{
+		const auto& gameObject = candidates[i].second;
+		_occlusionBuffer->rasterize(*gameObject->getComponent<MeshRenderer>()->getMesh(), gameObject->transform()->getMatrix());
+		occluders.insert(gameObject);
+	}
+
+	auto occluded = 0;
+	auto removeOccluded = [&](QList<GameObject*>& gameObjects)
+	{
+		QList<GameObject*> visible;
+		visible.reserve(gameObjects.count());
+		for (const auto& gameObject : gameObjects)
+			if (occluders.contains(gameObject) || !_occlusionBuffer->isOccluded(gameObject->boundingBox()))
+				visible.push_back(gameObject);
+		occluded += gameObjects.count() - visible.count();
+		gameObjects.swap(visible);
+	};
+	removeOccluded(_visibleStatics);
+	removeOccluded(_visibleObjects);
+
+	auto& frameStats = RenderingManager::instance()->stats().currentFrame();
+	frameStats.addOccludedObjects(occluded);
+	frameStats.addOcclusionTime(timer.nsecsElapsed() / 1000000.0);
+}
+
 void GameEngine::Scene::onComponentAdded(GameObject* gameObject, Component* component)
 {
+	// New or removed renderers change what is there to see
+	_visibilityDirty = true;
 	if (const auto& light = dynamic_cast<Light*>(component))
 		_lights.push_back(light);
 	else if (const auto& camera = dynamic_cast<Camera*>(component))
@@ -233,6 +582,7 @@ void GameEngine::Scene::onComponentAdded(GameObject* gameObject, Component* comp
 
 void GameEngine::Scene::onComponentRemoved(GameObject* gameObject, Component* component)
 {
+	_visibilityDirty = true;
 	if (const auto& light = dynamic_cast<Light*>(component))
 		_lights.removeAll(light);
 	else if (const auto& camera = dynamic_cast<Camera*>(component))
@@ -245,5 +595,41 @@ void GameEngine::Scene::onComponentRemoved(GameObject* gameObject, Component* co
 
 void GameEngine::Scene::onTransformChanged(Transform* transform)
 {
-	_octree.update(transform->gameObject());
+	// Static objects live in the static hierarchy and never move
+	const auto& gameObject = transform->gameObject();
+	if (gameObject->isStatic())
+		return;
+	_visibilityDirty = true;
+	if (!_spatialIndex)
+		return;
+
+	// Reparenting may turn a root into a child or the other way around
+	if (_hierarchicalCulling && isCullingRoot(gameObject) != _cullingRoots.contains(gameObject))
+	{
+		if (_cullingRoots.contains(gameObject))
+		{
+			_cullingRoots.remove(gameObject);
+			_dirtyObjects.remove(gameObject);
+			_spatialIndex->remove(gameObject);
+		}
+		else
+		{
+			_cullingRoots.insert(gameObject);
+			_spatialIndex->add(gameObject);
+		}
+	}
+
+	// Parents' bounds enclose their children, so they moved as well
+	for (auto parent = transform; parent; parent = parent->getParent())
+	{
+		const auto& object = parent->gameObject();
+		if (object->isStatic() || (_hierarchicalCulling && !_cullingRoots.contains(object)))
+			continue;
+#ifdef DEFERRED_INDEX_UPDATES
+		_dirtyObjects.insert(object);
+#else
+		if (_spatialIndex->update(object))
+			_movedObjects++;
+#endif
+	}
 }
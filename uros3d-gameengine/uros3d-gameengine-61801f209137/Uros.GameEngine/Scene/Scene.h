@@ -1,7 +1,9 @@
 #pragma once
 #include <QObject>
+#include <QSet>
+#include <QMatrix4x4>
 #include "Includes.h"
-#include "Geometry/Octree.h"
+#include "Geometry/SpatialIndex.h"
 
 namespace GameEngine {
 	class Component;
@@ -13,6 +15,9 @@ namespace GameEngine {
 	class Debugger;
 	class GameObject;
 	class GameObjectReader;
+	class TaskPool;
+	class OcclusionBuffer;
+	class PotentiallyVisibleSet;
 
 	class Scene final : QObject
 	{
@@ -52,11 +57,24 @@ namespace GameEngine {
 		Set scene's name.
 		*/
 		EXPORT void setName(const QString& name);
+		/*
+		Culls the scene for all specified cameras in one pass. Every visible object comes with a mask of cameras
+		it's visible from, bit i stands for cameras[i]. At most 32 cameras can be culled at once. Objects moved
+		since the last frame are brought up to date in the spatial index first.
+		*/
+		EXPORT void cull(const QList<Camera*>& cameras, QList<FrustumSet::Visibility>& gameObjects);
 
 		/* Internal stuff, don't call from API */
 
 		void initialize();
-		const Octree& octree() const;
+		const SpatialIndex* spatialIndex() const;
+		const SpatialIndex* staticIndex() const;
+		TaskPool* taskPool() const;
+		/*
+		Objects which changed their place in the spatial index since the last frame.
+		*/
+		int movedObjects() const;
+		void updateSpatialIndex();
 		void addGameObject(GameObject* gameObject);
 		void removeGameObject(GameObject* gameObject);
 		void update(double deltaTime) const;
@@ -68,6 +86,22 @@ namespace GameEngine {
 		void onTransformChanged(Transform* transform);
 
 	private:
+		/*
+		Objects whose parent lives in the same index are reached through it and aren't indexed on their own.
+		*/
+		static bool isCullingRoot(const GameObject* gameObject);
+		/*
+		Walks down the children of culled objects starting at first. Subtrees whose aggregate bounds are
+		outside get skipped, those inside are accepted without testing anything below.
+		*/
+		void cullHierarchy(const CullingFrustum& frustum, QList<GameObject*>& gameObjects, int first) const;
+		void cullHierarchy(const FrustumSet& frustums, QList<FrustumSet::Visibility>& gameObjects, int first) const;
+		/*
+		Builds levels of detail of every mesh in the scene, so none of them is simplified while rendering.
+		*/
+		void buildLods() const;
+		void cullOccluded(const Camera* camera);
+
 		QString _name;
 		QList<GameObject*> _gameObjects;
 		QList<Camera*> _cameras;
@@ -76,6 +110,19 @@ namespace GameEngine {
 		QList<Debugger*> _debuggers;
 		QList<Renderer*> _transparentObjects;
 		QList<GameObject*> _visibleObjects;
-		Octree _octree;
+		QList<GameObject*> _visibleStatics;
+		QSet<GameObject*> _dirtyObjects;
+		QSet<GameObject*> _cullingRoots; // Dynamic objects in the spatial index when culling hierarchically
+		int _movedObjects;
+		bool _visibilityDirty; // Something moved since the visible lists were built
+		bool _hierarchicalCulling;
+		bool _lod;
+		float _lodCullSize;
+		QMatrix4x4 _lastViewProjection;
+		SpatialIndex* _spatialIndex;
+		SpatialIndex* _staticIndex;
+		TaskPool* _cullingPool;
+		OcclusionBuffer* _occlusionBuffer;
+		PotentiallyVisibleSet* _pvs;
 	};
 }
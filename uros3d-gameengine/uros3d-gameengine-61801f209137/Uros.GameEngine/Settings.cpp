@@ -2,15 +2,53 @@
 
 GameEngine::Settings::Settings()
 	:_vSync(true),
+	 _occlusionCulling(false),
+	 _hierarchicalCulling(false),
+	 _pvs(false),
+	 _lod(false),
+	 _meshOptimization(false),
 	 _windowType(Window),
 	 _antiAliasingType(Off),
-	 _rendererType(OpenGL) {}
+	 _rendererType(OpenGL),
+	 _spatialIndexType(Octree),
+	 _vertexFormatType(FullVertices),
+	 _octreeSplitThreshold(16),
+	 _octreeMergeThreshold(8),
+	 _octreeMaxDepth(8),
+	 _cullingThreadCount(1),
+	 _pvsCellSize(8),
+	 _lodCullSize(1) {}
 
 bool GameEngine::Settings::isVSyncEnabled() const
 {
 	return _vSync;
 }
 
+bool GameEngine::Settings::isOcclusionCullingEnabled() const
+{
+	return _occlusionCulling;
+}
+
+bool GameEngine::Settings::isHierarchicalCullingEnabled() const
+{
+	return _hierarchicalCulling;
+}
+
+bool GameEngine::Settings::isPvsEnabled() const
+{
+	return _pvs;
+}
+
+bool GameEngine::Settings::isLodEnabled() const
+{
+	return _lod;
+}
+
+bool GameEngine::Settings::isMeshOptimizationEnabled() const
+{
+	return _meshOptimization;
+}
+
 GameEngine::Settings::WindowType GameEngine::Settings::getWindowType() const
 {
 	return _windowType;
@@ -26,6 +64,51 @@ GameEngine::Settings::RendererType GameEngine::Settings::getRendererType() const
 	return _rendererType;
 }
 
+GameEngine::Settings::SpatialIndexType GameEngine::Settings::getSpatialIndexType() const
+{
+	return _spatialIndexType;
+}
+
+GameEngine::Settings::VertexFormatType GameEngine::Settings::getVertexFormatType() const
+{
+	return _vertexFormatType;
+}
+
+int GameEngine::Settings::getOctreeSplitThreshold() const
+{
+	return _octreeSplitThreshold;
+}
+
+int GameEngine::Settings::getOctreeMergeThreshold() const
+{
+	return _octreeMergeThreshold;
+}
+
+int GameEngine::Settings::getOctreeMaxDepth() const
+{
+	return _octreeMaxDepth;
+}
+
+int GameEngine::Settings::getCullingThreadCount() const
+{
+	return _cullingThreadCount;
+}
+
+float GameEngine::Settings::getPvsCellSize() const
+{
+	return _pvsCellSize;
+}
+
+const QString& GameEngine::Settings::getPvsCachePath() const
+{
+	return _pvsCachePath;
+}
+
+float GameEngine::Settings::getLodCullSize() const
+{
+	return _lodCullSize;
+}
+
 void GameEngine::Settings::enableVSync()
 {
 	_vSync = true;
@@ -36,6 +119,56 @@ void GameEngine::Settings::disableVSync()
 	_vSync = false;
 }
 
+void GameEngine::Settings::enableOcclusionCulling()
+{
+	_occlusionCulling = true;
+}
+
+void GameEngine::Settings::disableOcclusionCulling()
+{
+	_occlusionCulling = false;
+}
+
+void GameEngine::Settings::enableHierarchicalCulling()
+{
+	_hierarchicalCulling = true;
+}
+
+void GameEngine::Settings::disableHierarchicalCulling()
+{
+	_hierarchicalCulling = false;
+}
+
+void GameEngine::Settings::enablePvs()
+{
+	_pvs = true;
+}
+
+void GameEngine::Settings::disablePvs()
+{
+	_pvs = false;
+}
+
+void GameEngine::Settings::enableLod()
+{
+	_lod = true;
+}
+
+void GameEngine::Settings::disableLod()
+{
+	_lod = false;
+}
+
+void GameEngine::Settings::enableMeshOptimization()
+{
+	_meshOptimization = true;
+}
+
+void GameEngine::Settings::disableMeshOptimization()
+{
+	_meshOptimization = false;
+}
+
 void GameEngine::Settings::setWindowType(const WindowType& type)
 {
 	_windowType = type;
@@ -50,3 +183,48 @@ void GameEngine::Settings::setRendererType(const RendererType& type)
 {
 	_rendererType = type;
 }
+
+void GameEngine::Settings::setSpatialIndexType(const SpatialIndexType& type)
+{
+	_spatialIndexType = type;
+}
+
+void GameEngine::Settings::setVertexFormatType(const VertexFormatType& type)
+{
+	_vertexFormatType = type;
+}
+
+void GameEngine::Settings::setOctreeSplitThreshold(int count)
+{
+	_octreeSplitThreshold = count;
+}
+
+void GameEngine::Settings::setOctreeMergeThreshold(int count)
+{
+	_octreeMergeThreshold = count;
+}
+
+void GameEngine::Settings::setOctreeMaxDepth(int depth)
+{
+	_octreeMaxDepth = depth;
+}
+
+void GameEngine::Settings::setCullingThreadCount(int count)
+{
+	_cullingThreadCount = count;
+}
+
+void GameEngine::Settings::setPvsCellSize(float size)
+{
+	_pvsCellSize = size;
+}
+
+void GameEngine::Settings::setPvsCachePath(const QString& path)
+{
+	_pvsCachePath = path;
+}
+
+void GameEngine::Settings::setLodCullSize(float pixels)
+{
+	_lodCullSize = pixels;
+}
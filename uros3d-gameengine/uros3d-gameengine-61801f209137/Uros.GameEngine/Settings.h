@@ -1,4 +1,5 @@
 #pragma once
+#include <QString>
 #include "Includes.h"
 
 namespace GameEngine {
@@ -24,24 +25,83 @@ namespace GameEngine {
 			OpenGL,
 			Direct3D
 		};
+		enum SpatialIndexType
+		{
+			Octree,
+			LinearOctree,
+			LooseOctree,
+			DynamicAabbTree
+		};
+		enum VertexFormatType
+		{
+			FullVertices,
+			CompactVertices
+		};
 
 		EXPORT Settings();
 
 		EXPORT bool isVSyncEnabled() const;
+		EXPORT bool isOcclusionCullingEnabled() const;
+		EXPORT bool isHierarchicalCullingEnabled() const;
+		EXPORT bool isPvsEnabled() const;
+		EXPORT bool isLodEnabled() const;
+		EXPORT bool isMeshOptimizationEnabled() const;
 		EXPORT WindowType getWindowType() const;
 		EXPORT AntiAliasingType getAntiAliasingType() const;
 		EXPORT RendererType getRendererType() const;
+		EXPORT SpatialIndexType getSpatialIndexType() const;
+		EXPORT VertexFormatType getVertexFormatType() const;
+		EXPORT int getOctreeSplitThreshold() const;
+		EXPORT int getOctreeMergeThreshold() const;
+		EXPORT int getOctreeMaxDepth() const;
+		EXPORT int getCullingThreadCount() const;
+		EXPORT float getPvsCellSize() const;
+		EXPORT const QString& getPvsCachePath() const;
+		EXPORT float getLodCullSize() const;
 
 		EXPORT void enableVSync();
 		EXPORT void disableVSync();
+		EXPORT void enableOcclusionCulling();
+		EXPORT void disableOcclusionCulling();
+		EXPORT void enableHierarchicalCulling();
+		EXPORT void disableHierarchicalCulling();
+		EXPORT void enablePvs();
+		EXPORT void disablePvs();
+		EXPORT void enableLod();
+		EXPORT void disableLod();
+		EXPORT void enableMeshOptimization();
+		EXPORT void disableMeshOptimization();
 		EXPORT void setWindowType(const WindowType& type);
 		EXPORT void setAntialiasingType(const AntiAliasingType& type);
 		EXPORT void setRendererType(const RendererType& type);
+		EXPORT void setSpatialIndexType(const SpatialIndexType& type);
+		EXPORT void setVertexFormatType(const VertexFormatType& type);
+		EXPORT void setOctreeSplitThreshold(int count);
+		EXPORT void setOctreeMergeThreshold(int count);
+		EXPORT void setOctreeMaxDepth(int depth);
+		EXPORT void setCullingThreadCount(int count);
+		EXPORT void setPvsCellSize(float size);
+		EXPORT void setPvsCachePath(const QString& path);
+		EXPORT void setLodCullSize(float pixels);
 
 	private:
 		bool _vSync;
+		bool _occlusionCulling;
+		bool _hierarchicalCulling;
+		bool _pvs;
+		bool _lod;
+		bool _meshOptimization;
 		WindowType _windowType;
 		AntiAliasingType _antiAliasingType;
 		RendererType _rendererType;
+		SpatialIndexType _spatialIndexType;
+		VertexFormatType _vertexFormatType;
+		int _octreeSplitThreshold;
+		int _octreeMergeThreshold;
+		int _octreeMaxDepth;
+		int _cullingThreadCount;
+		float _pvsCellSize;
+		QString _pvsCachePath;
+		float _lodCullSize;
 	};
 }
@@ -0,0 +1,154 @@
+#include <QThread>
+#include "TaskPool.h"
+
+class GameEngine::TaskPool::Worker final : public QThread
+{
+public:
+	Worker(TaskPool* pool, int index)
+		: _pool(pool),
+		  _index(index) {}
+
+protected:
+	void run() override
+	{
+		_pool->work(_index);
+	}
+
+private:
+	TaskPool* _pool;
+	int _index;
+};
+
+GameEngine::TaskPool::TaskPool(int threadCount)
+	: _tasks(nullptr),
+	  _remaining(0),
+	  _generation(0),
+	  _quit(false)
+{
+	if (threadCount < 1)
+		throw std::logic_error("TaskPool::TaskPool: Pool needs at least one thread.");
+
+	for (auto i = 0; i < threadCount; i++)
+	{
+		auto queue = new Queue();
+		queue->front = 0;
+		_queues.push_back(queue);
+	}
+	// Queue 0 belongs to the calling thread
+	for (auto i = 1; i < threadCount; i++)
+	{
+		auto worker = new Worker(this, i);
+		_workers.push_back(worker);
+		worker->start();
+	}
+}
+
+GameEngine::TaskPool::~TaskPool()
+{
+	_mutex.lock();
+	_quit = true;
+	_started.wakeAll();
+	_mutex.unlock();
+	for (auto worker : _workers)
+	{
+		worker->wait();
+		delete worker;
+	}
+	for (auto queue : _queues)
+		delete queue;
+}
+
+int GameEngine::TaskPool::threadCount() const
+{
+	return _queues.count();
+}
+
+void GameEngine::TaskPool::run(const QVector<Task>& tasks)
+{
+	if (tasks.isEmpty())
+		return;
+
+	// Tasks are dealt round robin, stealing evens out whatever the split gets wrong
+	_tasks = &tasks;
+	_remaining.store(tasks.count());
+	for (auto i = 0; i < _queues.count(); i++)
+	{
+		auto queue = _queues[i];
+		QMutexLocker lock(&queue->mutex);
+		queue->tasks.clear();
+		queue->front = 0;
+		for (auto task = i; task < tasks.count(); task += _queues.count())
+			queue->tasks.push_back(task);
+	}
+
+	_mutex.lock();
+	_generation++;
+	_started.wakeAll();
+	_mutex.unlock();
+
+	execute(0);
+
+	_mutex.lock();
+	while (_remaining.load())
+		_finished.wait(&_mutex);
+	_mutex.unlock();
+	_tasks = nullptr;
+}
+
+void GameEngine::TaskPool::work(int index)
+{
+	auto generation = 0;
+	forever
+	{
+		_mutex.lock();
+		while (_generation == generation && !_quit)
+			_started.wait(&_mutex);
+		generation = _generation;
+		auto quit = _quit;
+		_mutex.unlock();
+		if (quit)
+			return;
+
+		execute(index);
+	}
+}
+
+void GameEngine::TaskPool::execute(int index)
+{
+	int task;
+	while (pop(index, &task) || steal(index, &task))
+	{
+		(*_tasks)[task]();
+		if (_remaining.fetchAndAddOrdered(-1) == 1)
+		{
+			QMutexLocker lock(&_mutex);
+			_finished.wakeAll();
+		}
+	}
+}
+
+bool GameEngine::TaskPool::pop(int index, int* task)
+{
+	auto queue = _queues[index];
+	QMutexLocker lock(&queue->mutex);
+	if (queue->front == queue->tasks.count())
+		return false;
+	*task = queue->tasks.last();
+	queue->tasks.pop_back();
+	return true;
+}
+
+bool GameEngine::TaskPool::steal(int index, int* task)
+{
+	for (auto i = 1; i < _queues.count(); i++)
+	{
+		auto queue = _queues[(index + i) % _queues.count()];
+		QMutexLocker lock(&queue->mutex);
+		if (queue->front < queue->tasks.count())
+		{
+			*task = queue->tasks[queue->front++];
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+#include "Includes.h"
+
+namespace GameEngine {
+	/*
+	Pool of worker threads running batches of short tasks. Every worker has its own queue and takes tasks
+	from the back of it, once it runs dry it steals from the front of other workers' queues. Calling thread
+	works as one of the workers while the batch is running.
+	*/
+	class TaskPool final
+	{
+		NOCOPY(TaskPool)
+
+	public:
+		typedef std::function<void()> Task;
+
+		/*
+		Thread count includes the calling thread, so a pool with one thread runs everything serially.
+		*/
+		EXPORT explicit TaskPool(int threadCount);
+		EXPORT ~TaskPool();
+		EXPORT int threadCount() const;
+		/*
+		Runs all tasks and returns once every one of them has finished.
+		*/
+		EXPORT void run(const QVector<Task>& tasks);
+
+	private:
+		class Worker;
+		struct Queue
+		{
+			QMutex mutex;
+			QVector<int> tasks;
+			int front;
+		};
+
+		void work(int index);
+		void execute(int index);
+		bool pop(int index, int* task);
+		bool steal(int index, int* task);
+
+		QVector<Worker*> _workers;
+		QVector<Queue*> _queues;
+		const QVector<Task>* _tasks;
+		QAtomicInt _remaining;
+		QMutex _mutex;
+		QWaitCondition _started;
+		QWaitCondition _finished;
+		int _generation;
+		bool _quit;
+	};
+}
@@ -83,6 +83,11 @@ void Transform::_rebuildTransformMatrix()
 	_matrix.translate(_position);
 	_matrix.rotate(_rotation);
 	_matrix.scale(_scale);
+	// Inverse of scale, rotation and translation in reverse order, cheaper than inverting the whole matrix
+	_inverseMatrix.setToIdentity();
+	_inverseMatrix.scale(_scale.x() ? 1 / _scale.x() : 0, _scale.y() ? 1 / _scale.y() : 0, _scale.z() ? 1 / _scale.z() : 0);
+	_inverseMatrix.rotate(_rotation.conjugated());
+	_inverseMatrix.translate(-_position);
 	emit changed(this);
 }
 
@@ -159,6 +164,11 @@ const QMatrix4x4& Transform::getMatrix() const
 	return _matrix;
 }
 
+const QMatrix4x4& Transform::getInverseMatrix() const
+{
+	return _inverseMatrix;
+}
+
 QVector3D Transform::getUp() const
 {
 	return _rotation.rotatedVector(_up);
@@ -218,7 +228,11 @@ void Transform::setParent(Transform* parent)
 				return;
 	//Transform can have no parent
 	if (_parent)
+	{
 		_parent->_removeChild(this);
+		// Old parent's bounds no longer enclose this transform
+		emit _parent->changed(_parent);
+	}
 	_parent = parent;
 	if (_parent)
 		_parent->_addChild(this);
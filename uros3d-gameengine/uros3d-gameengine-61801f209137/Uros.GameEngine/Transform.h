@@ -27,6 +27,7 @@ namespace GameEngine {
 		QQuaternion _rotation;
 		QVector3D _scale;
 		QMatrix4x4 _matrix;
+		QMatrix4x4 _inverseMatrix;
 		Transform* _parent;
 		QList<Transform*> _children;
 
@@ -93,6 +94,10 @@ namespace GameEngine {
 		*/
 		EXPORT const QMatrix4x4& getMatrix() const;
 		/*
+		Get matrix transforming from world space back to transform's own space.
+		*/
+		EXPORT const QMatrix4x4& getInverseMatrix() const;
+		/*
 		Get transform up vector (green axis) relative to world space.
 		*/
 		EXPORT QVector3D getUp() const;